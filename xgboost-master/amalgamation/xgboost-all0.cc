@@ -25,17 +25,24 @@
 #include "../src/gbm/gbm.cc"
 #include "../src/gbm/gbtree.cc"
 #include "../src/gbm/gblinear.cc"
+#include "../src/gbm/compiled_trees.cc"
+#include "../src/gbm/quick_scorer.cc"
+#include "../src/gbm/row_predictor.cc"
 
 // data
 #include "../src/data/data.cc"
 #include "../src/data/simple_csr_source.cc"
+#include "../src/data/dense_source.cc"
 #include "../src/data/simple_dmatrix.cc"
+#include "../src/data/slice_dmatrix.cc"
 #include "../src/data/sparse_page_raw_format.cc"
+#include "../src/data/sparse_page_mmap_format.cc"
 
 #if DMLC_ENABLE_STD_THREAD
 #include "../src/data/sparse_page_source.cc"
 #include "../src/data/sparse_page_dmatrix.cc"
 #include "../src/data/sparse_page_writer.cc"
+#include "../src/data/sparse_page_reader.cc"
 #endif
 
 // tress
@@ -54,6 +61,9 @@
 #include "../src/logging.cc"
 #include "../src/common/common.cc"
 #include "../src/common/hist_util.cc"
+#include "../src/common/hist_page.cc"
+#include "../src/common/hist_cache.cc"
+#include "../src/common/io.cc"
 
 // c_api
 #include "../src/c_api/c_api.cc"
@@ -0,0 +1,209 @@
+/*!
+ * Copyright (c) 2017 by Contributors
+ * \file compress_array.h
+ * \brief Chunked compression of the arrays of the external memory pages, and the
+ *  delta bit-packing codec of the index.
+ */
+#ifndef XGBOOST_PLUGIN_LZ4_COMPRESS_ARRAY_H_
+#define XGBOOST_PLUGIN_LZ4_COMPRESS_ARRAY_H_
+
+#include <xgboost/base.h>
+#include <xgboost/logging.h>
+#include <dmlc/io.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace xgboost {
+namespace data {
+
+// Delta and bit-packing of an index array.
+// Each value is stored as the zig-zag coded difference to the previous one, so
+// that indices ascending within a row take few bits; descents, at the start of
+// a row or in column pages sorted by value, cost more bits but still decode.
+// Blocks of kBlock differences are packed with the bit width of the largest,
+// stored in one byte before the block.
+struct DeltaBitPackCodec {
+  static const size_t kBlock = 128;
+
+  inline static void Encode(const bst_uint* data, size_t n, bool use_hc, std::string* out) {
+    out->clear();
+    out->reserve(n * sizeof(bst_uint) / 2 + n / kBlock + 1);
+    uint32_t zigzag[kBlock];
+    bst_uint prev = 0;
+    for (size_t begin = 0; begin < n; begin += kBlock) {
+      const size_t len = std::min(static_cast<size_t>(kBlock), n - begin);
+      uint32_t bits = 0;
+      for (size_t i = 0; i < len; ++i) {
+        const int32_t delta = static_cast<int32_t>(data[begin + i] - prev);
+        zigzag[i] = (static_cast<uint32_t>(delta) << 1) ^ static_cast<uint32_t>(delta >> 31);
+        bits |= zigzag[i];
+        prev = data[begin + i];
+      }
+      int width = 0;
+      while (width < 32 && (bits >> width) != 0) ++width;
+      out->push_back(static_cast<char>(width));
+      uint64_t acc = 0;
+      int nbit = 0;
+      for (size_t i = 0; i < len; ++i) {
+        acc |= static_cast<uint64_t>(zigzag[i]) << nbit;
+        nbit += width;
+        while (nbit >= 8) {
+          out->push_back(static_cast<char>(acc & 0xffUL));
+          acc >>= 8;
+          nbit -= 8;
+        }
+      }
+      if (nbit != 0) out->push_back(static_cast<char>(acc & 0xffUL));
+    }
+  }
+  inline static void Decode(const char* src, size_t encoded_size, bst_uint* data, size_t n) {
+    const unsigned char* ptr = reinterpret_cast<const unsigned char*>(src);
+    const unsigned char* end = ptr + encoded_size;
+    bst_uint prev = 0;
+    for (size_t begin = 0; begin < n; begin += kBlock) {
+      const size_t len = std::min(static_cast<size_t>(kBlock), n - begin);
+      CHECK(ptr < end) << "Invalid delta encoded index";
+      const int width = *ptr++;
+      CHECK_LE(width, 32) << "Invalid delta encoded index";
+      CHECK_GE(static_cast<size_t>(end - ptr), (len * width + 7) / 8)
+          << "Invalid delta encoded index";
+      const uint64_t mask = (static_cast<uint64_t>(1) << width) - 1;
+      uint64_t acc = 0;
+      int nbit = 0;
+      for (size_t i = 0; i < len; ++i) {
+        while (nbit < width) {
+          acc |= static_cast<uint64_t>(*ptr++) << nbit;
+          nbit += 8;
+        }
+        const uint32_t zigzag = static_cast<uint32_t>(acc & mask);
+        acc >>= width;
+        nbit -= width;
+        prev += (zigzag >> 1) ^ (0U - (zigzag & 1U));
+        data[begin + i] = prev;
+      }
+    }
+    CHECK(ptr == end) << "Invalid delta encoded index";
+  }
+};
+
+// array to help compression of decompression.
+template<typename DType, typename Codec>
+class CompressArray {
+ public:
+  // the data content.
+  std::vector<DType> data;
+  // Decompression helper
+  // number of chunks
+  inline int num_chunk() const {
+    CHECK_GT(raw_chunks_.size(), 1);
+    return static_cast<int>(raw_chunks_.size() - 1);
+  }
+  // raw bytes
+  inline size_t RawBytes() const {
+    return raw_chunks_.back() * sizeof(DType);
+  }
+  // encoded bytes
+  inline size_t EncodedBytes() const {
+    return encoded_chunks_.back() +
+        (encoded_chunks_.size() + raw_chunks_.size()) * sizeof(bst_uint);
+  }
+  // load the array from file.
+  inline void Read(dmlc::SeekStream* fi);
+  // run decode on chunk_id
+  inline void Decompress(int chunk_id);
+  // Compression helper
+  // initialize the compression chunks
+  inline void InitCompressChunks(const std::vector<bst_uint>& chunk_ptr);
+  // initialize the compression chunks
+  inline void InitCompressChunks(size_t chunk_size, size_t max_nchunk);
+  // run decode on chunk_id, level = -1 means default.
+  inline void Compress(int chunk_id, bool use_hc);
+  // save the output buffer into file.
+  inline void Write(dmlc::Stream* fo);
+
+ private:
+  // the chunk split of the data, by number of elements
+  std::vector<bst_uint> raw_chunks_;
+  // the encoded chunk, by number of bytes
+  std::vector<bst_uint> encoded_chunks_;
+  // output buffer of compression.
+  std::vector<std::string> out_buffer_;
+  // input buffer of data.
+  std::string in_buffer_;
+};
+
+template<typename DType, typename Codec>
+inline void CompressArray<DType, Codec>::Read(dmlc::SeekStream* fi) {
+  CHECK(fi->Read(&raw_chunks_));
+  CHECK(fi->Read(&encoded_chunks_));
+  size_t buffer_size = encoded_chunks_.back();
+  in_buffer_.resize(buffer_size);
+  CHECK_EQ(fi->Read(dmlc::BeginPtr(in_buffer_), buffer_size), buffer_size);
+  data.resize(raw_chunks_.back());
+}
+
+template<typename DType, typename Codec>
+inline void CompressArray<DType, Codec>::Decompress(int chunk_id) {
+  Codec::Decode(dmlc::BeginPtr(in_buffer_) + encoded_chunks_[chunk_id],
+                encoded_chunks_[chunk_id + 1] - encoded_chunks_[chunk_id],
+                dmlc::BeginPtr(data) + raw_chunks_[chunk_id],
+                raw_chunks_[chunk_id + 1] - raw_chunks_[chunk_id]);
+}
+
+template<typename DType, typename Codec>
+inline void CompressArray<DType, Codec>::InitCompressChunks(
+    const std::vector<bst_uint>& chunk_ptr) {
+  raw_chunks_ = chunk_ptr;
+  CHECK_GE(raw_chunks_.size(), 2);
+  out_buffer_.resize(raw_chunks_.size() - 1);
+  for (size_t i = 0; i < out_buffer_.size(); ++i) {
+    out_buffer_[i].resize(raw_chunks_[i + 1] - raw_chunks_[i]);
+  }
+}
+
+template<typename DType, typename Codec>
+inline void CompressArray<DType, Codec>::InitCompressChunks(size_t chunk_size, size_t max_nchunk) {
+  raw_chunks_.clear();
+  raw_chunks_.push_back(0);
+  size_t min_chunk_size = data.size() / max_nchunk;
+  chunk_size = std::max(min_chunk_size, chunk_size);
+  size_t nstep = data.size() / chunk_size;
+  for (size_t i = 0; i < nstep; ++i) {
+    raw_chunks_.push_back(raw_chunks_.back() + chunk_size);
+    CHECK_LE(raw_chunks_.back(), data.size());
+  }
+  if (nstep == 0) raw_chunks_.push_back(0);
+  raw_chunks_.back() = data.size();
+  CHECK_GE(raw_chunks_.size(), 2);
+  out_buffer_.resize(raw_chunks_.size() - 1);
+  for (size_t i = 0; i < out_buffer_.size(); ++i) {
+    out_buffer_[i].resize(raw_chunks_[i + 1] - raw_chunks_[i]);
+  }
+}
+
+template<typename DType, typename Codec>
+inline void CompressArray<DType, Codec>::Compress(int chunk_id, bool use_hc) {
+  CHECK_LT(static_cast<size_t>(chunk_id + 1), raw_chunks_.size());
+  Codec::Encode(dmlc::BeginPtr(data) + raw_chunks_[chunk_id],
+                raw_chunks_[chunk_id + 1] - raw_chunks_[chunk_id],
+                use_hc, &out_buffer_[chunk_id]);
+}
+
+template<typename DType, typename Codec>
+inline void CompressArray<DType, Codec>::Write(dmlc::Stream* fo) {
+  encoded_chunks_.clear();
+  encoded_chunks_.push_back(0);
+  for (size_t i = 0; i < out_buffer_.size(); ++i) {
+    encoded_chunks_.push_back(encoded_chunks_.back() + out_buffer_[i].length());
+  }
+  fo->Write(raw_chunks_);
+  fo->Write(encoded_chunks_);
+  for (const std::string& buf : out_buffer_) {
+    fo->Write(dmlc::BeginPtr(buf), buf.length());
+  }
+}
+
+}  // namespace data
+}  // namespace xgboost
+#endif  // XGBOOST_PLUGIN_LZ4_COMPRESS_ARRAY_H_
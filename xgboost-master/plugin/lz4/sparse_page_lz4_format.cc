@@ -9,154 +9,60 @@
 #include <dmlc/parameter.h>
 #include <lz4.h>
 #include <lz4hc.h>
+#include <limits>
 #include "../../src/data/sparse_batch_page.h"
+#include "./compress_array.h"
 
 namespace xgboost {
 namespace data {
 
 DMLC_REGISTRY_FILE_TAG(sparse_page_lz4_format);
 
-// array to help compression of decompression.
-template<typename DType>
-class CompressArray {
- public:
-  // the data content.
-  std::vector<DType> data;
-  // Decompression helper
-  // number of chunks
-  inline int num_chunk() const {
-    CHECK_GT(raw_chunks_.size(), 1);
-    return static_cast<int>(raw_chunks_.size() - 1);
-  }
-  // raw bytes
-  inline size_t RawBytes() const {
-    return raw_chunks_.back() * sizeof(DType);
+// LZ4 block compression of the bytes of an array.
+struct LZ4Codec {
+  template<typename DType>
+  inline static void Encode(const DType* data, size_t n, bool use_hc, std::string* out) {
+    int raw_size = static_cast<int>(n * sizeof(DType));
+    int bound = LZ4_compressBound(raw_size);
+    CHECK_NE(bound, 0);
+    out->resize(bound);
+    int encoded_size;
+    if (use_hc) {
+      encoded_size = LZ4_compress_HC(
+          reinterpret_cast<const char*>(data), dmlc::BeginPtr(*out),
+          raw_size, bound, 9);
+    } else {
+      encoded_size = LZ4_compress_default(
+          reinterpret_cast<const char*>(data), dmlc::BeginPtr(*out),
+          raw_size, bound);
+    }
+    CHECK_NE(encoded_size, 0);
+    CHECK_LE(encoded_size, bound);
+    out->resize(encoded_size);
   }
-  // encoded bytes
-  inline size_t EncodedBytes() const {
-    return encoded_chunks_.back() +
-        (encoded_chunks_.size() + raw_chunks_.size()) * sizeof(bst_uint);
+  template<typename DType>
+  inline static void Decode(const char* src, size_t encoded_size, DType* data, size_t n) {
+    int src_size = LZ4_decompress_fast(
+        src, reinterpret_cast<char*>(data), static_cast<int>(n * sizeof(DType)));
+    CHECK_EQ(static_cast<int>(encoded_size), src_size);
   }
-  // load the array from file.
-  inline void Read(dmlc::SeekStream* fi);
-  // run decode on chunk_id
-  inline void Decompress(int chunk_id);
-  // Compression helper
-  // initialize the compression chunks
-  inline void InitCompressChunks(const std::vector<bst_uint>& chunk_ptr);
-  // initialize the compression chunks
-  inline void InitCompressChunks(size_t chunk_size, size_t max_nchunk);
-  // run decode on chunk_id, level = -1 means default.
-  inline void Compress(int chunk_id, bool use_hc);
-  // save the output buffer into file.
-  inline void Write(dmlc::Stream* fo);
-
- private:
-  // the chunk split of the data, by number of elements
-  std::vector<bst_uint> raw_chunks_;
-  // the encoded chunk, by number of bytes
-  std::vector<bst_uint> encoded_chunks_;
-  // output buffer of compression.
-  std::vector<std::string> out_buffer_;
-  // input buffer of data.
-  std::string in_buffer_;
 };
 
-template<typename DType>
-inline void CompressArray<DType>::Read(dmlc::SeekStream* fi) {
-  CHECK(fi->Read(&raw_chunks_));
-  CHECK(fi->Read(&encoded_chunks_));
-  size_t buffer_size = encoded_chunks_.back();
-  in_buffer_.resize(buffer_size);
-  CHECK_EQ(fi->Read(dmlc::BeginPtr(in_buffer_), buffer_size), buffer_size);
-  data.resize(raw_chunks_.back());
-}
-
-template<typename DType>
-inline void CompressArray<DType>::Decompress(int chunk_id) {
-  int chunk_size = static_cast<int>(
-      raw_chunks_[chunk_id + 1] - raw_chunks_[chunk_id]) * sizeof(DType);
-  int encoded_size = static_cast<int>(
-      encoded_chunks_[chunk_id + 1] - encoded_chunks_[chunk_id]);
-  // decompress data
-  int src_size = LZ4_decompress_fast(
-      dmlc::BeginPtr(in_buffer_) + encoded_chunks_[chunk_id],
-      reinterpret_cast<char*>(dmlc::BeginPtr(data) + raw_chunks_[chunk_id]),
-      chunk_size);
-  CHECK_EQ(encoded_size, src_size);
-}
-
-template<typename DType>
-inline void CompressArray<DType>::InitCompressChunks(
-    const std::vector<bst_uint>& chunk_ptr) {
-  raw_chunks_ = chunk_ptr;
-  CHECK_GE(raw_chunks_.size(), 2);
-  out_buffer_.resize(raw_chunks_.size() - 1);
-  for (size_t i = 0; i < out_buffer_.size(); ++i) {
-    out_buffer_[i].resize(raw_chunks_[i + 1] - raw_chunks_[i]);
-  }
-}
-
-template<typename DType>
-inline void CompressArray<DType>::InitCompressChunks(size_t chunk_size, size_t max_nchunk) {
-  raw_chunks_.clear();
-  raw_chunks_.push_back(0);
-  size_t min_chunk_size = data.size() / max_nchunk;
-  chunk_size = std::max(min_chunk_size, chunk_size);
-  size_t nstep = data.size() / chunk_size;
-  for (size_t i = 0; i < nstep; ++i) {
-    raw_chunks_.push_back(raw_chunks_.back() + chunk_size);
-    CHECK_LE(raw_chunks_.back(), data.size());
-  }
-  if (nstep == 0) raw_chunks_.push_back(0);
-  raw_chunks_.back() = data.size();
-  CHECK_GE(raw_chunks_.size(), 2);
-  out_buffer_.resize(raw_chunks_.size() - 1);
-  for (size_t i = 0; i < out_buffer_.size(); ++i) {
-    out_buffer_[i].resize(raw_chunks_[i + 1] - raw_chunks_[i]);
-  }
-}
-
-template<typename DType>
-inline void CompressArray<DType>::Compress(int chunk_id, bool use_hc) {
-  CHECK_LT(static_cast<size_t>(chunk_id + 1), raw_chunks_.size());
-  std::string& buf = out_buffer_[chunk_id];
-  size_t raw_chunk_size = (raw_chunks_[chunk_id + 1] - raw_chunks_[chunk_id]) * sizeof(DType);
-  int bound = LZ4_compressBound(raw_chunk_size);
-  CHECK_NE(bound, 0);
-  buf.resize(bound);
-  int encoded_size;
-  if (use_hc) {
-    encoded_size = LZ4_compress_HC(
-        reinterpret_cast<char*>(dmlc::BeginPtr(data) + raw_chunks_[chunk_id]),
-        dmlc::BeginPtr(buf), raw_chunk_size, buf.length(), 9);
-  } else {
-    encoded_size = LZ4_compress_default(
-        reinterpret_cast<char*>(dmlc::BeginPtr(data) + raw_chunks_[chunk_id]),
-        dmlc::BeginPtr(buf), raw_chunk_size, buf.length());
-  }
-  CHECK_NE(encoded_size, 0);
-  CHECK_LE(static_cast<size_t>(encoded_size), buf.length());
-  buf.resize(encoded_size);
-}
-
-template<typename DType>
-inline void CompressArray<DType>::Write(dmlc::Stream* fo) {
-  encoded_chunks_.clear();
-  encoded_chunks_.push_back(0);
-  for (size_t i = 0; i < out_buffer_.size(); ++i) {
-    encoded_chunks_.push_back(encoded_chunks_.back() + out_buffer_[i].length());
-  }
-  fo->Write(raw_chunks_);
-  fo->Write(encoded_chunks_);
-  for (const std::string& buf : out_buffer_) {
-    fo->Write(dmlc::BeginPtr(buf), buf.length());
-  }
-}
-
-template<typename StorageIndex>
+template<typename StorageIndex, typename IndexCodec = LZ4Codec>
 class SparsePageLZ4Format : public SparsePage::Format {
  public:
+  // a page as stored in the file, and the buffers it is decompressed into.
+  struct EncodedPage : public SparsePage::Format::Encoded {
+    // offset of the segments
+    std::vector<size_t> offset;
+    // minimum index value
+    uint32_t min_index;
+    // index relative to min_index
+    CompressArray<StorageIndex, IndexCodec> index;
+    // value set.
+    CompressArray<bst_float, LZ4Codec> value;
+  };
+
   explicit SparsePageLZ4Format(bool use_lz4_hc)
       : use_lz4_hc_(use_lz4_hc) {
     raw_bytes_ = raw_bytes_value_ = raw_bytes_index_ = 0;
@@ -177,46 +83,88 @@ class SparsePageLZ4Format : public SparsePage::Format {
   }
 
   bool Read(SparsePage* page, dmlc::SeekStream* fi) override {
-    if (!fi->Read(&(page->offset))) return false;
-    CHECK_NE(page->offset.size(), 0) << "Invalid SparsePage file";
-    this->LoadIndexValue(fi);
-
-    page->data.resize(page->offset.back());
-    CHECK_EQ(index_.data.size(), value_.data.size());
-    CHECK_EQ(index_.data.size(), page->data.size());
-    for (size_t i = 0; i < page->data.size(); ++i) {
-      page->data[i] = SparseBatch::Entry(index_.data[i] + min_index_, value_.data[i]);
-    }
+    if (!this->ReadEncoded(&read_buffer_, fi)) return false;
+    this->Decode(&read_buffer_, page, nullptr);
     return true;
   }
 
   bool Read(SparsePage* page,
             dmlc::SeekStream* fi,
             const std::vector<bst_uint>& sorted_index_set) override {
-    if (!fi->Read(&disk_offset_)) return false;
-    this->LoadIndexValue(fi);
+    if (!this->ReadEncoded(&read_buffer_, fi)) return false;
+    this->Decode(&read_buffer_, page, &sorted_index_set);
+    return true;
+  }
+
+  Encoded* CreateEncoded() override {
+    return new EncodedPage();
+  }
+
+  bool ReadEncoded(Encoded* encoded, dmlc::SeekStream* fi) override {
+    EncodedPage* in = static_cast<EncodedPage*>(encoded);
+    if (!fi->Read(&(in->offset))) return false;
+    CHECK_NE(in->offset.size(), 0) << "Invalid SparsePage file";
+    CHECK_EQ(fi->Read(&(in->min_index), sizeof(in->min_index)), sizeof(in->min_index))
+        << "Invalid SparsePage file";
+    in->index.Read(fi);
+    in->value.Read(fi);
+    return true;
+  }
 
+  void Decode(Encoded* encoded, SparsePage* page,
+              const std::vector<bst_uint>* sorted_index_set) override {
+    EncodedPage* in = static_cast<EncodedPage*>(encoded);
+    // decompress all chunks of index and value at once
+    int nindex = in->index.num_chunk();
+    int nvalue = in->value.num_chunk();
+    int ntotal = nindex + nvalue;
+    #pragma omp parallel for schedule(dynamic, 1) num_threads(nthread_)
+    for (int i = 0; i < ntotal; ++i) {
+      if (i < nindex) {
+        in->index.Decompress(i);
+      } else {
+        in->value.Decompress(i - nindex);
+      }
+    }
+    CHECK_EQ(in->index.data.size(), in->value.data.size());
+    CHECK_EQ(in->index.data.size(), in->offset.back());
+    const StorageIndex* index = dmlc::BeginPtr(in->index.data);
+    const bst_float* value = dmlc::BeginPtr(in->value.data);
+    const bst_uint min_index = in->min_index;
+
+    if (sorted_index_set == nullptr) {
+      // the offset is read again with the next page
+      page->offset.swap(in->offset);
+      page->data.resize(page->offset.back());
+      SparseBatch::Entry* data = dmlc::BeginPtr(page->data);
+      const omp_ulong ndata = static_cast<omp_ulong>(page->data.size());
+      #pragma omp parallel for schedule(static) num_threads(nthread_)
+      for (omp_ulong i = 0; i < ndata; ++i) {
+        data[i] = SparseBatch::Entry(index[i] + min_index, value[i]);
+      }
+      return;
+    }
+    const std::vector<size_t>& disk_offset = in->offset;
     page->offset.clear();
     page->offset.push_back(0);
-    for (bst_uint cid : sorted_index_set) {
+    for (bst_uint cid : *sorted_index_set) {
       page->offset.push_back(
-          page->offset.back() + disk_offset_[cid + 1] - disk_offset_[cid]);
+          page->offset.back() + disk_offset[cid + 1] - disk_offset[cid]);
     }
     page->data.resize(page->offset.back());
-    CHECK_EQ(index_.data.size(), value_.data.size());
-    CHECK_EQ(index_.data.size(), disk_offset_.back());
-
-    for (size_t i = 0; i < sorted_index_set.size(); ++i) {
-      bst_uint cid = sorted_index_set[i];
+    SparseBatch::Entry* data = dmlc::BeginPtr(page->data);
+    const bst_omp_uint nsize = static_cast<bst_omp_uint>(sorted_index_set->size());
+    #pragma omp parallel for schedule(dynamic, 1) num_threads(nthread_)
+    for (bst_omp_uint i = 0; i < nsize; ++i) {
+      bst_uint cid = (*sorted_index_set)[i];
       size_t dst_begin = page->offset[i];
-      size_t src_begin = disk_offset_[cid];
-      size_t num = disk_offset_[cid + 1] - disk_offset_[cid];
+      size_t src_begin = disk_offset[cid];
+      size_t num = disk_offset[cid + 1] - disk_offset[cid];
       for (size_t j = 0; j < num; ++j) {
-        page->data[dst_begin + j] = SparseBatch::Entry(
-            index_.data[src_begin + j] + min_index_, value_.data[src_begin + j]);
+        data[dst_begin + j] = SparseBatch::Entry(
+            index[src_begin + j] + min_index, value[src_begin + j]);
       }
     }
-    return true;
   }
 
   void Write(const SparsePage& page, dmlc::Stream* fo) override {
@@ -262,24 +210,6 @@ class SparsePageLZ4Format : public SparsePage::Format {
     raw_bytes_ += page.offset.size() * sizeof(size_t);
   }
 
-  inline void LoadIndexValue(dmlc::SeekStream* fi) {
-    fi->Read(&min_index_, sizeof(min_index_));
-    index_.Read(fi);
-    value_.Read(fi);
-
-    int nindex = index_.num_chunk();
-    int nvalue = value_.num_chunk();
-    int ntotal = nindex + nvalue;
-    #pragma omp parallel for schedule(dynamic, 1) num_threads(nthread_)
-    for (int i = 0; i < ntotal; ++i) {
-      if (i < nindex) {
-        index_.Decompress(i);
-      } else {
-        value_.Decompress(i - nindex);
-      }
-    }
-  }
-
  private:
   // default chunk size.
   static const size_t kChunkSize = 64 << 10UL;
@@ -297,12 +227,12 @@ class SparsePageLZ4Format : public SparsePage::Format {
   size_t encoded_bytes_index_, encoded_bytes_value_;
   /*! \brief minimum index value */
   uint32_t min_index_;
-  /*! \brief external memory column offset */
-  std::vector<size_t> disk_offset_;
+  // page read by Read, when the reader does not use ReadEncoded
+  EncodedPage read_buffer_;
   // internal index
-  CompressArray<StorageIndex> index_;
+  CompressArray<StorageIndex, IndexCodec> index_;
   // value set.
-  CompressArray<bst_float> value_;
+  CompressArray<bst_float, LZ4Codec> value_;
 };
 
 XGBOOST_REGISTER_SPARSE_PAGE_FORMAT(lz4)
@@ -323,5 +253,11 @@ XGBOOST_REGISTER_SPARSE_PAGE_FORMAT(lz4i16hc)
     return new SparsePageLZ4Format<uint16_t>(true);
   });
 
+XGBOOST_REGISTER_SPARSE_PAGE_FORMAT(lz4delta)
+.describe("Apply delta and bit-packing to the index, LZ4 compression to the value for ext memory.")
+.set_body([]() {
+    return new SparsePageLZ4Format<bst_uint, DeltaBitPackCodec>(false);
+  });
+
 }  // namespace data
 }  // namespace xgboost
@@ -14,9 +14,12 @@
 
 #include "./c_api_error.h"
 #include "../data/simple_csr_source.h"
+#include "../data/dense_dmatrix.h"
+#include "../data/slice_dmatrix.h"
 #include "../common/math.h"
 #include "../common/io.h"
 #include "../common/group_data.h"
+#include "../gbm/row_predictor.h"
 
 namespace xgboost {
 // booster wrapper for backward compatible reason.
@@ -346,30 +349,32 @@ XGB_DLL int XGDMatrixCreateFromMat(const bst_float* data,
                                    xgboost::bst_ulong ncol,
                                    bst_float missing,
                                    DMatrixHandle* out) {
-  std::unique_ptr<data::SimpleCSRSource> source(new data::SimpleCSRSource());
-
   API_BEGIN();
-  data::SimpleCSRSource& mat = *source;
-  bool nan_missing = common::CheckNAN(missing);
-  mat.info.num_row = nrow;
-  mat.info.num_col = ncol;
-  for (xgboost::bst_ulong i = 0; i < nrow; ++i, data += ncol) {
-    xgboost::bst_ulong nelem = 0;
-    for (xgboost::bst_ulong j = 0; j < ncol; ++j) {
-      if (common::CheckNAN(data[j])) {
-        CHECK(nan_missing)
-            << "There are NAN in the matrix, however, you did not set missing=NAN";
-      } else {
-        if (nan_missing || data[j] != missing) {
-          mat.row_data_.push_back(RowBatch::Entry(j, data[j]));
-          ++nelem;
-        }
-      }
-    }
-    mat.row_ptr_.push_back(mat.row_ptr_.back() + nelem);
+  // mark missing cells and count entries of each row in parallel
+  std::unique_ptr<data::DenseSource> dense(
+      new data::DenseSource(data, static_cast<size_t>(nrow), static_cast<size_t>(ncol), missing));
+  // a copy of the values is smaller than CSR unless more than half of the cells are missing
+  const MetaInfo& info = dense->info;
+  if (info.num_nonzero * 2 >= info.num_row * info.num_col) {
+    dense->OwnData();
+    *out  = new std::shared_ptr<DMatrix>(new data::DenseDMatrix(dense.release()));
+  } else {
+    std::unique_ptr<data::SimpleCSRSource> source(new data::SimpleCSRSource());
+    dense->ToCSR(source.get());
+    *out  = new std::shared_ptr<DMatrix>(DMatrix::Create(std::move(source)));
   }
-  mat.info.num_nonzero = mat.row_data_.size();
-  *out  = new std::shared_ptr<DMatrix>(DMatrix::Create(std::move(source)));
+  API_END();
+}
+
+XGB_DLL int XGDMatrixCreateFromMatRef(const bst_float* data,
+                                      xgboost::bst_ulong nrow,
+                                      xgboost::bst_ulong ncol,
+                                      bst_float missing,
+                                      DMatrixHandle* out) {
+  API_BEGIN();
+  // data is referenced, not copied, and must outlive the DMatrix
+  *out  = new std::shared_ptr<DMatrix>(new data::DenseDMatrix(
+      new data::DenseSource(data, static_cast<size_t>(nrow), static_cast<size_t>(ncol), missing)));
   API_END();
 }
 
@@ -377,49 +382,15 @@ XGB_DLL int XGDMatrixSliceDMatrix(DMatrixHandle handle,
                                   const int* idxset,
                                   xgboost::bst_ulong len,
                                   DMatrixHandle* out) {
-  std::unique_ptr<data::SimpleCSRSource> source(new data::SimpleCSRSource());
-
   API_BEGIN();
-  data::SimpleCSRSource src;
-  src.CopyFrom(static_cast<std::shared_ptr<DMatrix>*>(handle)->get());
-  data::SimpleCSRSource& ret = *source;
-
-  CHECK_EQ(src.info.group_ptr.size(), 0U)
-      << "slice does not support group structure";
-
-  ret.Clear();
-  ret.info.num_row = len;
-  ret.info.num_col = src.info.num_col;
-
-  dmlc::DataIter<RowBatch>* iter = &src;
-  iter->BeforeFirst();
-  CHECK(iter->Next());
-
-  const RowBatch& batch = iter->Value();
+  // the slice is a view sharing the parent, so nothing is copied here
+  std::vector<bst_uint> ridx(len);
   for (xgboost::bst_ulong i = 0; i < len; ++i) {
-    const int ridx = idxset[i];
-    RowBatch::Inst inst = batch[ridx];
-    CHECK_LT(static_cast<xgboost::bst_ulong>(ridx), batch.size);
-    ret.row_data_.resize(ret.row_data_.size() + inst.length);
-    std::memcpy(dmlc::BeginPtr(ret.row_data_) + ret.row_ptr_.back(), inst.data,
-                sizeof(RowBatch::Entry) * inst.length);
-    ret.row_ptr_.push_back(ret.row_ptr_.back() + inst.length);
-    ret.info.num_nonzero += inst.length;
-
-    if (src.info.labels.size() != 0) {
-      ret.info.labels.push_back(src.info.labels[ridx]);
-    }
-    if (src.info.weights.size() != 0) {
-      ret.info.weights.push_back(src.info.weights[ridx]);
-    }
-    if (src.info.base_margin.size() != 0) {
-      ret.info.base_margin.push_back(src.info.base_margin[ridx]);
-    }
-    if (src.info.root_index.size() != 0) {
-      ret.info.root_index.push_back(src.info.root_index[ridx]);
-    }
+    CHECK_GE(idxset[i], 0) << "slice index out of range";
+    ridx[i] = static_cast<bst_uint>(idxset[i]);
   }
-  *out = new std::shared_ptr<DMatrix>(DMatrix::Create(std::move(source)));
+  *out = new std::shared_ptr<DMatrix>(
+      new data::SliceDMatrix(*static_cast<std::shared_ptr<DMatrix>*>(handle), std::move(ridx)));
   API_END();
 }
 
@@ -628,6 +599,61 @@ XGB_DLL int XGBoosterPredict(BoosterHandle handle,
   API_END();
 }
 
+XGB_DLL int XGBoosterCreateRowPredictor(BoosterHandle handle,
+                                        void** out) {
+  API_BEGIN();
+  Booster *bst = static_cast<Booster*>(handle);
+  bst->LazyInit();
+  *out = CreateRowPredictor(bst->learner());
+  API_END();
+}
+
+XGB_DLL int XGRowPredictorFree(void* handle) {
+  API_BEGIN();
+  delete static_cast<gbm::RowPredictor*>(handle);
+  API_END();
+}
+
+XGB_DLL int XGRowPredictorNumOutput(void* handle,
+                                    xgboost::bst_ulong* out) {
+  API_BEGIN();
+  *out = static_cast<xgboost::bst_ulong>(
+      static_cast<gbm::RowPredictor*>(handle)->NumOutput());
+  API_END();
+}
+
+XGB_DLL int XGRowPredictorCreateScratch(void* handle,
+                                        void** out) {
+  API_BEGIN();
+  *out = new gbm::RowPredictor::Scratch(*static_cast<gbm::RowPredictor*>(handle));
+  API_END();
+}
+
+XGB_DLL int XGRowPredictorFreeScratch(void* scratch) {
+  API_BEGIN();
+  delete static_cast<gbm::RowPredictor::Scratch*>(scratch);
+  API_END();
+}
+
+XGB_DLL int XGRowPredictorPredict(void* handle,
+                                  void* scratch,
+                                  const bst_float* row,
+                                  xgboost::bst_ulong ncol,
+                                  bst_float missing,
+                                  int option_mask,
+                                  unsigned ntree_limit,
+                                  xgboost::bst_ulong* out_len,
+                                  bst_float* out_result) {
+  API_BEGIN();
+  CHECK_EQ(option_mask & 2, 0) << "Row predictor does not support pred_leaf";
+  const gbm::RowPredictor* predictor = static_cast<gbm::RowPredictor*>(handle);
+  *out_len = static_cast<xgboost::bst_ulong>(
+      predictor->Predict(row, static_cast<size_t>(ncol), missing,
+                         (option_mask & 1) != 0, ntree_limit,
+                         static_cast<gbm::RowPredictor::Scratch*>(scratch), out_result));
+  API_END();
+}
+
 XGB_DLL int XGBoosterLoadModel(BoosterHandle handle, const char* fname) {
   API_BEGIN();
   std::unique_ptr<dmlc::Stream> fi(dmlc::Stream::Create(fname, "r"));
@@ -8,23 +8,6 @@
 #ifndef XGBOOST_COMMON_COLUMN_MATRIX_H_
 #define XGBOOST_COMMON_COLUMN_MATRIX_H_
 
-#define XGBOOST_TYPE_SWITCH(dtype, OP)        \
-switch (dtype) {                \
-  case xgboost::common::uint32 : {           \
-    typedef uint32_t DType;         \
-    OP; break;              \
-  }               \
-  case xgboost::common::uint16 : {           \
-    typedef uint16_t DType;         \
-    OP; break;              \
-  }               \
-  case xgboost::common::uint8 : {            \
-    typedef uint8_t DType;          \
-    OP; break;              \
-    default: LOG(FATAL) << "don't recognize type flag" << dtype;  \
-  }               \
-}
-
 #include <type_traits>
 #include <limits>
 #include <vector>
@@ -33,13 +16,6 @@ switch (dtype) {                \
 namespace xgboost {
 namespace common {
 
-/*! \brief indicator of data type used for storing bin id's in a column. */
-enum DataType {
-  uint8 = 1,
-  uint16 = 2,
-  uint32 = 4
-};
-
 /*! \brief column type */
 enum ColumnType {
   kDenseColumn,
@@ -149,11 +125,10 @@ class ColumnMatrix {
     num_nonzeros.resize(nfeature);
     std::fill(num_nonzeros.begin(), num_nonzeros.end(), 0);
     for (uint32_t rid = 0; rid < nrow; ++rid) {
-      const size_t ibegin = static_cast<size_t>(gmat.row_ptr[rid]);
-      const size_t iend = static_cast<size_t>(gmat.row_ptr[rid + 1]);
+      const unsigned len = gmat.RowSize(rid);
       size_t fid = 0;
-      for (size_t i = ibegin; i < iend; ++i) {
-        const size_t bin_id = gmat.index[i];
+      for (unsigned i = 0; i < len; ++i) {
+        const size_t bin_id = gmat.GetGlobalBin(rid, i);
         while (bin_id >= gmat.cut->row_ptr[fid + 1]) {
           ++fid;
         }
@@ -0,0 +1,173 @@
+/*!
+ * Copyright 2017 by Contributors
+ * \file hist_cache.cc
+ * \brief On-disk cache of cuts and quantized feature index
+ */
+#include <dmlc/omp.h>
+#include <xgboost/logging.h>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include "./hist_cache.h"
+#include "./io.h"
+
+namespace xgboost {
+namespace common {
+
+const uint64_t HistCache::kMagic;
+const int HistCache::kVersion;
+
+namespace {
+// finalizer of splitmix64; cheap mixing with good avalanche
+inline uint64_t Mix64(uint64_t x) {
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+inline uint64_t FloatBits(bst_float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+}  // namespace
+
+uint64_t HistCache::Fingerprint(DMatrix* p_fmat, int max_bin) {
+  const MetaInfo& info = p_fmat->info();
+  const bool has_weight = info.weights.size() != 0;
+  // hashes of rows are summed up, so that rows may be visited in any order
+  uint64_t sum = 0;
+  dmlc::DataIter<RowBatch>* iter = p_fmat->RowIterator();
+  iter->BeforeFirst();
+  while (iter->Next()) {
+    const RowBatch& batch = iter->Value();
+    const bst_omp_uint nsize = static_cast<bst_omp_uint>(batch.size);
+    uint64_t batch_sum = 0;
+    #pragma omp parallel for schedule(static) reduction(+:batch_sum)
+    for (bst_omp_uint i = 0; i < nsize; ++i) {
+      const size_t ridx = batch.base_rowid + i;
+      RowBatch::Inst inst = batch[i];
+      uint64_t h = Mix64(ridx);
+      for (bst_uint j = 0; j < inst.length; ++j) {
+        h = Mix64(h ^ (static_cast<uint64_t>(inst[j].index) << 32 | FloatBits(inst[j].fvalue)));
+      }
+      if (has_weight) {
+        h = Mix64(h ^ FloatBits(info.weights[ridx]));
+      }
+      batch_sum += h;
+    }
+    sum += batch_sum;
+  }
+  uint64_t h = Mix64(sum);
+  h = Mix64(h ^ info.num_row);
+  h = Mix64(h ^ info.num_col);
+  h = Mix64(h ^ info.num_nonzero);
+  return Mix64(h ^ static_cast<uint64_t>(max_bin));
+}
+
+bool HistCache::Load(const std::string& fname, uint64_t fingerprint,
+                     HistCutMatrix* hmat, GHistIndexMatrix* gmat) {
+  {
+    std::unique_ptr<dmlc::Stream> fi(dmlc::Stream::Create(fname.c_str(), "r", true));
+    if (fi == nullptr) return false;
+  }
+  std::shared_ptr<MMapFile> map(new MMapFile(fname));
+  uint64_t header_size;
+  if (map->size() < sizeof(header_size)) return false;
+  std::memcpy(&header_size, map->data(), sizeof(header_size));
+  const size_t index_offset = (sizeof(header_size) + header_size + 7) / 8 * 8;
+  if (index_offset > map->size()) return false;
+
+  MemoryFixSizeBuffer header(const_cast<char*>(map->data()) + sizeof(header_size),
+                             header_size);
+  dmlc::Stream* fs = &header;
+  uint64_t magic, fp;
+  int version;
+  if (fs->Read(&magic, sizeof(magic)) != sizeof(magic) || magic != kMagic) {
+    LOG(WARNING) << fname << " is not a hist cache file, it will be overwritten";
+    return false;
+  }
+  CHECK_EQ(fs->Read(&version, sizeof(version)), sizeof(version)) << "invalid hist cache";
+  if (version != kVersion) return false;
+  CHECK_EQ(fs->Read(&fp, sizeof(fp)), sizeof(fp)) << "invalid hist cache";
+  if (fp != fingerprint) return false;
+
+  CHECK(fs->Read(&hmat->row_ptr)) << "invalid hist cache";
+  CHECK(fs->Read(&hmat->min_val)) << "invalid hist cache";
+  CHECK(fs->Read(&hmat->cut)) << "invalid hist cache";
+  int dtype, dense;
+  uint64_t nslot;
+  CHECK_EQ(fs->Read(&dtype, sizeof(dtype)), sizeof(dtype)) << "invalid hist cache";
+  CHECK_EQ(fs->Read(&dense, sizeof(dense)), sizeof(dense)) << "invalid hist cache";
+  CHECK_EQ(fs->Read(&gmat->row_stride, sizeof(gmat->row_stride)), sizeof(gmat->row_stride))
+      << "invalid hist cache";
+  CHECK(fs->Read(&gmat->index_base)) << "invalid hist cache";
+  CHECK(fs->Read(&gmat->row_ptr)) << "invalid hist cache";
+  CHECK(fs->Read(&gmat->hit_count)) << "invalid hist cache";
+  CHECK_EQ(fs->Read(&nslot, sizeof(nslot)), sizeof(nslot)) << "invalid hist cache";
+  CHECK_EQ(index_offset + nslot * sizeof(uint32_t), map->size()) << "truncated hist cache";
+
+  gmat->base_rowid = 0;
+  gmat->index_dtype = static_cast<DataType>(dtype);
+  gmat->is_dense = (dense != 0);
+  gmat->cut = hmat;
+  gmat->index_.clear();
+  gmat->index_map_ = map;
+  gmat->index_mapped_ = reinterpret_cast<const uint32_t*>(map->data() + index_offset);
+  return true;
+}
+
+void HistCache::Save(const std::string& fname, uint64_t fingerprint,
+                     const HistCutMatrix& hmat, const GHistIndexMatrix& gmat) {
+  CHECK_EQ(gmat.base_rowid, 0U) << "cannot cache a page of an index";
+  CHECK(gmat.index_mapped_ == nullptr) << "index is already cached";
+  std::string header;
+  {
+    MemoryBufferStream buffer(&header);
+    dmlc::Stream* fs = &buffer;
+    const uint64_t magic = kMagic;
+    const int version = kVersion;
+    const int dtype = static_cast<int>(gmat.index_dtype);
+    const int dense = gmat.is_dense ? 1 : 0;
+    const uint64_t nslot = gmat.index_.size();
+    fs->Write(&magic, sizeof(magic));
+    fs->Write(&version, sizeof(version));
+    fs->Write(&fingerprint, sizeof(fingerprint));
+    fs->Write(hmat.row_ptr);
+    fs->Write(hmat.min_val);
+    fs->Write(hmat.cut);
+    fs->Write(&dtype, sizeof(dtype));
+    fs->Write(&dense, sizeof(dense));
+    fs->Write(&gmat.row_stride, sizeof(gmat.row_stride));
+    fs->Write(gmat.index_base);
+    fs->Write(gmat.row_ptr);
+    fs->Write(gmat.hit_count);
+    fs->Write(&nslot, sizeof(nslot));
+  }
+  const uint64_t header_size = header.length();
+  const size_t npad = (8 - (sizeof(header_size) + header.length()) % 8) % 8;
+  const char padding[8] = {0};
+
+  // write to a temporary file that replaces the cache once complete, so that a
+  // cache mapped by another process is never overwritten in place
+  const std::string tmp_name = fname + ".tmp";
+  {
+    std::unique_ptr<dmlc::Stream> fo(dmlc::Stream::Create(tmp_name.c_str(), "w"));
+    fo->Write(&header_size, sizeof(header_size));
+    fo->Write(header.data(), header.length());
+    fo->Write(padding, npad);
+    if (gmat.index_.size() != 0) {
+      fo->Write(dmlc::BeginPtr(gmat.index_), gmat.index_.size() * sizeof(uint32_t));
+    }
+  }
+#ifdef _WIN32
+  std::remove(fname.c_str());
+#endif
+  CHECK_EQ(std::rename(tmp_name.c_str(), fname.c_str()), 0) << "Failed to write " << fname;
+}
+
+}  // namespace common
+}  // namespace xgboost
@@ -0,0 +1,54 @@
+/*!
+ * Copyright 2017 by Contributors
+ * \file hist_cache.h
+ * \brief On-disk cache of cuts and quantized feature index, for tree_method=hist
+ */
+#ifndef XGBOOST_COMMON_HIST_CACHE_H_
+#define XGBOOST_COMMON_HIST_CACHE_H_
+
+#include <xgboost/data.h>
+#include <string>
+#include "hist_util.h"
+
+namespace xgboost {
+namespace common {
+
+/*!
+ * \brief binary cache of the cuts and quantized index of a DMatrix, which saves
+ *  sketching and quantization when training again on the same data.
+ *
+ *  The file is made of a header, holding the cuts and everything in the index but
+ *  the bin id's, followed by the bin id's, aligned so that they are used in place
+ *  through a memory mapping of the file rather than read into memory:
+ *  \code
+ *  [uint64 header size][header][padding to 8 bytes][bin id's]
+ *  \endcode
+ *  A cache is keyed on a fingerprint of the data and the number of bins, and is
+ *  ignored if either differs.
+ */
+class HistCache {
+ public:
+  /*! \brief magic number leading the header */
+  static const uint64_t kMagic = 0x65686361436d6748ULL;
+  /*! \brief version of the file format, to be bumped on any change of layout */
+  static const int kVersion = 1;
+  /*!
+   * \brief compute a fingerprint of the content of p_fmat, i.e. its shape, feature
+   *  values and weights, together with the number of bins
+   */
+  static uint64_t Fingerprint(DMatrix* p_fmat, int max_bin);
+  /*!
+   * \brief load cuts and index from a cache file
+   * \return false if the file does not exist, or was made for other data or
+   *  an older version
+   */
+  static bool Load(const std::string& fname, uint64_t fingerprint,
+                   HistCutMatrix* hmat, GHistIndexMatrix* gmat);
+  /*! \brief save cuts and index to a cache file, replacing any existing one */
+  static void Save(const std::string& fname, uint64_t fingerprint,
+                   const HistCutMatrix& hmat, const GHistIndexMatrix& gmat);
+};
+
+}  // namespace common
+}  // namespace xgboost
+#endif  // XGBOOST_COMMON_HIST_CACHE_H_
@@ -0,0 +1,100 @@
+/*!
+ * Copyright 2017 by Contributors
+ * \file hist_page.cc
+ * \brief External memory storage of quantized feature index
+ */
+#include <dmlc/base.h>
+#include <dmlc/timer.h>
+#include <xgboost/logging.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if DMLC_ENABLE_STD_THREAD
+#include <dmlc/threadediter.h>
+#endif
+
+#include "./hist_page.h"
+#include "./common.h"
+
+namespace xgboost {
+namespace common {
+
+GHistIndexPages::GHistIndexPages() : num_pages_(0), page_(nullptr) {}
+
+GHistIndexPages::~GHistIndexPages() {
+  prefetcher_.reset();
+  delete page_;
+}
+
+#if DMLC_ENABLE_STD_THREAD
+void GHistIndexPages::Init(DMatrix* p_fmat,
+                           const HistCutMatrix* cut,
+                           const std::string& cache_prefix) {
+  // stop reading any previous pages before overwriting the file
+  prefetcher_.reset();
+  fi_.reset(nullptr);
+  delete page_;
+  page_ = nullptr;
+
+  std::vector<std::string> cache_shards = common::Split(cache_prefix, ':');
+  CHECK_NE(cache_shards.size(), 0U);
+  const std::string name_page = cache_shards[0] + ".gmat.page";
+  {
+    std::unique_ptr<dmlc::Stream> fo(dmlc::Stream::Create(name_page.c_str(), "w"));
+    GHistIndexMatrix page;
+    page.cut = cut;
+    num_pages_ = 0;
+    double tstart = dmlc::GetTime();
+    dmlc::DataIter<RowBatch>* iter = p_fmat->RowIterator();
+    iter->BeforeFirst();
+    while (iter->Next()) {
+      page.InitPage(iter->Value(), p_fmat->info());
+      page.Save(fo.get());
+      ++num_pages_;
+    }
+    LOG(INFO) << "GHistIndexPages: Finished writing " << num_pages_ << " pages to "
+              << name_page << " in " << dmlc::GetTime() - tstart << " sec";
+  }
+
+  fi_.reset(dmlc::SeekStream::CreateForRead(name_page.c_str()));
+  dmlc::SeekStream* fi = fi_.get();
+  prefetcher_.reset(new dmlc::ThreadedIter<GHistIndexMatrix>(4));
+  prefetcher_->Init([fi, cut] (GHistIndexMatrix** dptr) {
+      if (*dptr == nullptr) {
+        *dptr = new GHistIndexMatrix();
+      }
+      (*dptr)->cut = cut;
+      return (*dptr)->Load(fi);
+    }, [fi] () { fi->Seek(0); });
+}
+
+void GHistIndexPages::BeforeFirst() {
+  prefetcher_->BeforeFirst();
+}
+
+bool GHistIndexPages::Next() {
+  if (page_ != nullptr) {
+    prefetcher_->Recycle(&page_);
+  }
+  return prefetcher_->Next(&page_);
+}
+#else
+void GHistIndexPages::Init(DMatrix* p_fmat,
+                           const HistCutMatrix* cut,
+                           const std::string& cache_prefix) {
+  LOG(FATAL) << "External memory is not enabled in this build";
+}
+
+void GHistIndexPages::BeforeFirst() {
+  LOG(FATAL) << "External memory is not enabled in this build";
+}
+
+bool GHistIndexPages::Next() {
+  LOG(FATAL) << "External memory is not enabled in this build";
+  return false;
+}
+#endif  // DMLC_ENABLE_STD_THREAD
+
+}  // namespace common
+}  // namespace xgboost
@@ -0,0 +1,73 @@
+/*!
+ * Copyright 2017 by Contributors
+ * \file hist_page.h
+ * \brief External memory storage of quantized feature index, for tree_method=hist
+ */
+#ifndef XGBOOST_COMMON_HIST_PAGE_H_
+#define XGBOOST_COMMON_HIST_PAGE_H_
+
+#include <dmlc/io.h>
+#include <memory>
+#include <string>
+#include "hist_util.h"
+
+namespace dmlc {
+template<typename DType>
+class ThreadedIter;
+}  // namespace dmlc
+
+namespace xgboost {
+namespace common {
+
+/*!
+ * \brief quantized index of an external memory DMatrix, stored as a sequence of
+ *  GHistIndexMatrix pages, one for each row batch. The pages are written to
+ *  <cache_prefix>.gmat.page, next to the row pages, and read back through a
+ *  prefetcher, so that only a few pages are held in memory at any time.
+ * \code
+ * pages.BeforeFirst();
+ * while (pages.Next()) {
+ *   const GHistIndexMatrix& page = pages.Value();
+ *   // page holds rows [page.base_rowid, page.base_rowid + page.row_ptr.size() - 1)
+ * }
+ * \endcode
+ */
+class GHistIndexPages {
+ public:
+  GHistIndexPages();
+  ~GHistIndexPages();
+  /*!
+   * \brief build index pages for all rows of p_fmat and write them to disk
+   * \param p_fmat the external memory matrix
+   * \param cut the cuts used to quantize feature values
+   * \param cache_prefix the cache prefix of p_fmat
+   */
+  void Init(DMatrix* p_fmat, const HistCutMatrix* cut, const std::string& cache_prefix);
+  /*! \brief rewind to the first page */
+  void BeforeFirst();
+  /*! \brief move to the next page, return false if there are no more pages */
+  bool Next();
+  /*! \brief the current page */
+  inline const GHistIndexMatrix& Value() const {
+    return *page_;
+  }
+  /*! \brief number of pages */
+  inline size_t Size() const {
+    return num_pages_;
+  }
+
+ private:
+  /*! \brief number of pages */
+  size_t num_pages_;
+  /*! \brief page currently on hold */
+  GHistIndexMatrix* page_;
+  /*! \brief file pointer to the page file */
+  std::unique_ptr<dmlc::SeekStream> fi_;
+  /*! \brief internal prefetcher; held by shared_ptr, which allows the type to stay
+   *  incomplete in builds without std::thread */
+  std::shared_ptr<dmlc::ThreadedIter<GHistIndexMatrix> > prefetcher_;
+};
+
+}  // namespace common
+}  // namespace xgboost
+#endif  // XGBOOST_COMMON_HIST_PAGE_H_
@@ -5,68 +5,221 @@
  * \author Philip Cho, Tianqi Chen
  */
 #include <dmlc/omp.h>
+#include <algorithm>
+#include <deque>
+#include <limits>
+#include <numeric>
 #include <vector>
 #include "./sync.h"
 #include "./hist_util.h"
 #include "./column_matrix.h"
 #include "./quantile.h"
+#include "../data/dense_dmatrix.h"
 
 namespace xgboost {
 namespace common {
 
+namespace {
+typedef WXQuantileSketch<bst_float, bst_float> WXQSketch;
+
+/*!
+ * \brief sketches of the columns [begin, end) that have entries in a row block,
+ *  each created on the first entry of its column
+ */
+class ColumnSketchs {
+ public:
+  ColumnSketchs(unsigned begin, unsigned end, size_t maxn, double eps)
+      : begin_(begin), slot_(end - begin, 0), maxn_(maxn), eps_(eps) {}
+  /*! \brief get the sketch of column fid, creating it if needed */
+  inline WXQSketch& operator[](unsigned fid) {
+    unsigned& slot = slot_[fid - begin_];
+    if (slot == 0) {
+      sketchs_.emplace_back();
+      sketchs_.back().Init(maxn_, eps_);
+      slot = static_cast<unsigned>(sketchs_.size());
+    }
+    return sketchs_[slot - 1];
+  }
+  /*! \return the sketch of column fid, nullptr if it has no entry */
+  inline WXQSketch* Find(unsigned fid) {
+    const unsigned slot = slot_[fid - begin_];
+    return slot == 0 ? nullptr : &sketchs_[slot - 1];
+  }
+
+ private:
+  unsigned begin_;
+  /*! \brief position of the sketch of each column plus one, 0 if absent */
+  std::vector<unsigned> slot_;
+  /*! \brief sketches in order of creation, a deque keeps them in place as they grow */
+  std::deque<WXQSketch> sketchs_;
+  size_t maxn_;
+  double eps_;
+};
+
+/*!
+ * \brief split columns into ngroup contiguous groups holding about the same number of
+ *  entries, as estimated from a sample of rows of the first batch
+ * \return group pointer, where group i covers columns [ptr[i], ptr[i + 1])
+ */
+std::vector<unsigned> BalanceColumnGroups(DMatrix* p_fmat, unsigned ngroup) {
+  const unsigned ncol = static_cast<unsigned>(p_fmat->info().num_col);
+  std::vector<unsigned> group_ptr(ngroup + 1, ncol);
+  group_ptr[0] = 0;
+  if (ngroup == 1) return group_ptr;
+
+  // start from one entry per column, so that columns absent from the sample still count
+  std::vector<size_t> col_size(ncol, 1);
+  dmlc::DataIter<RowBatch>* iter = p_fmat->RowIterator();
+  iter->BeforeFirst();
+  if (iter->Next()) {
+    const RowBatch& batch = iter->Value();
+    const size_t kMaxSample = 1 << 16;
+    const size_t stride = std::max(static_cast<size_t>(1), batch.size / kMaxSample);
+    for (size_t i = 0; i < batch.size; i += stride) {
+      RowBatch::Inst inst = batch[i];
+      for (bst_uint j = 0; j < inst.length; ++j) {
+        ++col_size[inst[j].index];
+      }
+    }
+  }
+  const size_t total = std::accumulate(col_size.begin(), col_size.end(), static_cast<size_t>(0));
+  size_t psum = 0;
+  unsigned gid = 1;
+  for (unsigned fid = 0; fid < ncol && gid < ngroup; ++fid) {
+    psum += col_size[fid];
+    while (gid < ngroup && psum * ngroup >= total * gid) {
+      group_ptr[gid++] = fid + 1;
+    }
+  }
+  return group_ptr;
+}
+}  // namespace
+
 void HistCutMatrix::Init(DMatrix* p_fmat, size_t max_num_bins) {
-  typedef common::WXQuantileSketch<bst_float, bst_float> WXQSketch;
   const MetaInfo& info = p_fmat->info();
 
   // safe factor for better accuracy
   const int kFactor = 8;
-  std::vector<WXQSketch> sketchs;
-
   const int nthread = omp_get_max_threads();
+  const unsigned ncol = static_cast<unsigned>(info.num_col);
+
+  /* The rows are split into nblock row blocks and the columns into ngroup column groups.
+     Each (block, group) task sketches the entries of its row block that fall into its
+     column group; sketches of all row blocks are merged in the end. A task creates the
+     sketches of the columns its rows touch only, so sketches take no more memory than
+     the entries, and the columns of a task cost one slot each. Row blocks are preferred
+     while the slots of all blocks are no more than the entries; past that, as for few
+     rows of many columns, column groups make up the parallelism at the cost of scanning
+     the entries once per group. */
+  const size_t nnz = static_cast<size_t>(info.num_nonzero);
+  const unsigned nblock = static_cast<unsigned>(
+      std::max(std::min(static_cast<size_t>(nthread), nnz / std::max(ncol, 1U)),
+               static_cast<size_t>(1)));
+  const unsigned ngroup = std::max(static_cast<unsigned>(nthread) / nblock, 1U);
+  const std::vector<unsigned> group_ptr = BalanceColumnGroups(p_fmat, ngroup);
 
-  unsigned nstep = (info.num_col + nthread - 1) / nthread;
-  unsigned ncol = static_cast<unsigned>(info.num_col);
-  sketchs.resize(info.num_col);
-  for (auto& s : sketchs) {
-    s.Init(info.num_row, 1.0 / (max_num_bins * kFactor));
+  // task gid * nblock + bid holds the sketches of row block bid and column group gid
+  const bst_omp_uint ntask = static_cast<bst_omp_uint>(nblock * ngroup);
+  std::vector<ColumnSketchs> tasks;
+  tasks.reserve(ntask);
+  for (unsigned gid = 0; gid < ngroup; ++gid) {
+    for (unsigned bid = 0; bid < nblock; ++bid) {
+      tasks.emplace_back(group_ptr[gid], group_ptr[gid + 1],
+                         info.num_row, 1.0 / (max_num_bins * kFactor));
+    }
   }
 
-  dmlc::DataIter<RowBatch>* iter = p_fmat->RowIterator();
-  iter->BeforeFirst();
-  while (iter->Next()) {
-    const RowBatch& batch = iter->Value();
-    #pragma omp parallel num_threads(nthread)
-    {
-      CHECK_EQ(nthread, omp_get_num_threads());
-      unsigned tid = static_cast<unsigned>(omp_get_thread_num());
-      unsigned begin = std::min(nstep * tid, ncol);
-      unsigned end = std::min(nstep * (tid + 1), ncol);
-      for (size_t i = 0; i < batch.size; ++i) { // NOLINT(*)
-        bst_uint ridx = static_cast<bst_uint>(batch.base_rowid + i);
-        RowBatch::Inst inst = batch[i];
-        for (bst_uint j = 0; j < inst.length; ++j) {
-          if (inst[j].index >= begin && inst[j].index < end) {
-            sketchs[inst[j].index].Push(inst[j].fvalue, info.GetWeight(ridx));
+  std::vector<size_t> block_ptr(nblock + 1);
+  const data::DenseDMatrix* dense = dynamic_cast<const data::DenseDMatrix*>(p_fmat);
+  if (dense != nullptr) {
+    // read dense values in place; rows hold about the same number of entries
+    const data::DenseSource& src = dense->Dense();
+    for (unsigned i = 0; i <= nblock; ++i) {
+      block_ptr[i] = src.NumRow() * i / nblock;
+    }
+    #pragma omp parallel for schedule(dynamic) num_threads(nthread)
+    for (bst_omp_uint t = 0; t < ntask; ++t) {
+      const unsigned bid = t % nblock;
+      const unsigned gid = t / nblock;
+      const unsigned begin = group_ptr[gid];
+      const unsigned end = group_ptr[gid + 1];
+      ColumnSketchs& sketchs = tasks[t];
+      for (size_t i = block_ptr[bid]; i < block_ptr[bid + 1]; ++i) {
+        const bst_float* row = src.Row(i);
+        const bst_float weight = info.GetWeight(i);
+        for (unsigned fid = begin; fid < end; ++fid) {
+          if (!src.IsMissing(i, fid)) {
+            sketchs[fid].Push(row[fid], weight);
+          }
+        }
+      }
+    }
+  } else {
+    dmlc::DataIter<RowBatch>* iter = p_fmat->RowIterator();
+    iter->BeforeFirst();
+    while (iter->Next()) {
+      const RowBatch& batch = iter->Value();
+      // split rows into blocks holding about the same number of entries
+      const size_t batch_nnz = batch.ind_ptr[batch.size] - batch.ind_ptr[0];
+      for (unsigned i = 0; i <= nblock; ++i) {
+        const size_t target = batch.ind_ptr[0] + batch_nnz * i / nblock;
+        block_ptr[i] = std::lower_bound(batch.ind_ptr, batch.ind_ptr + batch.size + 1, target)
+            - batch.ind_ptr;
+      }
+      block_ptr[nblock] = batch.size;
+
+      #pragma omp parallel for schedule(dynamic) num_threads(nthread)
+      for (bst_omp_uint t = 0; t < ntask; ++t) {
+        const unsigned bid = t % nblock;
+        const unsigned gid = t / nblock;
+        const unsigned begin = group_ptr[gid];
+        const unsigned end = group_ptr[gid + 1];
+        ColumnSketchs& sketchs = tasks[t];
+        for (size_t i = block_ptr[bid]; i < block_ptr[bid + 1]; ++i) {
+          bst_uint ridx = static_cast<bst_uint>(batch.base_rowid + i);
+          RowBatch::Inst inst = batch[i];
+          for (bst_uint j = 0; j < inst.length; ++j) {
+            if (inst[j].index >= begin && inst[j].index < end) {
+              sketchs[inst[j].index].Push(inst[j].fvalue, info.GetWeight(ridx));
+            }
           }
         }
       }
     }
   }
 
-  // gather the histogram data
+  // merge sketches of all row blocks, then gather the histogram data
   rabit::SerializeReducer<WXQSketch::SummaryContainer> sreducer;
-  std::vector<WXQSketch::SummaryContainer> summary_array;
-  summary_array.resize(sketchs.size());
-  for (size_t i = 0; i < sketchs.size(); ++i) {
-    WXQSketch::SummaryContainer out;
-    sketchs[i].GetSummary(&out);
-    summary_array[i].Reserve(max_num_bins * kFactor);
-    summary_array[i].SetPrune(out, max_num_bins * kFactor);
+  std::vector<WXQSketch::SummaryContainer> summary_array(ncol);
+  #pragma omp parallel num_threads(nthread)
+  {
+    WXQSketch::SummaryContainer out, buf[2];
+    #pragma omp for schedule(dynamic)
+    for (bst_omp_uint fid = 0; fid < ncol; ++fid) {
+      const unsigned gid = static_cast<unsigned>(
+          std::upper_bound(group_ptr.begin(), group_ptr.end(), fid) - group_ptr.begin() - 1);
+      WXQSketch::SummaryContainer* merged = &buf[0];
+      WXQSketch::SummaryContainer* temp = &buf[1];
+      merged->size = 0;
+      for (unsigned bid = 0; bid < nblock; ++bid) {
+        WXQSketch* sketch = tasks[gid * nblock + bid].Find(fid);
+        if (sketch == nullptr) continue;
+        sketch->GetSummary(&out);
+        temp->Reserve(merged->size + out.size);
+        temp->SetCombine(*merged, out);
+        std::swap(merged, temp);
+      }
+      summary_array[fid].Reserve(max_num_bins * kFactor);
+      summary_array[fid].SetPrune(*merged, max_num_bins * kFactor);
+    }
   }
+  tasks.clear();
   size_t nbytes = WXQSketch::SummaryContainer::CalcMemCost(max_num_bins * kFactor);
   sreducer.Allreduce(dmlc::BeginPtr(summary_array), nbytes, summary_array.size());
 
   this->min_val.resize(info.num_col);
+  row_ptr.clear();
+  cut.clear();
   row_ptr.push_back(0);
   for (size_t fid = 0; fid < summary_array.size(); ++fid) {
     WXQSketch::SummaryContainer a;
@@ -101,68 +254,351 @@ void HistCutMatrix::Init(DMatrix* p_fmat, size_t max_num_bins) {
   }
 }
 
+void GHistIndexMatrix::InitIndexType(const MetaInfo& info) {
+  const unsigned nfeature = static_cast<unsigned>(cut->row_ptr.size() - 1);
+  const unsigned nbins = cut->row_ptr.back();
+  // least bin id of every feature that received cut points
+  std::vector<uint32_t> feature_base;
+  uint32_t max_nbins_per_feature = 0;
+  for (unsigned fid = 0; fid < nfeature; ++fid) {
+    const uint32_t nbins_f = cut->row_ptr[fid + 1] - cut->row_ptr[fid];
+    if (nbins_f > 0) {
+      feature_base.push_back(cut->row_ptr[fid]);
+      max_nbins_per_feature = std::max(max_nbins_per_feature, nbins_f);
+    }
+  }
+  // a row can only hold features that received cut points, so if the number of
+  // nonzeros matches, every row holds all of them and the j-th entry of each
+  // (sorted) row belongs to the same feature.
+  is_dense = !feature_base.empty()
+             && info.num_row * feature_base.size() == info.num_nonzero;
+  uint32_t max_val;
+  if (is_dense) {
+    max_val = max_nbins_per_feature - 1;
+    index_base = feature_base;
+    row_stride = static_cast<unsigned>(feature_base.size());
+  } else {
+    max_val = nbins - 1;
+    row_stride = 0;
+    index_base.clear();
+    index_base.resize(nfeature, 0);
+  }
+  if (max_val <= std::numeric_limits<uint8_t>::max()) {
+    index_dtype = uint8;
+  } else if (max_val <= std::numeric_limits<uint16_t>::max()) {
+    index_dtype = uint16;
+  } else {
+    index_dtype = uint32;
+  }
+}
+
+template<typename T>
+void GHistIndexMatrix::SetIndexData(const RowBatch& batch, size_t rbegin, int nthread) {
+  const unsigned nbins = cut->row_ptr.back();
+  T* index = reinterpret_cast<T*>(dmlc::BeginPtr(index_));
+  // per-thread buffer to sort global bin id's of a row before narrowing them
+  std::vector<std::vector<uint32_t> > bin_buf_tloc(nthread);
+
+  omp_ulong bsize = static_cast<omp_ulong>(batch.size);
+  #pragma omp parallel for num_threads(nthread) schedule(static)
+  for (omp_ulong i = 0; i < bsize; ++i) { // NOLINT(*)
+    const int tid = omp_get_thread_num();
+    std::vector<uint32_t>& bin_buf = bin_buf_tloc[tid];
+    size_t ibegin = row_ptr[rbegin + i];
+    size_t iend = row_ptr[rbegin + i + 1];
+    RowBatch::Inst inst = batch[i];
+    CHECK_EQ(ibegin + inst.length, iend);
+    CHECK_LE(inst.length, index_base.size());
+    bin_buf.resize(inst.length);
+    for (bst_uint j = 0; j < inst.length; ++j) {
+      unsigned fid = inst[j].index;
+      auto cbegin = cut->cut.begin() + cut->row_ptr[fid];
+      auto cend = cut->cut.begin() + cut->row_ptr[fid + 1];
+      CHECK(cbegin != cend);
+      auto it = std::upper_bound(cbegin, cend, inst[j].fvalue);
+      if (it == cend) it = cend - 1;
+      unsigned idx = static_cast<unsigned>(it - cut->cut.begin());
+      bin_buf[j] = idx;
+      ++hit_count_tloc_[tid * nbins + idx];
+    }
+    std::sort(bin_buf.begin(), bin_buf.end());
+    for (bst_uint j = 0; j < inst.length; ++j) {
+      CHECK_GE(bin_buf[j], index_base[j]);
+      index[ibegin + j] = static_cast<T>(bin_buf[j] - index_base[j]);
+    }
+  }
+}
+
+void GHistIndexMatrix::AddBatch(const RowBatch& batch, int nthread) {
+  /* if index_dtype is smaller than uint32_t, multiple bin id's will be stored in each
+     slot of index_ */
+  const size_t packing_factor = sizeof(uint32_t) / static_cast<size_t>(index_dtype);
+
+  size_t rbegin = row_ptr.size() - 1;
+  for (size_t i = 0; i < batch.size; ++i) {
+    row_ptr.push_back(batch[i].length + row_ptr.back());
+  }
+  index_.resize((row_ptr.back() + packing_factor - 1) / packing_factor);
+
+  CHECK_GT(cut->cut.size(), 0U);
+  CHECK_EQ(cut->row_ptr.back(), cut->cut.size());
+
+  XGBOOST_TYPE_SWITCH(index_dtype, {
+    SetIndexData<DType>(batch, rbegin, nthread);
+  });
+  this->MergeHitCount(nthread);
+}
+
+template<typename T>
+void GHistIndexMatrix::SetIndexDataDense(const data::DenseSource& dense,
+                                         size_t rbegin, int nthread) {
+  const unsigned nbins = cut->row_ptr.back();
+  const unsigned ncol = static_cast<unsigned>(
+      std::min(dense.NumCol(), cut->row_ptr.size() - 1));
+  T* index = reinterpret_cast<T*>(dmlc::BeginPtr(index_));
+
+  omp_ulong nrow = static_cast<omp_ulong>(dense.NumRow());
+  #pragma omp parallel for num_threads(nthread) schedule(static)
+  for (omp_ulong i = 0; i < nrow; ++i) { // NOLINT(*)
+    const int tid = omp_get_thread_num();
+    const bst_float* row = dense.Row(i);
+    const size_t ibegin = row_ptr[rbegin + i];
+    CHECK_LE(row_ptr[rbegin + i + 1] - ibegin, index_base.size());
+    // cells are visited by ascending feature id, so bin id's come out sorted
+    size_t j = 0;
+    for (unsigned fid = 0; fid < ncol; ++fid) {
+      if (dense.IsMissing(i, fid)) continue;
+      auto cbegin = cut->cut.begin() + cut->row_ptr[fid];
+      auto cend = cut->cut.begin() + cut->row_ptr[fid + 1];
+      CHECK(cbegin != cend);
+      auto it = std::upper_bound(cbegin, cend, row[fid]);
+      if (it == cend) it = cend - 1;
+      unsigned idx = static_cast<unsigned>(it - cut->cut.begin());
+      ++hit_count_tloc_[tid * nbins + idx];
+      CHECK_GE(idx, index_base[j]);
+      index[ibegin + j] = static_cast<T>(idx - index_base[j]);
+      ++j;
+    }
+  }
+}
+
+void GHistIndexMatrix::AddDense(const data::DenseSource& dense, int nthread) {
+  const size_t packing_factor = sizeof(uint32_t) / static_cast<size_t>(index_dtype);
+
+  size_t rbegin = row_ptr.size() - 1;
+  for (size_t i = 0; i < dense.NumRow(); ++i) {
+    row_ptr.push_back(dense.RowLength(i) + row_ptr.back());
+  }
+  index_.resize((row_ptr.back() + packing_factor - 1) / packing_factor);
+
+  CHECK_GT(cut->cut.size(), 0U);
+  CHECK_EQ(cut->row_ptr.back(), cut->cut.size());
+
+  XGBOOST_TYPE_SWITCH(index_dtype, {
+    SetIndexDataDense<DType>(dense, rbegin, nthread);
+  });
+  this->MergeHitCount(nthread);
+}
+
+void GHistIndexMatrix::MergeHitCount(int nthread) {
+  const unsigned nbins = cut->row_ptr.back();
+  #pragma omp parallel for num_threads(nthread) schedule(static)
+  for (omp_ulong idx = 0; idx < nbins; ++idx) {
+    for (int tid = 0; tid < nthread; ++tid) {
+      hit_count[idx] += hit_count_tloc_[tid * nbins + idx];
+      hit_count_tloc_[tid * nbins + idx] = 0;
+    }
+  }
+}
+
 void GHistIndexMatrix::Init(DMatrix* p_fmat) {
   CHECK(cut != nullptr);
   dmlc::DataIter<RowBatch>* iter = p_fmat->RowIterator();
 
   const int nthread = omp_get_max_threads();
   const unsigned nbins = cut->row_ptr.back();
-  hit_count.resize(nbins, 0);
-  hit_count_tloc_.resize(nthread * nbins, 0);
+  hit_count.assign(nbins, 0);
+  hit_count_tloc_.assign(nthread * nbins, 0);
+
+  this->InitIndexType(p_fmat->info());
 
+  base_rowid = 0;
+  index_map_.reset();
+  index_mapped_ = nullptr;
   iter->BeforeFirst();
+  row_ptr.clear();
   row_ptr.push_back(0);
+  index_.clear();
+  const data::DenseDMatrix* dense = dynamic_cast<const data::DenseDMatrix*>(p_fmat);
+  if (dense != nullptr) {
+    this->AddDense(dense->Dense(), nthread);
+    return;
+  }
   while (iter->Next()) {
-    const RowBatch& batch = iter->Value();
-    size_t rbegin = row_ptr.size() - 1;
-    for (size_t i = 0; i < batch.size; ++i) {
-      row_ptr.push_back(batch[i].length + row_ptr.back());
-    }
-    index.resize(row_ptr.back());
+    this->AddBatch(iter->Value(), nthread);
+  }
+}
 
-    CHECK_GT(cut->cut.size(), 0U);
-    CHECK_EQ(cut->row_ptr.back(), cut->cut.size());
+void GHistIndexMatrix::InitPage(const RowBatch& batch, const MetaInfo& info) {
+  CHECK(cut != nullptr);
+  const int nthread = omp_get_max_threads();
+  const unsigned nbins = cut->row_ptr.back();
+  hit_count.assign(nbins, 0);
+  hit_count_tloc_.assign(nthread * nbins, 0);
 
-    omp_ulong bsize = static_cast<omp_ulong>(batch.size);
-    #pragma omp parallel for num_threads(nthread) schedule(static)
-    for (omp_ulong i = 0; i < bsize; ++i) { // NOLINT(*)
-      const int tid = omp_get_thread_num();
-      size_t ibegin = row_ptr[rbegin + i];
-      size_t iend = row_ptr[rbegin + i + 1];
-      RowBatch::Inst inst = batch[i];
-      CHECK_EQ(ibegin + inst.length, iend);
-      for (bst_uint j = 0; j < inst.length; ++j) {
-        unsigned fid = inst[j].index;
-        auto cbegin = cut->cut.begin() + cut->row_ptr[fid];
-        auto cend = cut->cut.begin() + cut->row_ptr[fid + 1];
-        CHECK(cbegin != cend);
-        auto it = std::upper_bound(cbegin, cend, inst[j].fvalue);
-        if (it == cend) it = cend - 1;
-        unsigned idx = static_cast<unsigned>(it - cut->cut.begin());
-        index[ibegin + j] = idx;
-        ++hit_count_tloc_[tid * nbins + idx];
-      }
-      std::sort(index.begin() + ibegin, index.begin() + iend);
+  // the type and layout of bin id's are decided by the whole matrix, so that
+  // they are shared by all pages
+  this->InitIndexType(info);
+
+  base_rowid = batch.base_rowid;
+  index_map_.reset();
+  index_mapped_ = nullptr;
+  row_ptr.clear();
+  row_ptr.push_back(0);
+  index_.clear();
+  this->AddBatch(batch, nthread);
+}
+
+void GHistIndexMatrix::Save(dmlc::Stream* fo) const {
+  const uint64_t base = static_cast<uint64_t>(base_rowid);
+  const int dtype = static_cast<int>(index_dtype);
+  const int dense = is_dense ? 1 : 0;
+  fo->Write(&base, sizeof(base));
+  fo->Write(&dtype, sizeof(dtype));
+  fo->Write(&dense, sizeof(dense));
+  fo->Write(&row_stride, sizeof(row_stride));
+  fo->Write(index_base);
+  fo->Write(row_ptr);
+  CHECK(index_mapped_ == nullptr) << "cannot save a memory-mapped index";
+  fo->Write(index_);
+}
+
+bool GHistIndexMatrix::Load(dmlc::Stream* fi) {
+  uint64_t base;
+  int dtype, dense;
+  if (fi->Read(&base, sizeof(base)) != sizeof(base)) return false;
+  CHECK_EQ(fi->Read(&dtype, sizeof(dtype)), sizeof(dtype)) << "invalid gmat page";
+  CHECK_EQ(fi->Read(&dense, sizeof(dense)), sizeof(dense)) << "invalid gmat page";
+  CHECK_EQ(fi->Read(&row_stride, sizeof(row_stride)), sizeof(row_stride))
+      << "invalid gmat page";
+  CHECK(fi->Read(&index_base)) << "invalid gmat page";
+  CHECK(fi->Read(&row_ptr)) << "invalid gmat page";
+  CHECK(fi->Read(&index_)) << "invalid gmat page";
+  index_map_.reset();
+  index_mapped_ = nullptr;
+  base_rowid = static_cast<size_t>(base);
+  index_dtype = static_cast<DataType>(dtype);
+  is_dense = (dense != 0);
+  return true;
+}
+
+template<typename GradientSumT>
+void GHistBuilder<GradientSumT>::Init(size_t nthread, const GHistIndexMatrix& gmat) {
+  // upper bound on the number of bins in a block, so that a block of GHistEntry's
+  // takes up no more than 256KB and stays resident in L2 cache
+  const size_t kMaxBlockBins = 16384;
+
+  nthread_ = nthread;
+  nbins_ = gmat.cut->row_ptr.back();
+  const size_t nrow = gmat.row_ptr.size() - 1;
+  avg_row_len_ = (nrow > 0) ? static_cast<double>(gmat.row_ptr.back()) / nrow : 0.0;
+  if (data_.size() != nbins_ * nthread_) {
+    data_.clear();
+    data_.resize(nbins_ * nthread_, GHistEntry<GradientSumT>());
+  }
+  touched_tloc_.resize(nthread_);
+
+  // partition bins into blocks of whole features
+  const std::vector<unsigned>& cut_ptr = gmat.cut->row_ptr;
+  blocks_.clear();
+  BinBlock blk;
+  blk.bin_begin = 0;
+  for (size_t fid = 0; fid + 1 < cut_ptr.size(); ++fid) {
+    if (cut_ptr[fid + 1] - blk.bin_begin > kMaxBlockBins && cut_ptr[fid] > blk.bin_begin) {
+      blk.bin_end = cut_ptr[fid];
+      blocks_.push_back(blk);
+      blk.bin_begin = cut_ptr[fid];
+    }
+  }
+  if (nbins_ > blk.bin_begin) {
+    blk.bin_end = static_cast<uint32_t>(nbins_);
+    blocks_.push_back(blk);
+  }
+  // for dense data, locate the features of each block by their position within row
+  const std::vector<uint32_t>& base = gmat.index_base;
+  for (BinBlock& b : blocks_) {
+    if (gmat.is_dense) {
+      b.pos_begin = std::lower_bound(base.begin(), base.end(), b.bin_begin) - base.begin();
+      b.pos_end = std::lower_bound(base.begin(), base.end(), b.bin_end) - base.begin();
+    } else {
+      b.pos_begin = b.pos_end = 0;
     }
+  }
+}
+
+template<typename GradientSumT>
+void GHistBuilder<GradientSumT>::BuildHist(const std::vector<bst_gpair>& gpair,
+                                           const RowSetCollection::Elem row_indices,
+                                           const GHistIndexMatrix& gmat,
+                                           const std::vector<bst_uint>& feat_set,
+                                           GHistRow<GradientSumT> hist,
+                                           bool is_dense) {
+  is_dense = is_dense && gmat.is_dense;
+
+  // when accumulation takes less work than reducing nthread full-size histograms,
+  // switch to block-parallel strategy
+  const double nnz = static_cast<double>(row_indices.size()) * avg_row_len_;
+  if (blocks_.size() > 1 && nnz < static_cast<double>(nbins_) * nthread_) {
+    XGBOOST_TYPE_SWITCH(gmat.index_dtype, {
+      BuildHistBlocked_<DType>(gpair, std::vector<RowSetCollection::Elem>(1, row_indices),
+                               gmat, std::vector<GHistRow<GradientSumT> >(1, hist));
+    });
+    return;
+  }
+
+  std::fill(touched_tloc_.begin(), touched_tloc_.end(), std::make_pair(nbins_, size_t(0)));
+  if (is_dense) {
+    XGBOOST_TYPE_SWITCH(gmat.index_dtype, {
+      BuildHistDense_<DType>(gpair, row_indices, gmat);
+    });
+  } else {
+    XGBOOST_TYPE_SWITCH(gmat.index_dtype, {
+      BuildHistSparse_<DType>(gpair, row_indices, gmat);
+    });
+  }
 
-    #pragma omp parallel for num_threads(nthread) schedule(static)
-    for (omp_ulong idx = 0; idx < nbins; ++idx) {
-      for (int tid = 0; tid < nthread; ++tid) {
-        hit_count[idx] += hit_count_tloc_[tid * nbins + idx];
+  /* reduction, over the bins touched by each thread; the partial histograms
+     are cleared at the same time */
+  const bst_omp_uint nthread = static_cast<bst_omp_uint>(this->nthread_);
+  size_t bin_lo = nbins_, bin_hi = 0;
+  for (const auto& r : touched_tloc_) {
+    bin_lo = std::min(bin_lo, r.first);
+    bin_hi = std::max(bin_hi, r.second);
+  }
+  const bst_omp_uint ibegin = static_cast<bst_omp_uint>(bin_lo);
+  const bst_omp_uint iend = static_cast<bst_omp_uint>(std::max(bin_lo, bin_hi));
+  #pragma omp parallel for num_threads(nthread) schedule(static)
+  for (bst_omp_uint bin_id = ibegin; bin_id < iend; ++bin_id) {
+    for (bst_omp_uint tid = 0; tid < nthread; ++tid) {
+      if (bin_id >= touched_tloc_[tid].first && bin_id < touched_tloc_[tid].second) {
+        GHistEntry<GradientSumT>& e = data_[tid * nbins_ + bin_id];
+        hist.begin[bin_id].Add(e);
+        e = GHistEntry<GradientSumT>();
       }
     }
   }
 }
 
-void GHistBuilder::BuildHist(const std::vector<bst_gpair>& gpair,
-                             const RowSetCollection::Elem row_indices,
-                             const GHistIndexMatrix& gmat,
-                             const std::vector<bst_uint>& feat_set,
-                             GHistRow hist) {
-  data_.resize(nbins_ * nthread_, GHistEntry());
-  std::fill(data_.begin(), data_.end(), GHistEntry());
+template<typename GradientSumT>
+template<typename T>
+void GHistBuilder<GradientSumT>::BuildHistSparse_(const std::vector<bst_gpair>& gpair,
+                                                  const RowSetCollection::Elem row_indices,
+                                                  const GHistIndexMatrix& gmat) {
   stat_buf_.resize(row_indices.size());
 
+  const T* index = gmat.GetIndex<T>();
+  const uint32_t* index_base = dmlc::BeginPtr(gmat.index_base);
+  const size_t base_rowid = gmat.base_rowid;
   const int K = 8;  // loop unrolling factor
   const bst_omp_uint nthread = static_cast<bst_omp_uint>(this->nthread_);
   const bst_omp_uint nrows = row_indices.end - row_indices.begin;
@@ -188,61 +624,247 @@ void GHistBuilder::BuildHist(const std::vector<bst_gpair>& gpair,
     stat_buf_[i] = stat;
   }
 
-  #pragma omp parallel for num_threads(nthread) schedule(dynamic)
-  for (bst_omp_uint i = 0; i < nrows - rest; i += K) {
+  #pragma omp parallel num_threads(nthread)
+  {
     const bst_omp_uint tid = omp_get_thread_num();
     const size_t off = tid * nbins_;
-    bst_uint rid[K];
-    size_t ibegin[K];
-    size_t iend[K];
-    bst_gpair stat[K];
-    for (int k = 0; k < K; ++k) {
-      rid[k] = row_indices.begin[i + k];
-    }
-    for (int k = 0; k < K; ++k) {
-      ibegin[k] = static_cast<size_t>(gmat.row_ptr[rid[k]]);
-      iend[k] = static_cast<size_t>(gmat.row_ptr[rid[k] + 1]);
-    }
-    for (int k = 0; k < K; ++k) {
-      stat[k] = stat_buf_[i + k];
-    }
-    for (int k = 0; k < K; ++k) {
-      for (size_t j = ibegin[k]; j < iend[k]; ++j) {
-        const size_t bin = gmat.index[j];
-        data_[off + bin].Add(stat[k]);
+    // entries within a row are sorted, so the first and last entries bound the bins
+    size_t bin_lo = nbins_, bin_hi = 0;
+    #pragma omp for schedule(dynamic)
+    for (bst_omp_uint i = 0; i < nrows - rest; i += K) {
+      bst_uint rid[K];
+      size_t ibegin[K];
+      size_t iend[K];
+      bst_gpair stat[K];
+      for (int k = 0; k < K; ++k) {
+        rid[k] = row_indices.begin[i + k];
+      }
+      for (int k = 0; k < K; ++k) {
+        ibegin[k] = static_cast<size_t>(gmat.row_ptr[rid[k] - base_rowid]);
+        iend[k] = static_cast<size_t>(gmat.row_ptr[rid[k] - base_rowid + 1]);
+      }
+      for (int k = 0; k < K; ++k) {
+        stat[k] = stat_buf_[i + k];
+      }
+      for (int k = 0; k < K; ++k) {
+        const T* row_index = index + ibegin[k];
+        const size_t len = iend[k] - ibegin[k];
+        for (size_t j = 0; j < len; ++j) {
+          const size_t bin = row_index[j] + index_base[j];
+          data_[off + bin].Add(stat[k]);
+        }
+        if (len > 0) {
+          bin_lo = std::min(bin_lo, static_cast<size_t>(row_index[0] + index_base[0]));
+          bin_hi = std::max(bin_hi,
+                            static_cast<size_t>(row_index[len - 1] + index_base[len - 1]) + 1);
+        }
       }
     }
+    touched_tloc_[tid] = std::make_pair(bin_lo, bin_hi);
   }
   for (bst_omp_uint i = nrows - rest; i < nrows; ++i) {
     const bst_uint rid = row_indices.begin[i];
-    const size_t ibegin = static_cast<size_t>(gmat.row_ptr[rid]);
-    const size_t iend = static_cast<size_t>(gmat.row_ptr[rid + 1]);
+    const size_t ibegin = static_cast<size_t>(gmat.row_ptr[rid - base_rowid]);
+    const size_t iend = static_cast<size_t>(gmat.row_ptr[rid - base_rowid + 1]);
     const bst_gpair stat = stat_buf_[i];
     for (size_t j = ibegin; j < iend; ++j) {
-      const size_t bin = gmat.index[j];
+      const size_t bin = index[j] + index_base[j - ibegin];
       data_[bin].Add(stat);
     }
+    if (iend > ibegin) {
+      std::pair<size_t, size_t>& r = touched_tloc_[0];
+      r.first = std::min(r.first, static_cast<size_t>(index[ibegin] + index_base[0]));
+      r.second = std::max(r.second, static_cast<size_t>(index[iend - 1]
+                                                        + index_base[iend - 1 - ibegin]) + 1);
+    }
   }
+}
 
-  /* reduction */
-  const bst_omp_uint nbins = static_cast<bst_omp_uint>(nbins_);
-  #pragma omp parallel for num_threads(nthread) schedule(static)
-  for (bst_omp_uint bin_id = 0; bin_id < nbins; ++bin_id) {
-    for (bst_omp_uint tid = 0; tid < nthread; ++tid) {
-      hist.begin[bin_id].Add(data_[tid * nbins_ + bin_id]);
+template<typename GradientSumT>
+template<typename T>
+void GHistBuilder<GradientSumT>::BuildHistDense_(const std::vector<bst_gpair>& gpair,
+                                                 const RowSetCollection::Elem row_indices,
+                                                 const GHistIndexMatrix& gmat) {
+  const T* index = gmat.GetIndex<T>();
+  const uint32_t* index_base = dmlc::BeginPtr(gmat.index_base);
+  const size_t row_stride = gmat.row_stride;
+  const size_t base_rowid = gmat.base_rowid;
+  const int K = 8;  // loop unrolling factor
+  const bst_omp_uint nthread = static_cast<bst_omp_uint>(this->nthread_);
+  const bst_omp_uint nrows = row_indices.end - row_indices.begin;
+  const bst_omp_uint rest = nrows % K;
+
+  /* every row has exactly row_stride entries, and the j-th entry always belongs
+     to the same feature, so row i starts at i * row_stride and the inner loop
+     has a fixed trip count */
+  #pragma omp parallel num_threads(nthread)
+  {
+    const bst_omp_uint tid = omp_get_thread_num();
+    GHistEntry<GradientSumT>* data_tloc = dmlc::BeginPtr(data_) + tid * nbins_;
+    bool touched = false;
+    #pragma omp for schedule(static)
+    for (bst_omp_uint i = 0; i < nrows - rest; i += K) {
+      bst_uint rid[K];
+      bst_gpair stat[K];
+      for (int k = 0; k < K; ++k) {
+        rid[k] = row_indices.begin[i + k];
+      }
+      for (int k = 0; k < K; ++k) {
+        stat[k] = gpair[rid[k]];
+      }
+      for (int k = 0; k < K; ++k) {
+        const T* row_index = index + (rid[k] - base_rowid) * row_stride;
+        for (size_t j = 0; j < row_stride; ++j) {
+          data_tloc[row_index[j] + index_base[j]].Add(stat[k]);
+        }
+      }
+      touched = true;
+    }
+    // every row touches all features
+    if (touched) {
+      touched_tloc_[tid] = std::make_pair(size_t(0), nbins_);
+    }
+  }
+  for (bst_omp_uint i = nrows - rest; i < nrows; ++i) {
+    const bst_uint rid = row_indices.begin[i];
+    const bst_gpair stat = gpair[rid];
+    const T* row_index = index + (rid - base_rowid) * row_stride;
+    for (size_t j = 0; j < row_stride; ++j) {
+      data_[row_index[j] + index_base[j]].Add(stat);
+    }
+    touched_tloc_[0] = std::make_pair(size_t(0), nbins_);
+  }
+}
+
+template<typename GradientSumT>
+template<typename T>
+void GHistBuilder<GradientSumT>::BuildHistBlocked_(
+    const std::vector<bst_gpair>& gpair,
+    const std::vector<RowSetCollection::Elem>& row_indices,
+    const GHistIndexMatrix& gmat,
+    const std::vector<GHistRow<GradientSumT> >& hists) {
+  const T* index = gmat.GetIndex<T>();
+  const uint32_t* index_base = dmlc::BeginPtr(gmat.index_base);
+  const size_t row_stride = gmat.row_stride;
+  const size_t base_rowid = gmat.base_rowid;
+  const bst_omp_uint nthread = static_cast<bst_omp_uint>(this->nthread_);
+  const size_t nnode = row_indices.size();
+  const size_t nblock = blocks_.size();
+
+  /* split rows of a node into chunks only when there are fewer blocks than threads;
+     threads are shared among nodes in proportion to the number of rows. Nodes with
+     more than one chunk accumulate each chunk into its own slot of data_; since
+     the number of such chunks is at most nthread_, the slots always fit. */
+  size_t total_rows = 0;
+  for (const auto& e : row_indices) {
+    total_rows += e.size();
+  }
+  chunk_node_.clear();
+  chunk_slot_.clear();
+  size_t nslot = 0;
+  for (size_t i = 0; i < nnode; ++i) {
+    const size_t nrows = row_indices[i].size();
+    size_t nchunk = (total_rows > 0) ? nthread_ * nrows / (total_rows * nblock) : 0;
+    nchunk = std::max(std::min(nchunk, nrows), size_t(1));
+    for (size_t c = 0; c < nchunk; ++c) {
+      chunk_node_.push_back(static_cast<unsigned>(i));
+      chunk_slot_.push_back((nchunk == 1) ? -1 : static_cast<int>(nslot++));
+    }
+  }
+  CHECK_LE(nslot, nthread_);
+  // chunk_begin[i]: index of the first chunk of node i
+  std::vector<size_t> chunk_begin(nnode + 1, chunk_node_.size());
+  for (size_t c = chunk_node_.size(); c-- > 0;) {
+    chunk_begin[chunk_node_[c]] = c;
+  }
+  const bst_omp_uint ntask = static_cast<bst_omp_uint>(chunk_node_.size() * nblock);
+
+  #pragma omp parallel for num_threads(nthread) schedule(dynamic)
+  for (bst_omp_uint task = 0; task < ntask; ++task) {
+    const size_t chunk = task / nblock;
+    const BinBlock& blk = blocks_[task % nblock];
+    const unsigned nid = chunk_node_[chunk];
+    const RowSetCollection::Elem& rowset = row_indices[nid];
+    // with a single chunk, accumulate into the node histogram directly
+    GHistEntry<GradientSumT>* out = (chunk_slot_[chunk] < 0) ? hists[nid].begin
+                      : dmlc::BeginPtr(data_) + chunk_slot_[chunk] * nbins_;
+    const size_t nchunk = chunk_begin[nid + 1] - chunk_begin[nid];
+    const size_t ichunk = chunk - chunk_begin[nid];
+    const size_t ibegin = ichunk * rowset.size() / nchunk;
+    const size_t iend = (ichunk + 1) * rowset.size() / nchunk;
+    if (gmat.is_dense) {
+      for (size_t i = ibegin; i < iend; ++i) {
+        const bst_uint rid = rowset.begin[i];
+        const bst_gpair stat = gpair[rid];
+        const T* row_index = index + (rid - base_rowid) * row_stride;
+        for (size_t j = blk.pos_begin; j < blk.pos_end; ++j) {
+          out[row_index[j] + index_base[j]].Add(stat);
+        }
+      }
+    } else {
+      // global bin id's are stored directly, sorted within each row
+      for (size_t i = ibegin; i < iend; ++i) {
+        const bst_uint rid = rowset.begin[i];
+        const T* row_end = index + gmat.row_ptr[rid - base_rowid + 1];
+        const T* p = std::lower_bound(index + gmat.row_ptr[rid - base_rowid], row_end,
+                                      static_cast<T>(blk.bin_begin));
+        if (p != row_end && *p < blk.bin_end) {
+          const bst_gpair stat = gpair[rid];
+          for (; p != row_end && *p < blk.bin_end; ++p) {
+            out[*p].Add(stat);
+          }
+        }
+      }
+    }
+  }
+
+  if (nslot > 0) {
+    /* reduction, over the chunks of each node; the partial histograms are cleared
+       at the same time */
+    const bst_omp_uint nbins = static_cast<bst_omp_uint>(nbins_);
+    #pragma omp parallel num_threads(nthread)
+    {
+      for (size_t nid = 0; nid < nnode; ++nid) {
+        const size_t cbegin = chunk_begin[nid];
+        const size_t cend = chunk_begin[nid + 1];
+        if (chunk_slot_[cbegin] < 0) continue;
+        #pragma omp for schedule(static) nowait
+        for (bst_omp_uint bin_id = 0; bin_id < nbins; ++bin_id) {
+          for (size_t c = cbegin; c < cend; ++c) {
+            GHistEntry<GradientSumT>& e = data_[chunk_slot_[c] * nbins_ + bin_id];
+            hists[nid].begin[bin_id].Add(e);
+            e = GHistEntry<GradientSumT>();
+          }
+        }
+      }
     }
   }
 }
 
-void GHistBuilder::SubtractionTrick(GHistRow self, GHistRow sibling, GHistRow parent) {
+template<typename GradientSumT>
+void GHistBuilder<GradientSumT>::BuildHist(const std::vector<bst_gpair>& gpair,
+                                           const std::vector<RowSetCollection::Elem>& row_indices,
+                                           const GHistIndexMatrix& gmat,
+                                           const std::vector<bst_uint>& feat_set,
+                                           const std::vector<GHistRow<GradientSumT> >& hists) {
+  CHECK_EQ(row_indices.size(), hists.size());
+  XGBOOST_TYPE_SWITCH(gmat.index_dtype, {
+    BuildHistBlocked_<DType>(gpair, row_indices, gmat, hists);
+  });
+}
+
+template<typename GradientSumT>
+void GHistBuilder<GradientSumT>::SubtractionTrick(GHistRow<GradientSumT> self,
+                                                  GHistRow<GradientSumT> sibling,
+                                                  GHistRow<GradientSumT> parent) {
   const bst_omp_uint nthread = static_cast<bst_omp_uint>(this->nthread_);
   const bst_omp_uint nbins = static_cast<bst_omp_uint>(nbins_);
   const int K = 8;
   const bst_omp_uint rest = nbins % K;
   #pragma omp parallel for num_threads(nthread) schedule(static)
   for (bst_omp_uint bin_id = 0; bin_id < nbins - rest; bin_id += K) {
-    GHistEntry pb[K];
-    GHistEntry sb[K];
+    GHistEntry<GradientSumT> pb[K];
+    GHistEntry<GradientSumT> sb[K];
     for (int k = 0; k < K; ++k) {
       pb[k] = parent.begin[bin_id + k];
     }
@@ -258,5 +880,31 @@ void GHistBuilder::SubtractionTrick(GHistRow self, GHistRow sibling, GHistRow pa
   }
 }
 
+template<typename GradientSumT>
+void GHistBuilder<GradientSumT>::SubtractionTrick(
+    const std::vector<GHistRow<GradientSumT> >& self,
+    const std::vector<GHistRow<GradientSumT> >& sibling,
+    const std::vector<GHistRow<GradientSumT> >& parent) {
+  CHECK_EQ(self.size(), sibling.size());
+  CHECK_EQ(self.size(), parent.size());
+  const bst_omp_uint nthread = static_cast<bst_omp_uint>(this->nthread_);
+  const bst_omp_uint nbins = static_cast<bst_omp_uint>(nbins_);
+  const size_t nnode = self.size();
+  // one parallel region for all nodes; no barrier is needed between nodes
+  #pragma omp parallel num_threads(nthread)
+  {
+    for (size_t nid = 0; nid < nnode; ++nid) {
+      #pragma omp for schedule(static) nowait
+      for (bst_omp_uint bin_id = 0; bin_id < nbins; ++bin_id) {
+        self[nid].begin[bin_id].SetSubtract(parent[nid].begin[bin_id],
+                                            sibling[nid].begin[bin_id]);
+      }
+    }
+  }
+}
+
+template class GHistBuilder<float>;
+template class GHistBuilder<double>;
+
 }  // namespace common
 }  // namespace xgboost
@@ -7,20 +7,59 @@
 #ifndef XGBOOST_COMMON_HIST_UTIL_H_
 #define XGBOOST_COMMON_HIST_UTIL_H_
 
+#define XGBOOST_TYPE_SWITCH(dtype, OP)        \
+switch (dtype) {                \
+  case xgboost::common::uint32 : {           \
+    typedef uint32_t DType;         \
+    OP; break;              \
+  }               \
+  case xgboost::common::uint16 : {           \
+    typedef uint16_t DType;         \
+    OP; break;              \
+  }               \
+  case xgboost::common::uint8 : {            \
+    typedef uint8_t DType;          \
+    OP; break;              \
+    default: LOG(FATAL) << "don't recognize type flag" << dtype;  \
+  }               \
+}
+
 #include <xgboost/data.h>
+#include <algorithm>
 #include <limits>
+#include <memory>
+#include <utility>
 #include <vector>
 #include "row_set.h"
 
 namespace xgboost {
+namespace data {
+class DenseSource;
+}  // namespace data
+
 namespace common {
 
-/*! \brief sums of gradient statistics corresponding to a histogram bin */
+class MMapFile;
+class HistCache;
+
+/*! \brief indicator of data type used for storing bin id's in a column
+    or in the global histogram index. */
+enum DataType {
+  uint8 = 1,
+  uint16 = 2,
+  uint32 = 4
+};
+
+/*!
+ * \brief sums of gradient statistics corresponding to a histogram bin
+ * \tparam GradientSumT type used for accumulation, either float or double
+ */
+template<typename GradientSumT>
 struct GHistEntry {
   /*! \brief sum of first-order gradient statistics */
-  double sum_grad;
+  GradientSumT sum_grad;
   /*! \brief sum of second-order gradient statistics */
-  double sum_hess;
+  GradientSumT sum_hess;
 
   GHistEntry() : sum_grad(0), sum_hess(0) {}
 
@@ -76,39 +115,64 @@ struct HistCutMatrix {
 };
 
 
-/*!
- * \brief A single row in global histogram index.
- *  Directly represent the global index in the histogram entry.
- */
-struct GHistIndexRow {
-  /*! \brief The index of the histogram */
-  const unsigned* index;
-  /*! \brief The size of the histogram */
-  unsigned size;
-  GHistIndexRow() {}
-  GHistIndexRow(const unsigned* index, unsigned size)
-      : index(index), size(size) {}
-};
-
 /*!
  * \brief preprocessed global index matrix, in CSR format
  *  Transform floating values to integer index in histogram
  *  This is a global histogram index.
+ *
+ *  Bin id's are stored in the narrowest integer type (index_dtype) that can hold them.
+ *  The global bin id of the j-th entry of a row is GetIndex<T>()[row_ptr[i] + j]
+ *  + index_base[j]. For dense data (every row holds the same set of features),
+ *  index_base[j] is the least bin id of the j-th feature, so that only feature-local
+ *  offsets are stored; otherwise index_base is filled with zeros and global bin id's
+ *  are stored directly.
  */
 struct GHistIndexMatrix {
-  /*! \brief row pointer */
+  /*! \brief id of the first row held; nonzero only for a page of an external memory index */
+  size_t base_rowid;
+  /*! \brief row pointer, relative to base_rowid */
   std::vector<unsigned> row_ptr;
-  /*! \brief The index data */
-  std::vector<unsigned> index;
   /*! \brief hit count of each index */
   std::vector<unsigned> hit_count;
+  /*! \brief offset to be added to each stored bin id, indexed by position within row */
+  std::vector<uint32_t> index_base;
+  /*! \brief data type used for storing bin id's */
+  DataType index_dtype;
+  /*! \brief whether every row stores the same set of features */
+  bool is_dense;
+  /*! \brief number of entries in every row; only meaningful when is_dense is set */
+  unsigned row_stride;
   /*! \brief The corresponding cuts */
   const HistCutMatrix* cut;
+
+  GHistIndexMatrix() : base_rowid(0), cut(nullptr), index_mapped_(nullptr) {}
   // Create a global histogram matrix, given cut
   void Init(DMatrix* p_fmat);
-  // get i-th row
-  inline GHistIndexRow operator[](bst_uint i) const {
-    return GHistIndexRow(&index[0] + row_ptr[i], row_ptr[i + 1] - row_ptr[i]);
+  // Create an index page holding a single batch of rows of a matrix with the given info
+  void InitPage(const RowBatch& batch, const MetaInfo& info);
+  // Save the index to stream; cut and hit_count are not saved
+  void Save(dmlc::Stream* fo) const;
+  // Load the index from stream, return false if end of stream was reached
+  bool Load(dmlc::Stream* fi);
+  /* Fetch the stored bin id's. This code should be used with XGBOOST_TYPE_SWITCH
+     to determine the type of bin id's */
+  template<typename T>
+  inline const T* GetIndex() const {
+    CHECK_EQ(sizeof(T), static_cast<size_t>(index_dtype));
+    return reinterpret_cast<const T*>(index_mapped_ != nullptr ? index_mapped_
+                                                                : dmlc::BeginPtr(index_));
+  }
+  // get global bin id of the j-th entry of i-th row; not meant for use in hot loops
+  inline uint32_t GetGlobalBin(bst_uint i, unsigned j) const {
+    uint32_t bin = 0;
+    XGBOOST_TYPE_SWITCH(index_dtype, {
+      bin = static_cast<uint32_t>(GetIndex<DType>()[row_ptr[i] + j]);
+    });
+    return bin + index_base[j];
+  }
+  // get number of entries in i-th row
+  inline unsigned RowSize(bst_uint i) const {
+    return row_ptr[i + 1] - row_ptr[i];
   }
   inline void GetFeatureCounts(bst_uint* counts) const {
     const unsigned nfeature = cut->row_ptr.size() - 1;
@@ -122,36 +186,62 @@ struct GHistIndexMatrix {
   }
 
  private:
+  // choose index_dtype and fill index_base, given the cuts and data statistics
+  void InitIndexType(const MetaInfo& info);
+  // append one batch of rows to the index
+  void AddBatch(const RowBatch& batch, int nthread);
+  // binarize one batch of rows and store the bin id's with type T
+  template<typename T>
+  void SetIndexData(const RowBatch& batch, size_t rbegin, int nthread);
+  // append all rows of a dense matrix to the index, reading its values directly
+  void AddDense(const data::DenseSource& dense, int nthread);
+  // binarize the rows of a dense matrix and store the bin id's with type T
+  template<typename T>
+  void SetIndexDataDense(const data::DenseSource& dense, size_t rbegin, int nthread);
+  // add the per-thread hit counts to hit_count, and reset them
+  void MergeHitCount(int nthread);
+
+  /*! \brief the stored bin id's; may pack multiple narrow integers in each slot */
+  std::vector<uint32_t> index_;
+  /*! \brief file mapping holding the bin id's in place of index_, when loaded from cache */
+  std::shared_ptr<MMapFile> index_map_;
+  /*! \brief start of the bin id's within index_map_; nullptr if index_ is used */
+  const uint32_t* index_mapped_;
   std::vector<unsigned> hit_count_tloc_;
+
+  friend class HistCache;
 };
 
 /*!
  * \brief histogram of graident statistics for a single node.
- *  Consists of multiple GHistEntry's, each entry showing total graident statistics 
+ *  Consists of multiple GHistEntry's, each entry showing total graident statistics
  *     for that particular bin
  *  Uses global bin id so as to represent all features simultaneously
  */
+template<typename GradientSumT>
 struct GHistRow {
   /*! \brief base pointer to first entry */
-  GHistEntry* begin;
+  GHistEntry<GradientSumT>* begin;
   /*! \brief number of entries */
   unsigned size;
 
   GHistRow() {}
-  GHistRow(GHistEntry* begin, unsigned size)
+  GHistRow(GHistEntry<GradientSumT>* begin, unsigned size)
     : begin(begin), size(size) {}
 };
 
 /*!
  * \brief histogram of gradient statistics for multiple nodes
  */
+template<typename GradientSumT>
 class HistCollection {
  public:
   // access histogram for i-th node
-  inline GHistRow operator[](bst_uint nid) const {
+  inline GHistRow<GradientSumT> operator[](bst_uint nid) const {
     const size_t kMax = std::numeric_limits<size_t>::max();
     CHECK_NE(row_ptr_[nid], kMax);
-    return GHistRow(const_cast<GHistEntry*>(dmlc::BeginPtr(data_) + row_ptr_[nid]), nbins_);
+    return GHistRow<GradientSumT>(
+        const_cast<GHistEntry<GradientSumT>*>(dmlc::BeginPtr(data_) + row_ptr_[nid]), nbins_);
   }
 
   // have we computed a histogram for i-th node?
@@ -164,10 +254,11 @@ class HistCollection {
   inline void Init(size_t nbins) {
     nbins_ = nbins;
     row_ptr_.clear();
+    free_slots_.clear();
     data_.clear();
   }
 
-  // create an empty histogram for i-th node
+  // create an empty histogram for i-th node, recycling a released slot if any
   inline void AddHistRow(bst_uint nid) {
     const size_t kMax = std::numeric_limits<size_t>::max();
     if (nid >= row_ptr_.size()) {
@@ -175,15 +266,37 @@ class HistCollection {
     }
     CHECK_EQ(row_ptr_[nid], kMax);
 
-    row_ptr_[nid] = data_.size();
-    data_.resize(data_.size() + nbins_);
+    if (!free_slots_.empty()) {
+      row_ptr_[nid] = free_slots_.back();
+      free_slots_.pop_back();
+      std::fill(data_.begin() + row_ptr_[nid], data_.begin() + row_ptr_[nid] + nbins_,
+                GHistEntry<GradientSumT>());
+    } else {
+      row_ptr_[nid] = data_.size();
+      data_.resize(data_.size() + nbins_);
+    }
+  }
+
+  // release histogram of i-th node; its storage is reused by a later AddHistRow
+  inline void DeleteHistRow(bst_uint nid) {
+    CHECK(RowExists(nid));
+    free_slots_.push_back(row_ptr_[nid]);
+    row_ptr_[nid] = std::numeric_limits<size_t>::max();
+  }
+
+  // peak memory held by histograms, in bytes (data_ never shrinks until Init)
+  inline size_t PeakMemory() const {
+    return data_.size() * sizeof(GHistEntry<GradientSumT>);
   }
 
  private:
   /*! \brief number of all bins over all features */
   size_t nbins_;
 
-  std::vector<GHistEntry> data_;
+  std::vector<GHistEntry<GradientSumT> > data_;
+
+  /*! \brief offsets into data_ of histograms released by DeleteHistRow */
+  std::vector<size_t> free_slots_;
 
   /*! \brief row_ptr_[nid] locates bin for historgram of node nid */
   std::vector<size_t> row_ptr_;
@@ -191,30 +304,87 @@ class HistCollection {
 
 /*!
  * \brief builder for histograms of gradient statistics
+ *  Two parallelization strategies are available:
+ *   - row-parallel: each thread accumulates a subset of rows into its own full-size
+ *     histogram, followed by a reduction over the range of bins each thread touched;
+ *   - block-parallel: bins are partitioned into blocks of whole features small enough
+ *     to stay in L2 cache; each task accumulates one block over a chunk of rows, so that
+ *     the reduction runs over only as many partial histograms as there are row chunks.
+ *  The latter is chosen for small nodes, where the reduction would dominate, and for
+ *  building histograms of multiple nodes in a single pass.
+ * \tparam GradientSumT type used for accumulating gradient statistics
  */
+template<typename GradientSumT>
 class GHistBuilder {
  public:
   // initialize builder
-  inline void Init(size_t nthread, size_t nbins) {
-    nthread_ = nthread;
-    nbins_ = nbins;
-  }
+  void Init(size_t nthread, const GHistIndexMatrix& gmat);
 
   // construct a histogram via histogram aggregation
+  // is_dense: use fixed-stride kernel, if gmat stores every feature in every row
   void BuildHist(const std::vector<bst_gpair>& gpair,
                  const RowSetCollection::Elem row_indices,
                  const GHistIndexMatrix& gmat,
                  const std::vector<bst_uint>& feat_set,
-                 GHistRow hist);
+                 GHistRow<GradientSumT> hist,
+                 bool is_dense);
+  // construct histograms of multiple nodes in a single parallel pass
+  void BuildHist(const std::vector<bst_gpair>& gpair,
+                 const std::vector<RowSetCollection::Elem>& row_indices,
+                 const GHistIndexMatrix& gmat,
+                 const std::vector<bst_uint>& feat_set,
+                 const std::vector<GHistRow<GradientSumT> >& hists);
   // construct a histogram via subtraction trick
-  void SubtractionTrick(GHistRow self, GHistRow sibling, GHistRow parent);
+  void SubtractionTrick(GHistRow<GradientSumT> self, GHistRow<GradientSumT> sibling,
+                        GHistRow<GradientSumT> parent);
+  // apply subtraction trick to multiple nodes in a single parallel region
+  void SubtractionTrick(const std::vector<GHistRow<GradientSumT> >& self,
+                        const std::vector<GHistRow<GradientSumT> >& sibling,
+                        const std::vector<GHistRow<GradientSumT> >& parent);
 
  private:
+  /*! \brief a contiguous range of bins, made of whole features */
+  struct BinBlock {
+    /*! \brief range of global bin id's covered by the block */
+    uint32_t bin_begin;
+    uint32_t bin_end;
+    /*! \brief range of positions within a row covered by the block; dense data only */
+    unsigned pos_begin;
+    unsigned pos_end;
+  };
+  // aggregate per-thread histograms in data_, reading CSR rows via row_ptr
+  template<typename T>
+  void BuildHistSparse_(const std::vector<bst_gpair>& gpair,
+                        const RowSetCollection::Elem row_indices,
+                        const GHistIndexMatrix& gmat);
+  // aggregate per-thread histograms in data_, for rows of fixed length row_stride
+  template<typename T>
+  void BuildHistDense_(const std::vector<bst_gpair>& gpair,
+                       const RowSetCollection::Elem row_indices,
+                       const GHistIndexMatrix& gmat);
+  // aggregate histograms of one or more nodes block by block, over chunks of rows
+  template<typename T>
+  void BuildHistBlocked_(const std::vector<bst_gpair>& gpair,
+                         const std::vector<RowSetCollection::Elem>& row_indices,
+                         const GHistIndexMatrix& gmat,
+                         const std::vector<GHistRow<GradientSumT> >& hists);
+
   /*! \brief number of threads for parallel computation */
   size_t nthread_;
   /*! \brief number of all bins over all features */
   size_t nbins_;
-  std::vector<GHistEntry> data_;
+  /*! \brief average number of entries per row */
+  double avg_row_len_;
+  /*! \brief per-thread partial histograms; all entries are kept at zero between calls */
+  std::vector<GHistEntry<GradientSumT> > data_;
+  /*! \brief range of bins [first, second) touched by each thread in data_ */
+  std::vector<std::pair<size_t, size_t> > touched_tloc_;
+  /*! \brief partition of bins into cache-sized blocks */
+  std::vector<BinBlock> blocks_;
+  /*! \brief node and slot in data_ of each chunk of rows in BuildHistBlocked_;
+             slot is -1 if the node has a single chunk */
+  std::vector<unsigned> chunk_node_;
+  std::vector<int> chunk_slot_;
   std::vector<bst_gpair> stat_buf_;
 };
 
@@ -0,0 +1,79 @@
+/*!
+ * Copyright 2017 by Contributors
+ * \file io.cc
+ * \brief Memory mapping of local files
+ */
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <xgboost/logging.h>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include "./io.h"
+
+namespace xgboost {
+namespace common {
+
+#ifndef _WIN32
+MMapFile::MMapFile(const std::string& fname) : data_(nullptr), size_(0) {
+  int fd = open(fname.c_str(), O_RDONLY);
+  CHECK_GE(fd, 0) << "Failed to open " << fname;
+  struct stat st;
+  CHECK_EQ(fstat(fd, &st), 0) << "Failed to stat " << fname;
+  size_ = static_cast<size_t>(st.st_size);
+  if (size_ != 0) {
+    void* ptr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    CHECK(ptr != MAP_FAILED) << "Failed to map " << fname;
+    data_ = static_cast<const char*>(ptr);
+  }
+  close(fd);
+}
+
+MMapFile::~MMapFile() {
+  if (data_ != nullptr) {
+    munmap(const_cast<char*>(data_), size_);
+  }
+}
+
+void MMapFile::AdviseSequential() const {
+  if (data_ != nullptr) {
+    madvise(const_cast<char*>(data_), size_, MADV_SEQUENTIAL);
+  }
+}
+
+void MMapFile::AdviseWillNeed(size_t offset, size_t length) const {
+  if (data_ == nullptr || offset >= size_) return;
+  // madvise takes ranges starting on a page boundary
+  const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  const size_t begin = offset / page_size * page_size;
+  const size_t end = std::min(offset + length, size_);
+  madvise(const_cast<char*>(data_) + begin, end - begin, MADV_WILLNEED);
+}
+#else
+MMapFile::MMapFile(const std::string& fname) : data_(nullptr), size_(0) {
+  std::unique_ptr<dmlc::Stream> fi(dmlc::Stream::Create(fname.c_str(), "r"));
+  const size_t kChunk = 1 << 20;
+  size_t nread;
+  do {
+    buffer_.resize(size_ + kChunk);
+    nread = fi->Read(&buffer_[size_], kChunk);
+    size_ += nread;
+  } while (nread == kChunk);
+  buffer_.resize(size_);
+  data_ = buffer_.data();
+}
+
+MMapFile::~MMapFile() {}
+
+void MMapFile::AdviseSequential() const {}
+
+void MMapFile::AdviseWillNeed(size_t offset, size_t length) const {}
+#endif  // _WIN32
+
+}  // namespace common
+}  // namespace xgboost
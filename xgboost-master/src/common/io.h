@@ -70,6 +70,34 @@ class PeekableInStream : public dmlc::Stream {
   /*! \brief internal buffer */
   std::string buffer_;
 };
+
+/*!
+ * \brief read-only view of a whole local file, mapped into memory with mmap.
+ *  On platforms without mmap, the file is read into memory instead.
+ */
+class MMapFile {
+ public:
+  explicit MMapFile(const std::string& fname);
+  ~MMapFile();
+  /*! \brief start of the file content */
+  inline const char* data() const {
+    return data_;
+  }
+  /*! \brief size of the file in bytes */
+  inline size_t size() const {
+    return size_;
+  }
+  /*! \brief hint that the file will be read from start to end */
+  void AdviseSequential() const;
+  /*! \brief hint that bytes [offset, offset + length) will be read soon */
+  void AdviseWillNeed(size_t offset, size_t length) const;
+
+ private:
+  const char* data_;
+  size_t size_;
+  /*! \brief file content, used when mmap is not available */
+  std::string buffer_;
+};
 }  // namespace common
 }  // namespace xgboost
 #endif  // XGBOOST_COMMON_IO_H_
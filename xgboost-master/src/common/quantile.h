@@ -702,9 +702,10 @@ class QuantileSketchTemplate {
   inline void Push(DType x, RType w = 1) {
     if (w == static_cast<RType>(0)) return;
     if (inqueue.qtail == inqueue.queue.size()) {
-      // jump from lazy one value to limit_size * 2
-      if (inqueue.queue.size() == 1) {
-        inqueue.queue.resize(limit_size * 2);
+      // grow lazily from one value up to limit_size * 2, so that sketches
+      // receiving few values stay small
+      if (inqueue.queue.size() < limit_size * 2) {
+        inqueue.queue.resize(std::min(inqueue.queue.size() * 2, limit_size * 2));
       } else {
         temp.Reserve(limit_size * 2);
         inqueue.MakeSummary(&temp);
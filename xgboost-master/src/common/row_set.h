@@ -8,6 +8,7 @@
 #define XGBOOST_COMMON_ROW_SET_H_
 
 #include <xgboost/data.h>
+#include <dmlc/omp.h>
 #include <algorithm>
 #include <vector>
 
@@ -36,12 +37,6 @@ class RowSetCollection {
       return end - begin;
     }
   };
-  /* \brief specifies how to split a rowset into two */
-  struct Split {
-    std::vector<bst_uint> left;
-    std::vector<bst_uint> right;
-  };
-
   inline std::vector<Elem>::const_iterator begin() const {
     return elem_of_each_node_.begin();
   }
@@ -69,28 +64,61 @@ class RowSetCollection {
     const bst_uint* end = dmlc::BeginPtr(row_indices_) + row_indices_.size();
     elem_of_each_node_.emplace_back(Elem(begin, end, 0));
   }
-  // split rowset into two
-  inline void AddSplit(unsigned node_id,
-                       const std::vector<Split>& row_split_tloc,
-                       unsigned left_node_id,
-                       unsigned right_node_id) {
+  /*!
+   * \brief split rowset of node_id into two, by a stable partition in place.
+   *  The rowset is cut into one block per thread; fn(begin, end, left, right)
+   *  classifies the rows in [begin, end), writing left rows forward from left
+   *  and right rows backward from right, and returns the number of left rows.
+   *  Blocks are then scattered back at offsets given by prefix sums of counts.
+   */
+  template <typename PartitionFn>
+  inline void Partition(unsigned node_id,
+                        unsigned left_node_id,
+                        unsigned right_node_id,
+                        int nthread,
+                        PartitionFn fn) {
     const Elem e = elem_of_each_node_[node_id];
-    const unsigned nthread = row_split_tloc.size();
     CHECK(e.begin != nullptr);
     bst_uint* all_begin = dmlc::BeginPtr(row_indices_);
     bst_uint* begin = all_begin + (e.begin - all_begin);
+    const size_t nrows = e.size();
+    const size_t nblock = std::max(std::min(static_cast<size_t>(nthread), nrows), size_t(1));
+
+    if (buffer_.size() < nrows) {
+      buffer_.resize(nrows);
+    }
+    bst_uint* buf = dmlc::BeginPtr(buffer_);
+    left_count_.resize(nblock);
+    left_offset_.resize(nblock);
+    right_offset_.resize(nblock);
 
-    bst_uint* it = begin;
-    // TODO(hcho3): parallelize this section
-    for (bst_omp_uint tid = 0; tid < nthread; ++tid) {
-      std::copy(row_split_tloc[tid].left.begin(), row_split_tloc[tid].left.end(), it);
-      it += row_split_tloc[tid].left.size();
+    // 1. classify rows of each block into the buffer, counting left rows
+    #pragma omp parallel for num_threads(nthread) schedule(static)
+    for (bst_omp_uint b = 0; b < nblock; ++b) {
+      const size_t ibegin = b * nrows / nblock;
+      const size_t iend = (b + 1) * nrows / nblock;
+      left_count_[b] = fn(begin + ibegin, begin + iend, buf + ibegin, buf + iend);
+    }
+    // 2. prefix sums over the counts; all left rows precede all right rows
+    size_t nleft = 0;
+    for (size_t b = 0; b < nblock; ++b) {
+      left_offset_[b] = nleft;
+      nleft += left_count_[b];
+    }
+    for (size_t b = 0; b < nblock; ++b) {
+      // right rows preceding block b = rows preceding block b - left rows preceding it
+      right_offset_[b] = nleft + b * nrows / nblock - left_offset_[b];
     }
-    bst_uint* split_pt = it;
-    for (bst_omp_uint tid = 0; tid < nthread; ++tid) {
-      std::copy(row_split_tloc[tid].right.begin(), row_split_tloc[tid].right.end(), it);
-      it += row_split_tloc[tid].right.size();
+    // 3. scatter blocks back, restoring original order of right rows
+    #pragma omp parallel for num_threads(nthread) schedule(static)
+    for (bst_omp_uint b = 0; b < nblock; ++b) {
+      const size_t ibegin = b * nrows / nblock;
+      const size_t iend = (b + 1) * nrows / nblock;
+      const size_t cnt = left_count_[b];
+      std::copy(buf + ibegin, buf + ibegin + cnt, begin + left_offset_[b]);
+      std::reverse_copy(buf + ibegin + cnt, buf + iend, begin + right_offset_[b]);
     }
+    bst_uint* split_pt = begin + nleft;
 
     if (left_node_id >= elem_of_each_node_.size()) {
       elem_of_each_node_.resize(left_node_id + 1, Elem(nullptr, nullptr, -1));
@@ -110,6 +138,11 @@ class RowSetCollection {
  private:
   // vector: node_id -> elements
   std::vector<Elem> elem_of_each_node_;
+  // scratch space for Partition, kept to avoid reallocation per split
+  std::vector<bst_uint> buffer_;
+  std::vector<size_t> left_count_;
+  std::vector<size_t> left_offset_;
+  std::vector<size_t> right_offset_;
 };
 
 }  // namespace common
@@ -301,5 +301,6 @@ SparsePage::Format::DecideFormat(const std::string& cache_prefix) {
 
 // List of files that will be force linked in static links.
 DMLC_REGISTRY_LINK_TAG(sparse_page_raw_format);
+DMLC_REGISTRY_LINK_TAG(sparse_page_mmap_format);
 }  // namespace data
 }  // namespace xgboost
@@ -0,0 +1,42 @@
+/*!
+ * Copyright 2017 by Contributors
+ * \file dense_dmatrix.h
+ * \brief In-memory DMatrix of a dense matrix.
+ */
+#ifndef XGBOOST_DATA_DENSE_DMATRIX_H_
+#define XGBOOST_DATA_DENSE_DMATRIX_H_
+
+#include <xgboost/data.h>
+#include <memory>
+#include "./dense_source.h"
+#include "./simple_dmatrix.h"
+
+namespace xgboost {
+namespace data {
+/*!
+ * \brief SimpleDMatrix over a DenseSource. It behaves as any in-memory DMatrix, and in
+ *  addition lets consumers read the dense values directly:
+ * \code
+ * const DenseDMatrix* dense = dynamic_cast<const DenseDMatrix*>(p_fmat);
+ * if (dense != nullptr) {
+ *   const bst_float* row = dense->Dense().Row(ridx);
+ * }
+ * \endcode
+ */
+class DenseDMatrix : public SimpleDMatrix {
+ public:
+  /*! \brief create the matrix, taking ownership of source */
+  explicit DenseDMatrix(DenseSource* source)
+      : SimpleDMatrix(std::unique_ptr<DataSource>(source)), dense_(source) {}
+  /*! \brief the dense values */
+  inline const DenseSource& Dense() const {
+    return *dense_;
+  }
+
+ private:
+  /*! \brief the source, owned by SimpleDMatrix */
+  const DenseSource* dense_;
+};
+}  // namespace data
+}  // namespace xgboost
+#endif  // XGBOOST_DATA_DENSE_DMATRIX_H_
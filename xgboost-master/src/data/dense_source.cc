@@ -0,0 +1,131 @@
+/*!
+ * Copyright 2017 by Contributors
+ * \file dense_source.cc
+ * \brief Data source of a dense matrix, stored as values and a bitmap of missing cells.
+ */
+#include <dmlc/base.h>
+#include <dmlc/omp.h>
+#include <xgboost/logging.h>
+#include <algorithm>
+#include <numeric>
+#include "./dense_source.h"
+#include "../common/math.h"
+
+namespace xgboost {
+namespace data {
+
+const size_t DenseSource::kEntriesPerBatch;
+
+DenseSource::DenseSource(const bst_float* data, size_t nrow, size_t ncol, bst_float missing,
+                         size_t entries_per_batch)
+    : data_(data), ncol_(ncol), entries_per_batch_(entries_per_batch), next_rowid_(0) {
+  const bool nan_missing = common::CheckNAN(missing);
+  // mark missing cells a word of the bitmap at a time, so that threads write apart.
+  // CHECK can't throw out of a parallel region, so NaN's are only recorded there
+  const size_t ncell = nrow * ncol;
+  missing_.Resize(ncell);
+  int nan_found = 0, nword_missing = 0;
+  const omp_ulong nword = static_cast<omp_ulong>(missing_.data.size());
+  #pragma omp parallel for schedule(static) reduction(+:nan_found, nword_missing)
+  for (omp_ulong w = 0; w < nword; ++w) {
+    uint32_t bits = 0;
+    const size_t end = std::min(ncell, static_cast<size_t>(w + 1) * 32);
+    for (size_t k = static_cast<size_t>(w) * 32; k < end; ++k) {
+      if (common::CheckNAN(data[k])) {
+        nan_found += 1;
+        bits |= 1U << (k & 31U);
+      } else if (!nan_missing && data[k] == missing) {
+        bits |= 1U << (k & 31U);
+      }
+    }
+    missing_.data[w] = bits;
+    nword_missing += (bits != 0);
+  }
+  CHECK(nan_found == 0 || nan_missing)
+      << "There are NAN in the matrix, however, you did not set missing=NAN";
+  if (nword_missing == 0) {
+    missing_.data.clear();
+    missing_.data.shrink_to_fit();
+  }
+
+  row_ptr_.resize(nrow + 1);
+  row_ptr_[0] = 0;
+  const omp_ulong ndata = static_cast<omp_ulong>(nrow);
+  #pragma omp parallel for schedule(static)
+  for (omp_ulong i = 0; i < ndata; ++i) {
+    size_t nelem = ncol;
+    if (this->HasMissing()) {
+      for (size_t j = 0; j < ncol; ++j) {
+        nelem -= this->IsMissing(i, j);
+      }
+    }
+    row_ptr_[i + 1] = nelem;
+  }
+  std::partial_sum(row_ptr_.begin(), row_ptr_.end(), row_ptr_.begin());
+  info.num_row = nrow;
+  info.num_col = ncol;
+  info.num_nonzero = row_ptr_.back();
+}
+
+void DenseSource::OwnData() {
+  if (data_ == dmlc::BeginPtr(values_)) return;
+  values_.assign(data_, data_ + this->NumRow() * ncol_);
+  data_ = dmlc::BeginPtr(values_);
+}
+
+void DenseSource::FillRows(size_t begin, size_t end, RowBatch::Entry* out) const {
+  const size_t base = row_ptr_[begin];
+  const omp_ulong ndata = static_cast<omp_ulong>(end - begin);
+  #pragma omp parallel for schedule(static)
+  for (omp_ulong i = 0; i < ndata; ++i) {
+    const size_t ridx = begin + i;
+    const bst_float* row = this->Row(ridx);
+    RowBatch::Entry* p = out + row_ptr_[ridx] - base;
+    for (size_t j = 0; j < ncol_; ++j) {
+      if (!this->IsMissing(ridx, j)) {
+        *p++ = RowBatch::Entry(static_cast<bst_uint>(j), row[j]);
+      }
+    }
+  }
+}
+
+void DenseSource::ToCSR(SimpleCSRSource* out) const {
+  out->Clear();
+  out->info = info;
+  out->row_ptr_ = row_ptr_;
+  out->row_data_.resize(row_ptr_.back());
+  this->FillRows(0, info.num_row, dmlc::BeginPtr(out->row_data_));
+}
+
+void DenseSource::BeforeFirst() {
+  next_rowid_ = 0;
+}
+
+bool DenseSource::Next() {
+  const size_t nrow = info.num_row;
+  if (next_rowid_ >= nrow) return false;
+  // take rows while the batch has at most entries_per_batch_ entries, and at least one row
+  const size_t begin = next_rowid_;
+  size_t end = std::upper_bound(row_ptr_.begin() + begin + 1, row_ptr_.end(),
+                                row_ptr_[begin] + entries_per_batch_) - row_ptr_.begin() - 1;
+  end = std::min(std::max(end, begin + 1), nrow);
+  batch_ptr_.resize(end - begin + 1);
+  for (size_t i = begin; i <= end; ++i) {
+    batch_ptr_[i - begin] = row_ptr_[i] - row_ptr_[begin];
+  }
+  batch_data_.resize(batch_ptr_.back());
+  this->FillRows(begin, end, dmlc::BeginPtr(batch_data_));
+  batch_.size = end - begin;
+  batch_.base_rowid = begin;
+  batch_.ind_ptr = dmlc::BeginPtr(batch_ptr_);
+  batch_.data_ptr = dmlc::BeginPtr(batch_data_);
+  next_rowid_ = end;
+  return true;
+}
+
+const RowBatch& DenseSource::Value() const {
+  return batch_;
+}
+
+}  // namespace data
+}  // namespace xgboost
@@ -0,0 +1,109 @@
+/*!
+ * Copyright 2017 by Contributors
+ * \file dense_source.h
+ * \brief Data source of a dense matrix, stored as values and a bitmap of missing cells.
+ */
+#ifndef XGBOOST_DATA_DENSE_SOURCE_H_
+#define XGBOOST_DATA_DENSE_SOURCE_H_
+
+#include <xgboost/base.h>
+#include <xgboost/data.h>
+#include <vector>
+#include "./simple_csr_source.h"
+#include "../common/bitmap.h"
+
+namespace xgboost {
+namespace data {
+/*!
+ * \brief Data source over a dense row major matrix of bst_float. Cells equal to missing,
+ *  or NaN, are marked in a bitmap, which is left empty if no cell is missing. The values
+ *  are either held by the caller, who must keep them alive as long as the source, or
+ *  copied by OwnData(); with 4 bytes per cell, this takes half the memory of a CSR copy
+ *  of a dense matrix.
+ *
+ *  As a DataSource, rows are turned into entries a batch at a time when iterating, so
+ *  the matrix is never expanded as a whole. Consumers that know about the source can
+ *  read the values directly instead.
+ * \code
+ * std::unique_ptr<DataSource> source(new DenseSource(data, nrow, ncol, missing));
+ * DMatrix* dmat = DMatrix::Create(std::move(source));
+ * \endcode
+ */
+class DenseSource : public DataSource {
+ public:
+  /*!
+   * \brief create the source, marking missing cells and counting the entries of each row
+   *  in parallel
+   * \param data the matrix, nrow * ncol values
+   * \param missing value marking missing cells
+   * \param entries_per_batch maximum number of entries in a batch, unless a row holds more
+   */
+  DenseSource(const bst_float* data, size_t nrow, size_t ncol, bst_float missing,
+              size_t entries_per_batch = kEntriesPerBatch);
+  /*! \brief copy the values, so that the caller's matrix is no longer used */
+  void OwnData();
+  /*!
+   * \brief copy all entries into a CSR source, filling rows in parallel
+   * \param out the CSR source, which gets the same info
+   */
+  void ToCSR(SimpleCSRSource* out) const;
+  /*! \brief number of rows */
+  inline size_t NumRow() const {
+    return row_ptr_.size() - 1;
+  }
+  /*! \brief number of columns */
+  inline size_t NumCol() const {
+    return ncol_;
+  }
+  /*! \brief values of the i-th row, including missing cells */
+  inline const bst_float* Row(size_t i) const {
+    return data_ + i * ncol_;
+  }
+  /*! \brief number of non-missing cells of the i-th row */
+  inline size_t RowLength(size_t i) const {
+    return row_ptr_[i + 1] - row_ptr_[i];
+  }
+  /*! \brief whether any cell is missing */
+  inline bool HasMissing() const {
+    return missing_.data.size() != 0;
+  }
+  /*! \brief whether cell (i, j) is missing */
+  inline bool IsMissing(size_t i, size_t j) const {
+    return HasMissing() && missing_.Get(i * ncol_ + j);
+  }
+  // implement Next
+  bool Next() override;
+  // implement BeforeFirst
+  void BeforeFirst() override;
+  // implement Value
+  const RowBatch &Value() const override;
+  /*! \brief default maximum number of entries in a batch */
+  static const size_t kEntriesPerBatch = 1UL << 22;
+
+ private:
+  /*! \brief write the entries of rows [begin, end) to out, starting at row_ptr_[begin] */
+  void FillRows(size_t begin, size_t end, RowBatch::Entry* out) const;
+  /*! \brief the matrix */
+  const bst_float* data_;
+  /*! \brief copy of the matrix made by OwnData() */
+  std::vector<bst_float> values_;
+  /*! \brief number of columns */
+  size_t ncol_;
+  /*! \brief bit i * ncol_ + j is set if cell (i, j) is missing; empty if none is */
+  common::BitMap missing_;
+  /*! \brief maximum number of entries in a batch */
+  size_t entries_per_batch_;
+  /*! \brief offset of the entries of each row, nrow + 1 values */
+  std::vector<size_t> row_ptr_;
+  /*! \brief first row of the next batch */
+  size_t next_rowid_;
+  /*! \brief offsets of the rows of the current batch, starting from 0 */
+  std::vector<size_t> batch_ptr_;
+  /*! \brief entries of the current batch */
+  std::vector<RowBatch::Entry> batch_data_;
+  /*! \brief the current batch */
+  RowBatch batch_;
+};
+}  // namespace data
+}  // namespace xgboost
+#endif  // XGBOOST_DATA_DENSE_SOURCE_H_
@@ -65,7 +65,10 @@ void SimpleDMatrix::InitColAccess(const std::vector<bool> &enabled,
   } else {
     this->MakeManyBatch(enabled, pkeep, max_row_perbatch);
   }
-  // setup col-size
+  this->InitColSize();
+}
+
+void SimpleDMatrix::InitColSize() {
   col_size_.resize(info().num_col);
   std::fill(col_size_.begin(), col_size_.end(), 0);
   for (size_t i = 0; i < col_iter_.cpages_.size(); ++i) {
@@ -104,7 +107,7 @@ void SimpleDMatrix::MakeOneBatch(const std::vector<bool>& enabled,
       if (pkeep == 1.0f || coin_flip(rnd)) {
         buffered_rowset_.push_back(ridx);
       } else {
-        bmap[i] = false;
+        bmap[ridx] = false;
       }
     }
     #pragma omp parallel for schedule(static)
@@ -199,7 +202,7 @@ void SimpleDMatrix::MakeColPage(const RowBatch& batch,
                                 size_t buffer_begin,
                                 const std::vector<bool>& enabled,
                                 SparsePage* pcol) {
-  const int nthread = std::min(omp_get_max_threads(), std::max(omp_get_num_procs() / 2 - 2, 1));
+  const int nthread = omp_get_max_threads();
   pcol->Clear();
   common::ParallelGroupBuilder<SparseBatch::Entry>
       builder(&pcol->offset, &pcol->data);
@@ -63,7 +63,7 @@ class SimpleDMatrix : public DMatrix {
 
   bool SingleColBlock() const override;
 
- private:
+ protected:
   // in-memory column batch iterator.
   struct ColBatchIter: dmlc::DataIter<ColBatch> {
    public:
@@ -79,6 +79,7 @@ class SimpleDMatrix : public DMatrix {
    private:
     // allow SimpleDMatrix to access it.
     friend class SimpleDMatrix;
+    friend class SliceDMatrix;
     // data content
     std::vector<bst_uint> col_index_;
     // column content
@@ -100,6 +101,9 @@ class SimpleDMatrix : public DMatrix {
   /*! \brief sizeof column data */
   std::vector<size_t> col_size_;
 
+  // count the entries of each column over all column pages.
+  void InitColSize();
+
   // internal function to make one batch from row iter.
   void MakeOneBatch(const std::vector<bool>& enabled,
                     float pkeep,
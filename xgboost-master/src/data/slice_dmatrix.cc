@@ -0,0 +1,288 @@
+/*!
+ * Copyright 2017 by Contributors
+ * \file slice_dmatrix.cc
+ * \brief DMatrix viewing a subset of the rows of another DMatrix.
+ */
+#include <dmlc/base.h>
+#include <dmlc/omp.h>
+#include <xgboost/logging.h>
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include "./slice_dmatrix.h"
+
+namespace xgboost {
+namespace data {
+
+const size_t SliceSource::kEntriesPerBatch;
+
+SliceSource::SliceSource(std::shared_ptr<DMatrix> parent, std::vector<bst_uint> ridx,
+                         size_t entries_per_batch)
+    : parent_(std::move(parent)), ridx_(std::move(ridx)),
+      entries_per_batch_(entries_per_batch), copied_(false), next_pos_(0) {
+  const MetaInfo& src = parent_->info();
+  CHECK_EQ(src.group_ptr.size(), 0U)
+      << "slice does not support group structure";
+  for (size_t i = 0; i < ridx_.size(); ++i) {
+    CHECK_LT(ridx_[i], src.num_row) << "slice index out of range";
+  }
+}
+
+void SliceSource::GatherInfo() {
+  const MetaInfo& src = parent_->info();
+  const size_t nrow = ridx_.size();
+  info.num_row = nrow;
+  info.num_col = src.num_col;
+  if (src.labels.size() != 0) {
+    info.labels.resize(nrow);
+    for (size_t i = 0; i < nrow; ++i) info.labels[i] = src.labels[ridx_[i]];
+  }
+  if (src.weights.size() != 0) {
+    info.weights.resize(nrow);
+    for (size_t i = 0; i < nrow; ++i) info.weights[i] = src.weights[ridx_[i]];
+  }
+  if (src.root_index.size() != 0) {
+    info.root_index.resize(nrow);
+    for (size_t i = 0; i < nrow; ++i) info.root_index[i] = src.root_index[ridx_[i]];
+  }
+  if (src.base_margin.size() != 0) {
+    // one margin per output group
+    const size_t ngroup = src.base_margin.size() / src.num_row;
+    info.base_margin.resize(nrow * ngroup);
+    for (size_t i = 0; i < nrow; ++i) {
+      const bst_float* margin = dmlc::BeginPtr(src.base_margin) + ridx_[i] * ngroup;
+      std::copy(margin, margin + ngroup, dmlc::BeginPtr(info.base_margin) + i * ngroup);
+    }
+  }
+  this->FetchParent();
+  info.num_nonzero = 0;
+  for (size_t i = 0; i < nrow; ++i) {
+    const size_t k = copied_ ? i : ridx_[i];
+    info.num_nonzero += parent_batch_.ind_ptr[k + 1] - parent_batch_.ind_ptr[k];
+  }
+}
+
+void SliceSource::InitRowMap() {
+  if (pos_.size() == ridx_.size() && pos_ptr_.size() != 0) return;
+  pos_ptr_.assign(parent_->info().num_row + 1, 0);
+  for (bst_uint ridx : ridx_) {
+    ++pos_ptr_[ridx + 1];
+  }
+  std::partial_sum(pos_ptr_.begin(), pos_ptr_.end(), pos_ptr_.begin());
+  pos_.resize(ridx_.size());
+  std::vector<size_t> top(pos_ptr_.begin(), pos_ptr_.end() - 1);
+  for (size_t i = 0; i < ridx_.size(); ++i) {
+    pos_[top[ridx_[i]]++] = static_cast<bst_uint>(i);
+  }
+}
+
+void SliceSource::FetchParent() {
+  if (copied_) return;
+  dmlc::DataIter<RowBatch>* iter = parent_->RowIterator();
+  iter->BeforeFirst();
+  if (iter->Next() && iter->Value().base_rowid == 0 &&
+      iter->Value().size == parent_->info().num_row) {
+    parent_batch_ = iter->Value();
+    return;
+  }
+  this->CopyRows();
+}
+
+void SliceSource::CopyRows() {
+  this->InitRowMap();
+  const size_t nrow = ridx_.size();
+  copy_ptr_.assign(nrow + 1, 0);
+  dmlc::DataIter<RowBatch>* iter = parent_->RowIterator();
+  // count the entries of each row of the slice, then copy them in a second pass
+  iter->BeforeFirst();
+  while (iter->Next()) {
+    const RowBatch& batch = iter->Value();
+    const omp_ulong ndata = static_cast<omp_ulong>(batch.size);
+    #pragma omp parallel for schedule(static)
+    for (omp_ulong i = 0; i < ndata; ++i) {
+      const size_t ridx = batch.base_rowid + i;
+      const size_t length = batch.ind_ptr[i + 1] - batch.ind_ptr[i];
+      for (const bst_uint* k = this->PosBegin(ridx); k != this->PosEnd(ridx); ++k) {
+        copy_ptr_[*k + 1] = length;
+      }
+    }
+  }
+  std::partial_sum(copy_ptr_.begin(), copy_ptr_.end(), copy_ptr_.begin());
+  copy_data_.resize(copy_ptr_.back());
+  iter->BeforeFirst();
+  while (iter->Next()) {
+    const RowBatch& batch = iter->Value();
+    const omp_ulong ndata = static_cast<omp_ulong>(batch.size);
+    #pragma omp parallel for schedule(static)
+    for (omp_ulong i = 0; i < ndata; ++i) {
+      const size_t ridx = batch.base_rowid + i;
+      const RowBatch::Inst inst = batch[i];
+      for (const bst_uint* k = this->PosBegin(ridx); k != this->PosEnd(ridx); ++k) {
+        std::memcpy(dmlc::BeginPtr(copy_data_) + copy_ptr_[*k], inst.data,
+                    sizeof(RowBatch::Entry) * inst.length);
+      }
+    }
+  }
+  parent_batch_.size = nrow;
+  parent_batch_.base_rowid = 0;
+  parent_batch_.ind_ptr = dmlc::BeginPtr(copy_ptr_);
+  parent_batch_.data_ptr = dmlc::BeginPtr(copy_data_);
+  copied_ = true;
+}
+
+void SliceSource::BeforeFirst() {
+  next_pos_ = 0;
+  this->FetchParent();
+}
+
+bool SliceSource::Next() {
+  const size_t nrow = ridx_.size();
+  if (next_pos_ >= nrow) return false;
+  if (copied_) {
+    // the copy is already laid out as the slice
+    next_pos_ = nrow;
+    batch_ = parent_batch_;
+    return true;
+  }
+  // take rows while the batch has at most entries_per_batch_ entries, and at least one row
+  const size_t begin = next_pos_;
+  batch_ptr_.resize(1);
+  size_t end = begin;
+  while (end < nrow) {
+    const size_t ridx = ridx_[end];
+    const size_t length = parent_batch_.ind_ptr[ridx + 1] - parent_batch_.ind_ptr[ridx];
+    if (end != begin && batch_ptr_.back() + length > entries_per_batch_) break;
+    batch_ptr_.push_back(batch_ptr_.back() + length);
+    ++end;
+  }
+  batch_data_.resize(batch_ptr_.back());
+  const omp_ulong ndata = static_cast<omp_ulong>(end - begin);
+  #pragma omp parallel for schedule(static)
+  for (omp_ulong i = 0; i < ndata; ++i) {
+    const RowBatch::Inst inst = parent_batch_[ridx_[begin + i]];
+    std::memcpy(dmlc::BeginPtr(batch_data_) + batch_ptr_[i], inst.data,
+                sizeof(RowBatch::Entry) * inst.length);
+  }
+  batch_.size = end - begin;
+  batch_.base_rowid = begin;
+  batch_.ind_ptr = dmlc::BeginPtr(batch_ptr_);
+  batch_.data_ptr = dmlc::BeginPtr(batch_data_);
+  next_pos_ = end;
+  return true;
+}
+
+const RowBatch& SliceSource::Value() const {
+  return batch_;
+}
+
+void SliceDMatrix::InitColAccess(const std::vector<bool>& enabled,
+                                 float pkeep,
+                                 size_t max_row_perbatch) {
+  if (this->HaveColAccess()) return;
+  // the learner builds column pages of all features and rows, so parent pages built
+  // that way hold every entry the slice needs. Pages built for a subset of the rows
+  // or of the features miss some entries, which shows in the column sizes
+  DMatrix* parent = slice_->Parent();
+  const bool all_enabled = std::find(enabled.begin(), enabled.end(), false) == enabled.end();
+  if (pkeep != 1.0f || !all_enabled || !parent->HaveColAccess() ||
+      parent->buffered_rowset().size() != parent->info().num_row ||
+      NumColEntry(parent) != parent->info().num_nonzero) {
+    SimpleDMatrix::InitColAccess(enabled, pkeep, max_row_perbatch);
+    return;
+  }
+  this->FilterParentColPages(max_row_perbatch);
+  this->InitColSize();
+  CHECK_EQ(NumColEntry(this), this->info().num_nonzero)
+      << "column pages of the slice miss some entries";
+}
+
+size_t SliceDMatrix::NumColEntry(const DMatrix* fmat) {
+  size_t nentry = 0;
+  for (size_t fid = 0; fid < fmat->info().num_col; ++fid) {
+    nentry += fmat->GetColSize(fid);
+  }
+  return nentry;
+}
+
+void SliceDMatrix::FilterParentColPages(size_t max_row_perbatch) {
+  const size_t nrow = this->info().num_row;
+  const size_t ncol = this->info().num_col;
+  // same partition of rows into pages as SimpleDMatrix
+  const size_t page_rows = std::max(nrow < max_row_perbatch ? nrow : max_row_perbatch,
+                                    static_cast<size_t>(1));
+  const size_t npage = std::max((nrow + page_rows - 1) / page_rows, static_cast<size_t>(1));
+  buffered_rowset_.resize(nrow);
+  for (size_t i = 0; i < nrow; ++i) {
+    buffered_rowset_[i] = static_cast<bst_uint>(i);
+  }
+  std::vector<SparsePage*> pages(npage);
+  col_iter_.cpages_.clear();
+  for (size_t p = 0; p < npage; ++p) {
+    col_iter_.cpages_.emplace_back(new SparsePage());
+    pages[p] = col_iter_.cpages_.back().get();
+    pages[p]->offset.assign(ncol + 1, 0);
+  }
+  slice_->InitRowMap();
+
+  // count the entries of each column of each page, then fill them in a second pass.
+  // A column is handled by one thread, so counts and fills don't race
+  dmlc::DataIter<ColBatch>* iter = slice_->Parent()->ColIterator();
+  size_t nparent_page = 0;
+  iter->BeforeFirst();
+  while (iter->Next()) {
+    const ColBatch& batch = iter->Value();
+    const bst_omp_uint nsize = static_cast<bst_omp_uint>(batch.size);
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (bst_omp_uint i = 0; i < nsize; ++i) {
+      const bst_uint fid = batch.col_index[i];
+      const ColBatch::Inst col = batch[i];
+      for (bst_uint j = 0; j < col.length; ++j) {
+        const bst_uint ridx = col[j].index;
+        for (const bst_uint* k = slice_->PosBegin(ridx); k != slice_->PosEnd(ridx); ++k) {
+          ++pages[*k / page_rows]->offset[fid + 1];
+        }
+      }
+    }
+    ++nparent_page;
+  }
+  std::vector<std::vector<size_t> > top(npage);
+  for (size_t p = 0; p < npage; ++p) {
+    std::partial_sum(pages[p]->offset.begin(), pages[p]->offset.end(),
+                     pages[p]->offset.begin());
+    pages[p]->data.resize(pages[p]->offset.back());
+    top[p].assign(pages[p]->offset.begin(), pages[p]->offset.end() - 1);
+  }
+  iter->BeforeFirst();
+  while (iter->Next()) {
+    const ColBatch& batch = iter->Value();
+    const bst_omp_uint nsize = static_cast<bst_omp_uint>(batch.size);
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (bst_omp_uint i = 0; i < nsize; ++i) {
+      const bst_uint fid = batch.col_index[i];
+      const ColBatch::Inst col = batch[i];
+      for (bst_uint j = 0; j < col.length; ++j) {
+        const bst_uint ridx = col[j].index;
+        for (const bst_uint* k = slice_->PosBegin(ridx); k != slice_->PosEnd(ridx); ++k) {
+          const size_t p = *k / page_rows;
+          pages[p]->data[top[p][fid]++] = SparseBatch::Entry(*k, col[j].fvalue);
+        }
+      }
+    }
+  }
+  // entries of a parent page come out sorted by value; those of several pages need a sort
+  if (nparent_page > 1) {
+    for (size_t p = 0; p < npage; ++p) {
+      SparsePage* pcol = pages[p];
+      const bst_omp_uint nsize = static_cast<bst_omp_uint>(ncol);
+      #pragma omp parallel for schedule(dynamic, 1)
+      for (bst_omp_uint i = 0; i < nsize; ++i) {
+        std::sort(dmlc::BeginPtr(pcol->data) + pcol->offset[i],
+                  dmlc::BeginPtr(pcol->data) + pcol->offset[i + 1],
+                  SparseBatch::Entry::CmpValue);
+      }
+    }
+  }
+}
+
+}  // namespace data
+}  // namespace xgboost
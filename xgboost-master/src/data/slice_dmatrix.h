@@ -0,0 +1,143 @@
+/*!
+ * Copyright 2017 by Contributors
+ * \file slice_dmatrix.h
+ * \brief DMatrix viewing a subset of the rows of another DMatrix.
+ */
+#ifndef XGBOOST_DATA_SLICE_DMATRIX_H_
+#define XGBOOST_DATA_SLICE_DMATRIX_H_
+
+#include <xgboost/base.h>
+#include <xgboost/data.h>
+#include <memory>
+#include <vector>
+#include "./simple_dmatrix.h"
+
+namespace xgboost {
+namespace data {
+/*!
+ * \brief Data source over rows ridx[0], ridx[1], ... of a parent DMatrix, which is shared
+ *  with the source. Row indices may repeat and need not be sorted, as in bagging.
+ *
+ *  Nothing is copied up front. If the parent holds all of its rows in a single batch,
+ *  as an in-memory matrix does, the rows of the slice are gathered from it a batch at
+ *  a time while iterating. Otherwise they are copied once, in two passes over the
+ *  parent, the first time they are needed. The parent must not be iterated while the
+ *  slice is.
+ */
+class SliceSource : public DataSource {
+ public:
+  /*!
+   * \brief create the source
+   * \param parent the matrix being sliced
+   * \param ridx rows of the parent forming the slice, in order
+   * \param entries_per_batch maximum number of entries in a batch, unless a row holds more
+   */
+  SliceSource(std::shared_ptr<DMatrix> parent, std::vector<bst_uint> ridx,
+              size_t entries_per_batch = kEntriesPerBatch);
+  /*! \brief fill info with the meta data of the rows of the slice */
+  void GatherInfo();
+  /*! \brief make the map from rows of the parent to their positions in the slice */
+  void InitRowMap();
+  /*! \brief positions in the slice of row ridx of the parent, after InitRowMap() */
+  inline const bst_uint* PosBegin(size_t ridx) const {
+    return dmlc::BeginPtr(pos_) + pos_ptr_[ridx];
+  }
+  inline const bst_uint* PosEnd(size_t ridx) const {
+    return dmlc::BeginPtr(pos_) + pos_ptr_[ridx + 1];
+  }
+  /*! \brief the matrix being sliced */
+  inline DMatrix* Parent() const {
+    return parent_.get();
+  }
+  // implement Next
+  bool Next() override;
+  // implement BeforeFirst
+  void BeforeFirst() override;
+  // implement Value
+  const RowBatch &Value() const override;
+  /*! \brief default maximum number of entries in a batch */
+  static const size_t kEntriesPerBatch = 1UL << 22;
+
+ private:
+  /*! \brief set parent_batch_, copying the rows of the slice if needed */
+  void FetchParent();
+  /*! \brief copy the rows of the slice out of all batches of the parent */
+  void CopyRows();
+  /*! \brief the matrix being sliced */
+  std::shared_ptr<DMatrix> parent_;
+  /*! \brief rows of the parent forming the slice */
+  std::vector<bst_uint> ridx_;
+  /*! \brief maximum number of entries in a batch */
+  size_t entries_per_batch_;
+  /*! \brief positions of row i of the parent are pos_[pos_ptr_[i]..pos_ptr_[i + 1]) */
+  std::vector<size_t> pos_ptr_;
+  std::vector<bst_uint> pos_;
+  /*! \brief whether the rows have been copied into copy_ptr_ and copy_data_ */
+  bool copied_;
+  /*! \brief rows of the slice, copied when the parent has more than one batch */
+  std::vector<size_t> copy_ptr_;
+  std::vector<RowBatch::Entry> copy_data_;
+  /*! \brief all rows of the parent, or the copy of the slice if copied_ is set */
+  RowBatch parent_batch_;
+  /*! \brief first row of the next batch */
+  size_t next_pos_;
+  /*! \brief offsets of the rows of the current batch, starting from 0 */
+  std::vector<size_t> batch_ptr_;
+  /*! \brief entries of the current batch */
+  std::vector<RowBatch::Entry> batch_data_;
+  /*! \brief the current batch */
+  RowBatch batch_;
+};
+
+/*!
+ * \brief view of a subset of the rows of a parent DMatrix, as created by
+ *  XGDMatrixSliceDMatrix. Row batches are gathered from the parent on demand, meta data
+ *  is gathered on first access, and column pages are filtered out of those of the
+ *  parent when it already has them, instead of being built from rows and sorted.
+ */
+class SliceDMatrix : public SimpleDMatrix {
+ public:
+  /*!
+   * \brief create the view
+   * \param parent the matrix being sliced, which must not have groups
+   * \param ridx rows of the parent forming the slice, in order
+   */
+  SliceDMatrix(std::shared_ptr<DMatrix> parent, std::vector<bst_uint> ridx)
+      : SliceDMatrix(new SliceSource(std::move(parent), std::move(ridx))) {}
+
+  MetaInfo& info() override {
+    this->LazyInitInfo();
+    return SimpleDMatrix::info();
+  }
+
+  const MetaInfo& info() const override {
+    const_cast<SliceDMatrix*>(this)->LazyInitInfo();
+    return SimpleDMatrix::info();
+  }
+
+  void InitColAccess(const std::vector<bool>& enabled,
+                     float subsample,
+                     size_t max_row_perbatch) override;
+
+ private:
+  explicit SliceDMatrix(SliceSource* source)
+      : SimpleDMatrix(std::unique_ptr<DataSource>(source)),
+        slice_(source), info_ready_(false) {}
+  inline void LazyInitInfo() {
+    if (!info_ready_) {
+      slice_->GatherInfo();
+      info_ready_ = true;
+    }
+  }
+  // make column pages of max_row_perbatch rows by filtering the column pages of the parent
+  void FilterParentColPages(size_t max_row_perbatch);
+  // number of entries in the column pages of fmat
+  static size_t NumColEntry(const DMatrix* fmat);
+  /*! \brief the source, owned by SimpleDMatrix */
+  SliceSource* slice_;
+  /*! \brief whether info has been gathered */
+  bool info_ready_;
+};
+}  // namespace data
+}  // namespace xgboost
+#endif  // XGBOOST_DATA_SLICE_DMATRIX_H_
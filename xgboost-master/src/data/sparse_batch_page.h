@@ -20,6 +20,8 @@
 
 #if DMLC_ENABLE_STD_THREAD
 #include <dmlc/concurrency.h>
+#include <dmlc/threadediter.h>
+#include <atomic>
 #include <thread>
 #endif
 
@@ -38,6 +40,8 @@ class SparsePage {
   class Format;
   /*! \brief Writer to write the sparse page to files. */
   class Writer;
+  /*! \brief Reader to prefetch the sparse pages of a file. */
+  class Reader;
   /*! \brief minimum index of all index, used as hint for compression. */
   bst_uint min_index;
   /*! \brief offset of the segments */
@@ -171,6 +175,44 @@ class SparsePage::Format {
    * \param fo output stream
    */
   virtual void Write(const SparsePage& page, dmlc::Stream* fo) = 0;
+  /*!
+   * \brief A page as stored in the file, read but not yet decoded.
+   *  Formats that support it let the reader fetch the next page while
+   *  another thread decodes the current one.
+   */
+  class Encoded {
+   public:
+    /*! \brief virtual destructor */
+    virtual ~Encoded() {}
+  };
+  /*!
+   * \brief Create a holder of pages read by ReadEncoded.
+   * \return the holder, or nullptr if the format only supports Read, the default.
+   */
+  virtual Encoded* CreateEncoded() {
+    return nullptr;
+  }
+  /*!
+   * \brief Read the next page without decoding it, advance fi to end of the block.
+   * \param page holder created by CreateEncoded.
+   * \param fi the input stream of the file
+   * \return true of the loading as successful, false if end of file was reached
+   */
+  virtual bool ReadEncoded(Encoded* page, dmlc::SeekStream* fi) {
+    LOG(FATAL) << "The page format does not support ReadEncoded";
+    return false;
+  }
+  /*!
+   * \brief Decode a page read by ReadEncoded.
+   *  Must not touch state used by ReadEncoded, as both run at the same time.
+   * \param encoded the page read by ReadEncoded, can be used as scratch space.
+   * \param page The page to load the data into.
+   * \param sorted_index_set sorted index of segments we are interested in, nullptr for all.
+   */
+  virtual void Decode(Encoded* encoded, SparsePage* page,
+                      const std::vector<bst_uint>* sorted_index_set) {
+    LOG(FATAL) << "The page format does not support Decode";
+  }
   /*!
    * \brief Create sparse page of format.
    * \return The created format functors.
@@ -184,6 +226,33 @@ class SparsePage::Format {
 };
 
 #if DMLC_ENABLE_STD_THREAD
+/*!
+ * \brief pages and bytes handled, and time spent, by one stage of a page pipeline.
+ *  Can be updated from several threads at once.
+ */
+struct PageStageCounter {
+  std::atomic<size_t> num_page;
+  std::atomic<size_t> num_bytes;
+  std::atomic<uint64_t> num_usec;
+
+  PageStageCounter() : num_page(0), num_bytes(0), num_usec(0) {}
+  /*! \brief record a page of nbytes bytes handled in the given time */
+  inline void Add(size_t nbytes, double seconds) {
+    num_page += 1;
+    num_bytes += nbytes;
+    num_usec += static_cast<uint64_t>(seconds * 1e6);
+  }
+  /*! \return time spent in seconds */
+  inline double Seconds() const {
+    return static_cast<double>(num_usec.load()) * 1e-6;
+  }
+  /*! \return throughput in MB per second of time spent */
+  inline double MBPerSec() const {
+    const double sec = this->Seconds();
+    return sec == 0.0 ? 0.0 : static_cast<double>(num_bytes.load() >> 20UL) / sec;
+  }
+};
+
 /*!
  * \brief A threaded writer to write sparse batch page to sharded files.
  */
@@ -194,11 +263,14 @@ class SparsePage::Writer {
    * \param name_shards name of shard files.
    * \param format_shards format of each shard.
    * \param extra_buffer_capacity Extra buffer capacity before block.
+   * \param counter if not nullptr, records the pages written and the time spent
+   *  encoding and writing them.
    */
   explicit Writer(
       const std::vector<std::string>& name_shards,
       const std::vector<std::string>& format_shards,
-      size_t extra_buffer_capacity);
+      size_t extra_buffer_capacity,
+      PageStageCounter* counter = nullptr);
   /*! \brief destructor, will close the files automatically */
   ~Writer();
   /*!
@@ -228,6 +300,61 @@ class SparsePage::Writer {
   /*! \brief worker threads */
   std::vector<dmlc::ConcurrentBlockingQueue<std::shared_ptr<SparsePage> > > qworkers_;
 };
+
+/*!
+ * \brief A threaded reader to prefetch the sparse pages of a file.
+ *  If the format supports ReadEncoded, one thread reads the pages and another
+ *  decodes them, so that decoding a page overlaps the read of the next one.
+ *  Otherwise a single thread reads pages with Format::Read.
+ */
+class SparsePage::Reader {
+ public:
+  /*!
+   * \brief constructor, starts reading the pages.
+   * \param fi the input stream, positioned at the first page, not owned.
+   * \param fmt format of the pages, not owned.
+   * \param max_capacity maximum number of pages read ahead by each thread.
+   * \param load_all whether to load all segments, otherwise none is loaded
+   *  until BeforeFirst chooses them.
+   */
+  Reader(dmlc::SeekStream* fi, Format* fmt, size_t max_capacity, bool load_all);
+  /*! \brief destructor, stops the threads */
+  ~Reader();
+  /*!
+   * \brief Restart from the first page.
+   * \param sorted_index_set sorted index of segments to load from now on.
+   * \param load_all whether to load all segments instead.
+   */
+  void BeforeFirst(const std::vector<bst_uint>& sorted_index_set, bool load_all);
+  /*! \brief Restart from the first page, loading the segments chosen last time. */
+  void BeforeFirst();
+  /*!
+   * \brief Get the next page, blocking until it is ready.
+   * \param out_page Used to store the page, must be recycled before being replaced.
+   * \return false if end of file was reached.
+   */
+  bool Next(SparsePage** out_page);
+  /*!
+   * \brief Give a page back to the reader.
+   * \param inout_page The page, set to nullptr.
+   */
+  void Recycle(SparsePage** inout_page);
+
+ private:
+  /*! \brief input stream */
+  dmlc::SeekStream* fi_;
+  /*! \brief page format */
+  Format* fmt_;
+  /*! \brief position of the first page */
+  size_t fbegin_;
+  /*! \brief segments chosen by the caller, and those used by the decoding thread */
+  std::vector<bst_uint> set_index_set_, index_set_;
+  bool set_load_all_, load_all_;
+  /*! \brief thread reading encoded pages, if the format supports it */
+  std::unique_ptr<dmlc::ThreadedIter<Format::Encoded> > encoded_;
+  /*! \brief thread decoding pages, or reading them if there is no encoded_ */
+  std::unique_ptr<dmlc::ThreadedIter<SparsePage> > decoded_;
+};
 #endif  // DMLC_ENABLE_STD_THREAD
 
 /*!
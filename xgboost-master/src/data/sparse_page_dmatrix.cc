@@ -19,34 +19,28 @@ namespace xgboost {
 namespace data {
 
 SparsePageDMatrix::ColPageIter::ColPageIter(
-    std::vector<std::unique_ptr<dmlc::SeekStream> >&& files)
-    : page_(nullptr), clock_ptr_(0), files_(std::move(files)) {
-  load_all_ = false;
+    std::vector<std::unique_ptr<dmlc::SeekStream> >&& files,
+    const std::vector<std::string>& names)
+    : page_(nullptr), clock_ptr_(0), files_(std::move(files)), load_all_(false) {
+  CHECK_EQ(files_.size(), names.size());
   formats_.resize(files_.size());
   prefetchers_.resize(files_.size());
+  mapped_.resize(files_.size());
+  mapped_pos_.resize(files_.size(), 0);
 
   for (size_t i = 0; i < files_.size(); ++i) {
     dmlc::SeekStream* fi = files_[i].get();
     std::string format;
     CHECK(fi->Read(&format)) << "Invalid page format";
+    if (MappedPageFile::Supported(format)) {
+      // pages are used in place, no need for the stream
+      mapped_[i].reset(new MappedPageFile(names[i], fi->Tell()));
+      files_[i].reset(nullptr);
+      continue;
+    }
     formats_[i].reset(SparsePage::Format::Create(format));
-    SparsePage::Format* fmt = formats_[i].get();
-    size_t fbegin = fi->Tell();
-    prefetchers_[i].reset(new dmlc::ThreadedIter<SparsePage>(4));
-    prefetchers_[i]->Init([this, fi, fmt] (SparsePage** dptr) {
-        if (*dptr == nullptr) {
-          *dptr = new SparsePage();
-        }
-        if (load_all_) {
-          return fmt->Read(*dptr, fi);
-        } else {
-          return fmt->Read(*dptr, fi, index_set_);
-        }
-      },  [this, fi, fbegin] () {
-        fi->Seek(fbegin);
-        index_set_ = set_index_set_;
-        load_all_ = set_load_all_;
-      });
+    // the segments to load are chosen by Init
+    prefetchers_[i].reset(new SparsePage::Reader(fi, formats_[i].get(), 4, false));
   }
 }
 
@@ -60,37 +54,64 @@ bool SparsePageDMatrix::ColPageIter::Next() {
     size_t n = prefetchers_.size();
     prefetchers_[(clock_ptr_ + n - 1) % n]->Recycle(&page_);
   }
-  if (prefetchers_[clock_ptr_]->Next(&page_)) {
-    out_.col_index = dmlc::BeginPtr(index_set_);
+  out_.col_index = dmlc::BeginPtr(index_set_);
+  if (mapped_[clock_ptr_] != nullptr) {
+    const MappedPageFile& file = *mapped_[clock_ptr_];
+    size_t& pos = mapped_pos_[clock_ptr_];
+    if (pos == file.Size()) return false;
+    // columns point into the mapping, the selected ones only if not loading all
+    const size_t* offset = file.Offset(pos);
+    const SparseBatch::Entry* data = file.Data(pos);
+    col_data_.resize(load_all_ ? file.NumSegment(pos) : index_set_.size(),
+                     SparseBatch::Inst(nullptr, 0));
+    for (size_t i = 0; i < col_data_.size(); ++i) {
+      const size_t cid = load_all_ ? i : index_set_[i];
+      CHECK_LT(cid, file.NumSegment(pos));
+      col_data_[i] = SparseBatch::Inst(data + offset[cid],
+                                       static_cast<bst_uint>(offset[cid + 1] - offset[cid]));
+    }
+    file.Prefetch(++pos);
+  } else if (prefetchers_[clock_ptr_]->Next(&page_)) {
     col_data_.resize(page_->offset.size() - 1, SparseBatch::Inst(nullptr, 0));
     for (size_t i = 0; i < col_data_.size(); ++i) {
       col_data_[i] = SparseBatch::Inst
           (dmlc::BeginPtr(page_->data) + page_->offset[i],
            static_cast<bst_uint>(page_->offset[i + 1] - page_->offset[i]));
     }
-    out_.col_data = dmlc::BeginPtr(col_data_);
-    out_.size = col_data_.size();
-    // advance clock
-    clock_ptr_ = (clock_ptr_ + 1) % prefetchers_.size();
-    return true;
   } else {
     return false;
   }
+  out_.col_data = dmlc::BeginPtr(col_data_);
+  out_.size = col_data_.size();
+  // advance clock
+  clock_ptr_ = (clock_ptr_ + 1) % prefetchers_.size();
+  return true;
 }
 
 void SparsePageDMatrix::ColPageIter::BeforeFirst() {
   clock_ptr_ = 0;
   for (auto& p : prefetchers_) {
-    p->BeforeFirst();
+    if (p != nullptr) p->BeforeFirst();
+  }
+  for (size_t i = 0; i < mapped_.size(); ++i) {
+    mapped_pos_[i] = 0;
+    if (mapped_[i] != nullptr) mapped_[i]->Prefetch(0);
   }
 }
 
 void SparsePageDMatrix::ColPageIter::Init(const std::vector<bst_uint>& index_set,
                                           bool load_all) {
-  set_index_set_ = index_set;
-  set_load_all_ = load_all;
-  std::sort(set_index_set_.begin(), set_index_set_.end());
-  this->BeforeFirst();
+  index_set_ = index_set;
+  load_all_ = load_all;
+  std::sort(index_set_.begin(), index_set_.end());
+  clock_ptr_ = 0;
+  for (auto& p : prefetchers_) {
+    if (p != nullptr) p->BeforeFirst(index_set_, load_all);
+  }
+  for (size_t i = 0; i < mapped_.size(); ++i) {
+    mapped_pos_[i] = 0;
+    if (mapped_[i] != nullptr) mapped_[i]->Prefetch(0);
+  }
 }
 
 dmlc::DataIter<ColBatch>* SparsePageDMatrix::ColIterator() {
@@ -132,14 +153,16 @@ bool SparsePageDMatrix::TryInitColData() {
   }
   // load real data
   std::vector<std::unique_ptr<dmlc::SeekStream> > files;
+  std::vector<std::string> names;
   for (const std::string& prefix : cache_shards) {
     std::string col_data_name = prefix + ".col.page";
     std::unique_ptr<dmlc::SeekStream> fdata(
         dmlc::SeekStream::CreateForRead(col_data_name.c_str(), true));
     if (fdata.get() == nullptr) return false;
     files.push_back(std::move(fdata));
+    names.push_back(col_data_name);
   }
-  col_iter_.reset(new ColPageIter(std::move(files)));
+  col_iter_.reset(new ColPageIter(std::move(files), names));
   return true;
 }
 
@@ -159,17 +182,55 @@ void SparsePageDMatrix::InitColAccess(const std::vector<bool>& enabled,
   dmlc::DataIter<RowBatch>* iter = this->RowIterator();
   std::bernoulli_distribution coin_flip(pkeep);
   size_t batch_ptr = 0, batch_top = 0;
-  SparsePage tmp;
   auto& rnd = common::GlobalRandom();
+  col_build_stats_.reset(new ColPageBuildStats());
+  ColPageBuildStats& stats = *col_build_stats_;
+
+  // Column pages are built by a pipeline of three stages, which overlap:
+  //  - read: a thread pulls row batches and samples the rows of the next page
+  //  - transpose: this thread turns sampled rows into a column page, using all threads
+  //  - write: writer threads encode and write the pages, one thread per shard
+  // At most kRowPagesInFlight sampled pages and kColPagesInFlight column pages wait
+  // between stages, which bounds memory to a few pages.
+
+  // function to sample the rows of the next page.
+  auto make_next_rows = [&] (SampledRows* out) {
+    out->page.Clear();
+    out->ridx.clear();
+    while (true) {
+      if (batch_ptr != batch_top) {
+        const RowBatch& batch = iter->Value();
+        CHECK_EQ(batch_top, batch.size);
+        for (size_t i = batch_ptr; i < batch_top; ++i) {
+          bst_uint ridx = static_cast<bst_uint>(batch.base_rowid + i);
+          if (pkeep == 1.0f || coin_flip(rnd)) {
+            out->ridx.push_back(ridx);
+            out->page.Push(batch[i]);
+          }
+
+          if (out->page.Size() >= max_row_perbatch ||
+              out->page.MemCostBytes() >= kPageSize) {
+            batch_ptr = i + 1;
+            return true;
+          }
+        }
+        batch_ptr = batch_top;
+      }
+      if (!iter->Next()) break;
+      batch_ptr = 0;
+      batch_top = iter->Value().size;
+    }
+    return out->page.Size() != 0;
+  };
 
   // function to create the page.
   auto make_col_batch = [&] (
-      const SparsePage& prow,
-      size_t begin,
+      const SampledRows& rows,
       SparsePage *pcol) {
+    const SparsePage& prow = rows.page;
     pcol->Clear();
-    pcol->min_index = buffered_rowset_[begin];
-    const int nthread = std::max(omp_get_max_threads(), std::max(omp_get_num_procs() / 2 - 1, 1));
+    pcol->min_index = rows.ridx[0];
+    const int nthread = omp_get_max_threads();
     common::ParallelGroupBuilder<SparseBatch::Entry>
     builder(&pcol->offset, &pcol->data);
     builder.InitBudget(info.num_col, nthread);
@@ -191,7 +252,7 @@ void SparsePageDMatrix::InitColAccess(const std::vector<bool>& enabled,
       for (size_t j = prow.offset[i]; j < prow.offset[i+1]; ++j) {
         const SparseBatch::Entry &e = prow.data[j];
         builder.Push(e.index,
-                     SparseBatch::Entry(buffered_rowset_[i + begin], e.fvalue),
+                     SparseBatch::Entry(rows.ridx[i], e.fvalue),
                      tid);
       }
     }
@@ -208,43 +269,6 @@ void SparsePageDMatrix::InitColAccess(const std::vector<bool>& enabled,
     }
   };
 
-  auto make_next_col = [&] (SparsePage* dptr) {
-    tmp.Clear();
-    size_t btop = buffered_rowset_.size();
-
-    while (true) {
-      if (batch_ptr != batch_top) {
-        const RowBatch& batch = iter->Value();
-        CHECK_EQ(batch_top, batch.size);
-        for (size_t i = batch_ptr; i < batch_top; ++i) {
-          bst_uint ridx = static_cast<bst_uint>(batch.base_rowid + i);
-          if (pkeep == 1.0f || coin_flip(rnd)) {
-            buffered_rowset_.push_back(ridx);
-            tmp.Push(batch[i]);
-          }
-
-          if (tmp.Size() >= max_row_perbatch ||
-              tmp.MemCostBytes() >= kPageSize) {
-            make_col_batch(tmp, btop, dptr);
-            batch_ptr = i + 1;
-            return true;
-          }
-        }
-        batch_ptr = batch_top;
-      }
-      if (!iter->Next()) break;
-      batch_ptr = 0;
-      batch_top = iter->Value().size;
-    }
-
-    if (tmp.Size() != 0) {
-      make_col_batch(tmp, btop, dptr);
-      return true;
-    } else {
-      return false;
-    }
-  };
-
   std::vector<std::string> cache_shards = common::Split(cache_info_, ':');
   std::vector<std::string> name_shards, format_shards;
   for (const std::string& prefix : cache_shards) {
@@ -253,9 +277,19 @@ void SparsePageDMatrix::InitColAccess(const std::vector<bool>& enabled,
   }
 
   {
-    SparsePage::Writer writer(name_shards, format_shards, 6);
+    SparsePage::Writer writer(name_shards, format_shards, kColPagesInFlight, &stats.write);
     std::shared_ptr<SparsePage> page;
-    writer.Alloc(&page); page->Clear();
+    // declared after writer, so that the reader thread stops first
+    dmlc::ThreadedIter<SampledRows> reader(kRowPagesInFlight);
+    reader.Init([&] (SampledRows** dptr) {
+        if (*dptr == nullptr) {
+          *dptr = new SampledRows();
+        }
+        double tstart = dmlc::GetTime();
+        bool ret = make_next_rows(*dptr);
+        stats.read.Add((*dptr)->page.MemCostBytes(), dmlc::GetTime() - tstart);
+        return ret;
+      });
 
     double tstart = dmlc::GetTime();
     size_t bytes_write = 0;
@@ -263,15 +297,20 @@ void SparsePageDMatrix::InitColAccess(const std::vector<bool>& enabled,
     const double kStep = 4.0;
     size_t tick_expected = kStep;
 
-    while (make_next_col(page.get())) {
+    SampledRows* rows = nullptr;
+    while (reader.Next(&rows)) {
+      writer.Alloc(&page);
+      double ttranspose = dmlc::GetTime();
+      make_col_batch(*rows, page.get());
+      stats.transpose.Add(page->MemCostBytes(), dmlc::GetTime() - ttranspose);
+      buffered_rowset_.insert(buffered_rowset_.end(), rows->ridx.begin(), rows->ridx.end());
+      reader.Recycle(&rows);
       for (size_t i = 0; i < page->Size(); ++i) {
         col_size_[i] += page->offset[i + 1] - page->offset[i];
       }
 
       bytes_write += page->MemCostBytes();
       writer.PushWrite(std::move(page));
-      writer.Alloc(&page);
-      page->Clear();
 
       double tdiff = dmlc::GetTime() - tstart;
       if (tdiff >= tick_expected) {
@@ -289,6 +328,12 @@ void SparsePageDMatrix::InitColAccess(const std::vector<bool>& enabled,
     fo->Write(col_size_);
     fo.reset(nullptr);
   }
+  LOG(INFO) << "Built col.page of " << cache_info_ << ": "
+            << "read " << stats.read.MBPerSec() << " MB/s, "
+            << "transpose " << stats.transpose.MBPerSec() << " MB/s, "
+            << "write " << stats.write.MBPerSec() << " MB/s "
+            << "(" << (stats.write.num_bytes >> 20UL) << " MB in "
+            << stats.write.num_page << " pages)";
   // initialize column data
   CHECK(TryInitColData());
 }
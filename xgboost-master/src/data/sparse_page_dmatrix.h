@@ -14,6 +14,7 @@
 #include <algorithm>
 #include <string>
 #include "./sparse_batch_page.h"
+#include "./sparse_page_mmap_format.h"
 #include "../common/common.h"
 
 namespace xgboost {
@@ -21,6 +22,16 @@ namespace data {
 
 class SparsePageDMatrix : public DMatrix {
  public:
+  /*! \brief throughput of the stages of building column pages */
+  struct ColPageBuildStats {
+    /*! \brief reading row batches and sampling the rows of each page */
+    PageStageCounter read;
+    /*! \brief transposing sampled rows into column pages */
+    PageStageCounter transpose;
+    /*! \brief encoding and writing column pages */
+    PageStageCounter write;
+  };
+
   explicit SparsePageDMatrix(std::unique_ptr<DataSource>&& source,
                              const std::string& cache_info)
       : source_(std::move(source)), cache_info_(cache_info) {
@@ -69,16 +80,36 @@ class SparsePageDMatrix : public DMatrix {
                      float subsample,
                      size_t max_row_perbatch) override;
 
+  /*! \return the cache prefix of the page files */
+  const std::string& cache_info() const {
+    return cache_info_;
+  }
+
+  /*! \return stats of the last build of column pages, nullptr if none was built */
+  const ColPageBuildStats* col_build_stats() const {
+    return col_build_stats_.get();
+  }
+
   /*! \brief page size 256 MB */
   static const size_t kPageSize = 256UL << 20UL;
   /*! \brief Maximum number of rows per batch. */
   static const size_t kMaxRowPerBatch = 64UL << 10UL;
+  /*! \brief number of sampled row pages waiting to be transposed */
+  static const size_t kRowPagesInFlight = 2;
+  /*! \brief number of column pages waiting to be written, beyond one per shard */
+  static const size_t kColPagesInFlight = 6;
 
  private:
+  /*! \brief rows sampled for one column page, with their row ids */
+  struct SampledRows {
+    SparsePage page;
+    std::vector<bst_uint> ridx;
+  };
   // declare the column batch iter.
   class ColPageIter : public dmlc::DataIter<ColBatch> {
    public:
-    explicit ColPageIter(std::vector<std::unique_ptr<dmlc::SeekStream> >&& files);
+    ColPageIter(std::vector<std::unique_ptr<dmlc::SeekStream> >&& files,
+                const std::vector<std::string>& names);
     virtual ~ColPageIter();
     void BeforeFirst() override;
     const ColBatch &Value() const override {
@@ -98,13 +129,15 @@ class SparsePageDMatrix : public DMatrix {
     // page format.
     std::vector<std::unique_ptr<SparsePage::Format> > formats_;
     /*! \brief internal prefetcher. */
-    std::vector<std::unique_ptr<dmlc::ThreadedIter<SparsePage> > > prefetchers_;
+    std::vector<std::unique_ptr<SparsePage::Reader> > prefetchers_;
+    // pages of shards in the mmap format, used in place instead of prefetched.
+    std::vector<std::unique_ptr<MappedPageFile> > mapped_;
+    // next page of each mapped shard.
+    std::vector<size_t> mapped_pos_;
     // The index set to be loaded.
     std::vector<bst_uint> index_set_;
-    // The index set by the outsiders
-    std::vector<bst_uint> set_index_set_;
-    // whether to load data dataset.
-    bool set_load_all_, load_all_;
+    // whether to load all columns.
+    bool load_all_;
     // temporal space for batch
     ColBatch out_;
     // the pointer data.
@@ -125,6 +158,8 @@ class SparsePageDMatrix : public DMatrix {
   std::vector<size_t> col_size_;
   // internal column iter.
   std::unique_ptr<ColPageIter> col_iter_;
+  // stats of the last build of column pages.
+  std::unique_ptr<ColPageBuildStats> col_build_stats_;
 };
 }  // namespace data
 }  // namespace xgboost
@@ -0,0 +1,154 @@
+/*!
+ * Copyright 2017 by Contributors
+ * \file sparse_page_mmap_format.cc
+ * \brief Sparse page format that can be used in place from a memory mapping of the file.
+ */
+#include <xgboost/data.h>
+#include <xgboost/logging.h>
+#include <dmlc/registry.h>
+#include <cstring>
+#include <string>
+#include "./sparse_batch_page.h"
+#include "./sparse_page_mmap_format.h"
+
+namespace xgboost {
+namespace data {
+
+DMLC_REGISTRY_FILE_TAG(sparse_page_mmap_format);
+
+const size_t MappedPageFile::kPageAlign;
+const char* MappedPageFile::kFormatName = "mmap";
+
+MappedPageFile::MappedPageFile(const std::string& fname, size_t fbegin)
+    : map_(new common::MMapFile(fname)) {
+  const size_t size = map_->size();
+  size_t pos = AlignPage(fbegin);
+  while (pos < size) {
+    uint64_t header[2];
+    CHECK_LE(pos + sizeof(header), size) << "Invalid SparsePage file " << fname;
+    std::memcpy(header, map_->data() + pos, sizeof(header));
+    PageInfo page;
+    page.num_segment = static_cast<size_t>(header[0]);
+    page.offset_begin = pos + sizeof(header);
+    page.data_begin = page.offset_begin + (page.num_segment + 1) * sizeof(size_t);
+    page.end = page.data_begin + static_cast<size_t>(header[1]) * sizeof(SparseBatch::Entry);
+    CHECK_LE(page.end, size) << "Invalid SparsePage file " << fname;
+    pages_.push_back(page);
+    pos = AlignPage(page.end);
+  }
+  map_->AdviseSequential();
+}
+
+bool MappedPageFile::Supported(const std::string& format) {
+#ifndef _WIN32
+  return format == kFormatName;
+#else
+  // without mmap the whole file would be read into memory, use stream reads instead
+  return false;
+#endif  // _WIN32
+}
+
+void MappedPageFile::Prefetch(size_t i) const {
+  if (i < pages_.size()) {
+    map_->AdviseWillNeed(pages_[i].offset_begin, pages_[i].end - pages_[i].offset_begin);
+  }
+}
+
+/*!
+ * \brief Format of MappedPageFile. Pages can also be read through streams,
+ *  when the file is not mapped.
+ */
+class SparsePageMMapFormat : public SparsePage::Format {
+ public:
+  // the writer starts the file with the name of the format, as a serialized string
+  SparsePageMMapFormat()
+      : bytes_written_(sizeof(uint64_t) + std::strlen(MappedPageFile::kFormatName)) {}
+
+  bool Read(SparsePage* page, dmlc::SeekStream* fi) override {
+    uint64_t header[2];
+    if (!ReadHeader(fi, header)) return false;
+    page->offset.resize(header[0] + 1);
+    page->data.resize(header[1]);
+    CHECK_EQ(fi->Read(dmlc::BeginPtr(page->offset), page->offset.size() * sizeof(size_t)),
+             page->offset.size() * sizeof(size_t))
+        << "Invalid SparsePage file";
+    CHECK_EQ(page->offset.back(), page->data.size()) << "Invalid SparsePage file";
+    if (page->data.size() != 0) {
+      CHECK_EQ(fi->Read(dmlc::BeginPtr(page->data),
+                        page->data.size() * sizeof(SparseBatch::Entry)),
+               page->data.size() * sizeof(SparseBatch::Entry))
+          << "Invalid SparsePage file";
+    }
+    return true;
+  }
+
+  bool Read(SparsePage* page,
+            dmlc::SeekStream* fi,
+            const std::vector<bst_uint>& sorted_index_set) override {
+    uint64_t header[2];
+    if (!ReadHeader(fi, header)) return false;
+    disk_offset_.resize(header[0] + 1);
+    CHECK_EQ(fi->Read(dmlc::BeginPtr(disk_offset_), disk_offset_.size() * sizeof(size_t)),
+             disk_offset_.size() * sizeof(size_t))
+        << "Invalid SparsePage file";
+    const size_t begin = fi->Tell();
+    page->offset.clear();
+    page->offset.push_back(0);
+    for (bst_uint fid : sorted_index_set) {
+      CHECK_LT(fid + 1, disk_offset_.size());
+      page->offset.push_back(page->offset.back() + disk_offset_[fid + 1] - disk_offset_[fid]);
+    }
+    page->data.resize(page->offset.back());
+    for (size_t i = 0; i < sorted_index_set.size(); ++i) {
+      const size_t size = page->offset[i + 1] - page->offset[i];
+      if (size == 0) continue;
+      fi->Seek(begin + disk_offset_[sorted_index_set[i]] * sizeof(SparseBatch::Entry));
+      CHECK_EQ(fi->Read(dmlc::BeginPtr(page->data) + page->offset[i],
+                        size * sizeof(SparseBatch::Entry)),
+               size * sizeof(SparseBatch::Entry))
+          << "Invalid SparsePage file";
+    }
+    fi->Seek(begin + disk_offset_.back() * sizeof(SparseBatch::Entry));
+    return true;
+  }
+
+  void Write(const SparsePage& page, dmlc::Stream* fo) override {
+    CHECK(page.offset.size() != 0 && page.offset[0] == 0);
+    CHECK_EQ(page.offset.back(), page.data.size());
+    const size_t pad = MappedPageFile::AlignPage(bytes_written_) - bytes_written_;
+    if (pad != 0) {
+      std::string zeros(pad, '\0');
+      fo->Write(dmlc::BeginPtr(zeros), pad);
+    }
+    uint64_t header[2] = {page.offset.size() - 1, page.data.size()};
+    fo->Write(header, sizeof(header));
+    fo->Write(dmlc::BeginPtr(page.offset), page.offset.size() * sizeof(size_t));
+    if (page.data.size() != 0) {
+      fo->Write(dmlc::BeginPtr(page.data), page.data.size() * sizeof(SparseBatch::Entry));
+    }
+    bytes_written_ += pad + sizeof(header) + page.offset.size() * sizeof(size_t) +
+        page.data.size() * sizeof(SparseBatch::Entry);
+  }
+
+ private:
+  // move to the start of the next page and read its header
+  inline static bool ReadHeader(dmlc::SeekStream* fi, uint64_t header[2]) {
+    const size_t pos = fi->Tell();
+    if (MappedPageFile::AlignPage(pos) != pos) {
+      fi->Seek(MappedPageFile::AlignPage(pos));
+    }
+    return fi->Read(header, sizeof(uint64_t) * 2) == sizeof(uint64_t) * 2;
+  }
+  /*! \brief bytes of the file written so far, to align the pages */
+  size_t bytes_written_;
+  /*! \brief external memory column offset */
+  std::vector<size_t> disk_offset_;
+};
+
+XGBOOST_REGISTER_SPARSE_PAGE_FORMAT(mmap)
+.describe("Raw binary data format with page aligned pages, read through memory mapping.")
+.set_body([]() {
+    return new SparsePageMMapFormat();
+  });
+}  // namespace data
+}  // namespace xgboost
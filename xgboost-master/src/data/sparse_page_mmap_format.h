@@ -0,0 +1,87 @@
+/*!
+ * Copyright 2017 by Contributors
+ * \file sparse_page_mmap_format.h
+ * \brief Sparse page format that can be used in place from a memory mapping of the file.
+ */
+#ifndef XGBOOST_DATA_SPARSE_PAGE_MMAP_FORMAT_H_
+#define XGBOOST_DATA_SPARSE_PAGE_MMAP_FORMAT_H_
+
+#include <xgboost/base.h>
+#include <xgboost/data.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../common/io.h"
+
+namespace xgboost {
+namespace data {
+/*!
+ * \brief The pages of a file in the "mmap" format, mapped into memory and used in place.
+ *
+ *  Each page of the file starts on a kPageAlign boundary and holds the number of
+ *  segments and the number of entries as two uint64, then the offset of the segments,
+ *  then the entries. Batches point straight into the mapping, so repeated passes over
+ *  the pages are served from the OS page cache, without copies or allocations.
+ */
+class MappedPageFile {
+ public:
+  /*! \brief alignment of the pages in the file */
+  static const size_t kPageAlign = 4096;
+  /*! \brief name of the format */
+  static const char* kFormatName;
+  /*!
+   * \brief map a file of pages in the mmap format.
+   * \param fname name of the file
+   * \param fbegin position in the file after the format name
+   */
+  MappedPageFile(const std::string& fname, size_t fbegin);
+  /*! \return whether pages of the format can be mapped on this platform */
+  static bool Supported(const std::string& format);
+  /*! \return position of the next page for a reader at position pos */
+  inline static size_t AlignPage(size_t pos) {
+    return (pos + kPageAlign - 1) / kPageAlign * kPageAlign;
+  }
+  /*! \return number of pages */
+  inline size_t Size() const {
+    return pages_.size();
+  }
+  /*! \return number of segments of page i */
+  inline size_t NumSegment(size_t i) const {
+    return pages_[i].num_segment;
+  }
+  /*! \return offset of the segments of page i, NumSegment(i) + 1 values */
+  inline const size_t* Offset(size_t i) const {
+    return reinterpret_cast<const size_t*>(map_->data() + pages_[i].offset_begin);
+  }
+  /*! \return entries of page i */
+  inline const SparseBatch::Entry* Data(size_t i) const {
+    return reinterpret_cast<const SparseBatch::Entry*>(map_->data() + pages_[i].data_begin);
+  }
+  /*! \return row batch over page i, valid as long as the file is mapped */
+  inline RowBatch GetRowBatch(size_t i, size_t base_rowid) const {
+    RowBatch out;
+    out.base_rowid = base_rowid;
+    out.ind_ptr = this->Offset(i);
+    out.data_ptr = this->Data(i);
+    out.size = this->NumSegment(i);
+    return out;
+  }
+  /*! \brief hint that page i will be read soon, so that the OS starts loading it */
+  void Prefetch(size_t i) const;
+
+ private:
+  /*! \brief location of a page in the file */
+  struct PageInfo {
+    size_t num_segment;
+    size_t offset_begin;
+    size_t data_begin;
+    size_t end;
+  };
+  /*! \brief the mapped file */
+  std::unique_ptr<common::MMapFile> map_;
+  /*! \brief pages of the file */
+  std::vector<PageInfo> pages_;
+};
+}  // namespace data
+}  // namespace xgboost
+#endif  // XGBOOST_DATA_SPARSE_PAGE_MMAP_FORMAT_H_
@@ -0,0 +1,80 @@
+/*!
+ * Copyright (c) 2017 by Contributors
+ * \file sparse_page_reader.cc
+ * \brief Reader class to prefetch sparse pages.
+ */
+#include <xgboost/base.h>
+#include <xgboost/logging.h>
+#include "./sparse_batch_page.h"
+
+#if DMLC_ENABLE_STD_THREAD
+namespace xgboost {
+namespace data {
+
+SparsePage::Reader::Reader(dmlc::SeekStream* fi, Format* fmt, size_t max_capacity,
+                           bool load_all)
+    : fi_(fi), fmt_(fmt), fbegin_(fi->Tell()),
+      set_load_all_(load_all), load_all_(load_all) {
+  std::unique_ptr<Format::Encoded> probe(fmt_->CreateEncoded());
+  if (probe != nullptr) {
+    encoded_.reset(new dmlc::ThreadedIter<Format::Encoded>(max_capacity));
+    encoded_->Init([this] (Format::Encoded** dptr) {
+        if (*dptr == nullptr) {
+          *dptr = fmt_->CreateEncoded();
+        }
+        return fmt_->ReadEncoded(*dptr, fi_);
+      }, [this] () { fi_->Seek(fbegin_); });
+  }
+  decoded_.reset(new dmlc::ThreadedIter<SparsePage>(max_capacity));
+  decoded_->Init([this] (SparsePage** dptr) {
+      if (*dptr == nullptr) {
+        *dptr = new SparsePage();
+      }
+      if (encoded_ == nullptr) {
+        return load_all_ ? fmt_->Read(*dptr, fi_) : fmt_->Read(*dptr, fi_, index_set_);
+      }
+      Format::Encoded* page = nullptr;
+      if (!encoded_->Next(&page)) return false;
+      fmt_->Decode(page, *dptr, load_all_ ? nullptr : &index_set_);
+      encoded_->Recycle(&page);
+      return true;
+    }, [this] () {
+      // runs in the decoding thread, which is the consumer of encoded_
+      if (encoded_ == nullptr) {
+        fi_->Seek(fbegin_);
+      } else {
+        encoded_->BeforeFirst();
+      }
+      index_set_ = set_index_set_;
+      load_all_ = set_load_all_;
+    });
+}
+
+SparsePage::Reader::~Reader() {
+  // stop the decoding thread first, as it reads from encoded_
+  decoded_.reset(nullptr);
+  encoded_.reset(nullptr);
+}
+
+void SparsePage::Reader::BeforeFirst(const std::vector<bst_uint>& sorted_index_set,
+                                     bool load_all) {
+  set_index_set_ = sorted_index_set;
+  set_load_all_ = load_all;
+  this->BeforeFirst();
+}
+
+void SparsePage::Reader::BeforeFirst() {
+  decoded_->BeforeFirst();
+}
+
+bool SparsePage::Reader::Next(SparsePage** out_page) {
+  return decoded_->Next(out_page);
+}
+
+void SparsePage::Reader::Recycle(SparsePage** inout_page) {
+  decoded_->Recycle(inout_page);
+}
+
+}  // namespace data
+}  // namespace xgboost
+#endif  // DMLC_ENABLE_STD_THREAD
@@ -29,6 +29,8 @@ SparsePageSource::SparsePageSource(const std::string& cache_info)
   files_.resize(cache_shards.size());
   formats_.resize(cache_shards.size());
   prefetchers_.resize(cache_shards.size());
+  mapped_.resize(cache_shards.size());
+  mapped_pos_.resize(cache_shards.size(), 0);
 
   // read in the cache files.
   for (size_t i = 0; i < cache_shards.size(); ++i) {
@@ -37,16 +39,14 @@ SparsePageSource::SparsePageSource(const std::string& cache_info)
     dmlc::SeekStream* fi = files_[i].get();
     std::string format;
     CHECK(fi->Read(&format)) << "Invalid page format";
+    if (MappedPageFile::Supported(format)) {
+      // pages are used in place, no need for the stream
+      mapped_[i].reset(new MappedPageFile(name_row, fi->Tell()));
+      files_[i].reset(nullptr);
+      continue;
+    }
     formats_[i].reset(SparsePage::Format::Create(format));
-    SparsePage::Format* fmt = formats_[i].get();
-    size_t fbegin = fi->Tell();
-    prefetchers_[i].reset(new dmlc::ThreadedIter<SparsePage>(4));
-    prefetchers_[i]->Init([fi, fmt] (SparsePage** dptr) {
-        if (*dptr == nullptr) {
-          *dptr = new SparsePage();
-        }
-        return fmt->Read(*dptr, fi);
-      }, [fi, fbegin] () { fi->Seek(fbegin); });
+    prefetchers_[i].reset(new SparsePage::Reader(fi, formats_[i].get(), 4, true));
   }
 }
 
@@ -60,22 +60,32 @@ bool SparsePageSource::Next() {
     size_t n = prefetchers_.size();
     prefetchers_[(clock_ptr_ + n - 1) % n]->Recycle(&page_);
   }
-  if (prefetchers_[clock_ptr_]->Next(&page_)) {
+  if (mapped_[clock_ptr_] != nullptr) {
+    const MappedPageFile& file = *mapped_[clock_ptr_];
+    size_t& pos = mapped_pos_[clock_ptr_];
+    if (pos == file.Size()) return false;
+    batch_ = file.GetRowBatch(pos, base_rowid_);
+    file.Prefetch(++pos);
+  } else if (prefetchers_[clock_ptr_]->Next(&page_)) {
     batch_ = page_->GetRowBatch(base_rowid_);
-    base_rowid_ += batch_.size;
-    // advance clock
-    clock_ptr_ = (clock_ptr_ + 1) % prefetchers_.size();
-    return true;
   } else {
     return false;
   }
+  base_rowid_ += batch_.size;
+  // advance clock
+  clock_ptr_ = (clock_ptr_ + 1) % prefetchers_.size();
+  return true;
 }
 
 void SparsePageSource::BeforeFirst() {
   base_rowid_ = 0;
   clock_ptr_ = 0;
   for (auto& p : prefetchers_) {
-    p->BeforeFirst();
+    if (p != nullptr) p->BeforeFirst();
+  }
+  for (size_t i = 0; i < mapped_.size(); ++i) {
+    mapped_pos_[i] = 0;
+    if (mapped_[i] != nullptr) mapped_[i]->Prefetch(0);
   }
 }
 
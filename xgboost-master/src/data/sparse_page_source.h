@@ -14,6 +14,7 @@
 #include <algorithm>
 #include <string>
 #include "./sparse_batch_page.h"
+#include "./sparse_page_mmap_format.h"
 
 namespace xgboost {
 namespace data {
@@ -77,8 +78,12 @@ class SparsePageSource : public DataSource {
   std::vector<std::unique_ptr<dmlc::SeekStream> > files_;
   /*! \brief Sparse page format file. */
   std::vector<std::unique_ptr<SparsePage::Format> > formats_;
-  /*! \brief internal prefetcher. */
-  std::vector<std::unique_ptr<dmlc::ThreadedIter<SparsePage> > > prefetchers_;
+  /*! \brief internal prefetcher, declared after the files and formats it reads with. */
+  std::vector<std::unique_ptr<SparsePage::Reader> > prefetchers_;
+  /*! \brief pages of shards in the mmap format, used in place instead of prefetched. */
+  std::vector<std::unique_ptr<MappedPageFile> > mapped_;
+  /*! \brief next page of each mapped shard. */
+  std::vector<size_t> mapped_pos_;
 };
 }  // namespace data
 }  // namespace xgboost
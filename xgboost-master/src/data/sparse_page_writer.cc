@@ -5,6 +5,7 @@
  */
 #include <xgboost/base.h>
 #include <xgboost/logging.h>
+#include <dmlc/timer.h>
 #include "./sparse_batch_page.h"
 
 #if DMLC_ENABLE_STD_THREAD
@@ -14,7 +15,8 @@ namespace data {
 SparsePage::Writer::Writer(
     const std::vector<std::string>& name_shards,
     const std::vector<std::string>& format_shards,
-    size_t extra_buffer_capacity)
+    size_t extra_buffer_capacity,
+    PageStageCounter* counter)
     : num_free_buffer_(extra_buffer_capacity + name_shards.size()),
       clock_ptr_(0),
       workers_(name_shards.size()),
@@ -26,7 +28,7 @@ SparsePage::Writer::Writer(
     std::string format_shard = format_shards[i];
     auto* wqueue = &qworkers_[i];
     workers_[i].reset(new std::thread(
-        [this, name_shard, format_shard, wqueue] () {
+        [this, name_shard, format_shard, wqueue, counter] () {
           std::unique_ptr<dmlc::Stream> fo(
               dmlc::Stream::Create(name_shard.c_str(), "w"));
           std::unique_ptr<SparsePage::Format> fmt(
@@ -35,7 +37,11 @@ SparsePage::Writer::Writer(
           std::shared_ptr<SparsePage> page;
           while (wqueue->Pop(&page)) {
             if (page.get() == nullptr) break;
+            double tstart = dmlc::GetTime();
             fmt->Write(*page, fo.get());
+            if (counter != nullptr) {
+              counter->Add(page->MemCostBytes(), dmlc::GetTime() - tstart);
+            }
             qrecycle_.Push(std::move(page));
           }
           fo.reset(nullptr);
@@ -0,0 +1,56 @@
+/*!
+ * Copyright 2017 by Contributors
+ * \file compiled_trees.cc
+ * \brief Flat array layout of tree ensembles, for fast prediction
+ */
+#include <xgboost/logging.h>
+#include <limits>
+#include "./compiled_trees.h"
+
+namespace xgboost {
+namespace gbm {
+
+const int CompiledTrees::kBlockOfRows;
+
+void CompiledTrees::Sync(const std::vector<std::unique_ptr<RegTree> >& trees) {
+  CHECK_LE(this->Size(), trees.size())
+      << "trees were removed since they were compiled, Clear() must be called";
+  // id's in RegTree of nodes in the order they are laid out
+  std::vector<int> order;
+  for (size_t i = this->Size(); i < trees.size(); ++i) {
+    const RegTree& tree = *trees[i];
+    const size_t base = nodes_.size();
+    CHECK_LE(base + tree.param.num_nodes, static_cast<size_t>(std::numeric_limits<int>::max()))
+        << "too many nodes to compile";
+    order.clear();
+    for (int nid = 0; nid < tree.param.num_roots; ++nid) {
+      order.push_back(nid);
+    }
+    // breadth-first: the children of order[k] are appended to order, side by side
+    for (size_t k = 0; k < order.size(); ++k) {
+      const RegTree::Node& src = tree[order[k]];
+      Node node;
+      if (src.is_leaf()) {
+        node.cleft = -1;
+        node.sindex = static_cast<uint32_t>(order[k]);
+        node.value = src.leaf_value();
+      } else {
+        node.cleft = static_cast<int32_t>(base + order.size());
+        node.sindex = src.split_index() | (src.default_left() ? (1U << 31) : 0U);
+        node.value = src.split_cond();
+        order.push_back(src.cleft());
+        order.push_back(src.cright());
+      }
+      nodes_.push_back(node);
+    }
+    tree_ptr_.push_back(nodes_.size());
+  }
+}
+
+void CompiledTrees::Clear() {
+  nodes_.clear();
+  tree_ptr_.resize(1);
+}
+
+}  // namespace gbm
+}  // namespace xgboost
@@ -0,0 +1,214 @@
+/*!
+ * Copyright 2017 by Contributors
+ * \file compiled_trees.h
+ * \brief Flat array layout of tree ensembles, for fast prediction
+ */
+#ifndef XGBOOST_GBM_COMPILED_TREES_H_
+#define XGBOOST_GBM_COMPILED_TREES_H_
+
+#include <xgboost/tree_model.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include "../data/dense_source.h"
+
+namespace xgboost {
+namespace gbm {
+
+/*!
+ * \brief trees of an ensemble, flattened into a single contiguous array of packed nodes.
+ *  Trees are laid out one after another, each in breadth-first order starting from its
+ *  roots, so that prediction walks compact memory instead of separately allocated
+ *  RegTree's. Traversal mirrors RegTree::GetLeafIndex, so that results are bit-exact.
+ */
+class CompiledTrees {
+ public:
+  /*! \brief maximum number of rows predicted together by PredictBlock */
+  static const int kBlockOfRows = 64;
+
+  /*!
+   * \brief dense feature values of a block of rows, the counterpart of RegTree::FVec
+   *  for block prediction. Entries are reset after use, as in FVec, so that filling
+   *  a block costs the number of entries, not the number of features.
+   */
+  class FeatureTile {
+   public:
+    FeatureTile() : nrow_(0), num_feature_(0) {}
+    /*! \brief allocate a tile of nrow rows, with all features missing */
+    inline void Init(size_t nrow, size_t num_feature) {
+      Entry e;
+      e.flag = -1;
+      nrow_ = nrow;
+      num_feature_ = num_feature;
+      data_.resize(nrow * num_feature);
+      std::fill(data_.begin(), data_.end(), e);
+    }
+    /*! \brief set rows [begin, end) of batch as rows 0, 1, ... of the tile */
+    inline void Fill(const RowBatch& batch, size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        const RowBatch::Inst inst = batch[i];
+        Entry* row = dmlc::BeginPtr(data_) + (i - begin) * num_feature_;
+        for (bst_uint j = 0; j < inst.length; ++j) {
+          if (inst[j].index >= num_feature_) continue;
+          row[inst[j].index].fvalue = inst[j].fvalue;
+        }
+      }
+    }
+    /*! \brief reset rows filled by Fill(batch, begin, end) to missing */
+    inline void Drop(const RowBatch& batch, size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        const RowBatch::Inst inst = batch[i];
+        Entry* row = dmlc::BeginPtr(data_) + (i - begin) * num_feature_;
+        for (bst_uint j = 0; j < inst.length; ++j) {
+          if (inst[j].index >= num_feature_) continue;
+          row[inst[j].index].flag = -1;
+        }
+      }
+    }
+    /*! \brief set rows [begin, end) of a dense matrix as rows 0, 1, ... of the tile */
+    inline void FillDense(const data::DenseSource& dense, size_t begin, size_t end) {
+      const size_t ncol = std::min(dense.NumCol(), num_feature_);
+      for (size_t i = begin; i < end; ++i) {
+        const bst_float* values = dense.Row(i);
+        Entry* row = dmlc::BeginPtr(data_) + (i - begin) * num_feature_;
+        for (size_t j = 0; j < ncol; ++j) {
+          if (!dense.IsMissing(i, j)) row[j].fvalue = values[j];
+        }
+      }
+    }
+    /*! \brief reset rows [0, nrow) to missing */
+    inline void DropRows(size_t nrow) {
+      for (size_t k = 0; k < nrow * num_feature_; ++k) {
+        data_[k].flag = -1;
+      }
+    }
+    /*! \brief number of rows the tile holds */
+    inline size_t NumRow() const {
+      return nrow_;
+    }
+    /*! \brief number of features of each row */
+    inline size_t NumFeature() const {
+      return num_feature_;
+    }
+    inline bst_float fvalue(size_t k, size_t fid) const {
+      return data_[k * num_feature_ + fid].fvalue;
+    }
+    inline bool is_missing(size_t k, size_t fid) const {
+      return data_[k * num_feature_ + fid].flag == -1;
+    }
+
+   private:
+    /*! \brief same layout as the entries of RegTree::FVec */
+    union Entry {
+      bst_float fvalue;
+      int flag;
+    };
+    std::vector<Entry> data_;
+    size_t nrow_;
+    size_t num_feature_;
+  };
+
+  CompiledTrees() : tree_ptr_(1, 0) {}
+  /*! \brief packed tree node; the two children of a split node are adjacent */
+  struct Node {
+    /*! \brief index of the left child, followed by the right child; -1 for a leaf */
+    int32_t cleft;
+    /*! \brief split feature, with the highest bit set if missing values go left;
+     *  id of the node in its RegTree for a leaf */
+    uint32_t sindex;
+    /*! \brief split condition, or leaf value for a leaf */
+    bst_float value;
+
+    inline bool is_leaf() const {
+      return cleft == -1;
+    }
+    inline unsigned split_index() const {
+      return sindex & ((1U << 31) - 1U);
+    }
+    inline bool default_left() const {
+      return (sindex >> 31) != 0;
+    }
+  };
+
+  /*!
+   * \brief compile trees appended since the last call. The trees already compiled
+   *  must be unchanged; Clear() has to be called when they are replaced or updated.
+   */
+  void Sync(const std::vector<std::unique_ptr<RegTree> >& trees);
+  /*! \brief drop all compiled trees */
+  void Clear();
+  /*! \brief number of compiled trees */
+  inline size_t Size() const {
+    return tree_ptr_.size() - 1;
+  }
+  /*! \brief get the leaf of the i-th tree that feat falls into, starting at root_id */
+  inline const Node& GetLeaf(size_t i, const RegTree::FVec& feat, unsigned root_id) const {
+    const Node* node = &nodes_[tree_ptr_[i] + root_id];
+    while (!node->is_leaf()) {
+      const unsigned split_index = node->split_index();
+      int next;
+      if (feat.is_missing(split_index)) {
+        next = node->default_left() ? node->cleft : node->cleft + 1;
+      } else {
+        next = feat.fvalue(split_index) < node->value ? node->cleft : node->cleft + 1;
+      }
+      node = &nodes_[next];
+    }
+    return *node;
+  }
+  /*!
+   * \brief add up leaf values of trees [tree_begin, tree_end) for the rows of a tile.
+   *  All rows walk a tree together, one level at a time, so that the nodes of the tree
+   *  are reused while in cache and the per-row steps are independent of each other.
+   *  Leaf values are accumulated in tree order, as in a row by row traversal.
+   * \param tile feature values of the rows
+   * \param nrow number of rows, at most tile.NumRow() and kBlockOfRows
+   * \param tree_group output group of each tree
+   * \param group_begin first output group to predict
+   * \param num_group number of output groups to predict; trees of other groups are skipped
+   * \param root_index root to start from, for each row
+   * \param out_psum sum of leaf values for each row and output group, at
+   *  out_psum[k * num_group + gid - group_begin]
+   */
+  inline void PredictBlock(const FeatureTile& tile, size_t nrow,
+                           size_t tree_begin, size_t tree_end,
+                           const std::vector<int>& tree_group,
+                           int group_begin, int num_group,
+                           const unsigned* root_index, bst_float* out_psum) const {
+    const Node* nodes = dmlc::BeginPtr(nodes_);
+    int32_t pos[kBlockOfRows];
+    for (size_t i = tree_begin; i < tree_end; ++i) {
+      const int gid = tree_group[i] - group_begin;
+      if (gid < 0 || gid >= num_group) continue;
+      for (size_t k = 0; k < nrow; ++k) {
+        pos[k] = static_cast<int32_t>(tree_ptr_[i] + root_index[k]);
+      }
+      bool active = true;
+      while (active) {
+        active = false;
+        for (size_t k = 0; k < nrow; ++k) {
+          const Node& node = nodes[pos[k]];
+          if (node.is_leaf()) continue;
+          const unsigned split_index = node.split_index();
+          const bool go_left = tile.is_missing(k, split_index) ? node.default_left()
+              : tile.fvalue(k, split_index) < node.value;
+          pos[k] = go_left ? node.cleft : node.cleft + 1;
+          active = true;
+        }
+      }
+      for (size_t k = 0; k < nrow; ++k) {
+        out_psum[k * num_group + gid] += nodes[pos[k]].value;
+      }
+    }
+  }
+
+ private:
+  /*! \brief nodes of all trees */
+  std::vector<Node> nodes_;
+  /*! \brief tree_ptr_[i] is the index of the first root of the i-th tree */
+  std::vector<size_t> tree_ptr_;
+};
+
+}  // namespace gbm
+}  // namespace xgboost
+#endif  // XGBOOST_GBM_COMPILED_TREES_H_
@@ -21,6 +21,10 @@
 #include "../common/common.h"
 
 #include "../common/random.h"
+#include "./compiled_trees.h"
+#include "./quick_scorer.h"
+#include "./row_predictor.h"
+#include "../data/dense_dmatrix.h"
 
 namespace xgboost {
 namespace gbm {
@@ -33,6 +37,12 @@ enum TreeProcessType {
   kUpdate
 };
 
+// algorithms for batch prediction
+enum TreePredictorType {
+  kTreeWalk,
+  kQuickScorer
+};
+
 /*! \brief training parameters */
 struct GBTreeTrainParam : public dmlc::Parameter<GBTreeTrainParam> {
   /*!
@@ -46,6 +56,8 @@ struct GBTreeTrainParam : public dmlc::Parameter<GBTreeTrainParam> {
   int process_type;
   // flag to print out detailed breakdown of runtime
   int debug_verbose;
+  /*! \brief algorithm used for batch prediction */
+  int predictor;
   // declare parameters
   DMLC_DECLARE_PARAMETER(GBTreeTrainParam) {
     DMLC_DECLARE_FIELD(num_parallel_tree)
@@ -66,6 +78,14 @@ struct GBTreeTrainParam : public dmlc::Parameter<GBTreeTrainParam> {
         .set_lower_bound(0)
         .set_default(0)
         .describe("flag to print out detailed breakdown of runtime");
+    DMLC_DECLARE_FIELD(predictor)
+        .set_default(kTreeWalk)
+        .add_enum("tree_walk", kTreeWalk)
+        .add_enum("quickscorer", kQuickScorer)
+        .describe("Algorithm for batch prediction: walk each tree from root to leaf,"\
+                  " or evaluate the splits of all trees feature by feature (QuickScorer),"\
+                  " which is faster for many shallow trees. Falls back to tree_walk"\
+                  " when a tree has more than 64 leaves.");
     // add alias
     DMLC_DECLARE_ALIAS(updater_seq, updater);
   }
@@ -201,6 +221,8 @@ class GBTree : public GradientBooster {
         trees_to_update.push_back(std::move(trees[i]));
       }
       trees.clear();
+      compiled_.Clear();
+      quick_scorer_.Clear();
       mparam.num_trees = 0;
     }
   }
@@ -210,6 +232,8 @@ class GBTree : public GradientBooster {
         << "GBTree: invalid model file";
     trees.clear();
     trees_to_update.clear();
+    compiled_.Clear();
+    quick_scorer_.Clear();
     for (int i = 0; i < mparam.num_trees; ++i) {
       std::unique_ptr<RegTree> ptr(new RegTree());
       ptr->Load(fi);
@@ -290,6 +314,10 @@ class GBTree : public GradientBooster {
         }
       }
     }
+    compiled_.Sync(trees);
+    if (tparam.predictor == kQuickScorer) {
+      quick_scorer_.Sync(trees);
+    }
     PredLoopInternal<GBTree>(p_fmat, out_preds, 0, ntree_limit, true);
   }
 
@@ -301,6 +329,7 @@ class GBTree : public GradientBooster {
       thread_temp.resize(1, RegTree::FVec());
       thread_temp[0].Init(mparam.num_feature);
     }
+    compiled_.Sync(trees);
     ntree_limit *= mparam.num_output_group;
     if (ntree_limit == 0 || ntree_limit > trees.size()) {
       ntree_limit = static_cast<unsigned>(trees.size());
@@ -319,6 +348,7 @@ class GBTree : public GradientBooster {
                    unsigned ntree_limit) override {
     const int nthread = omp_get_max_threads();
     InitThreadTemp(nthread);
+    compiled_.Sync(trees);
     this->PredPath(p_fmat, out_preds, ntree_limit);
   }
 
@@ -331,6 +361,12 @@ class GBTree : public GradientBooster {
     }
     return dump;
   }
+  // take a snapshot of the trees for single row prediction
+  virtual void InitRowPredictor(RowPredictor* predictor, ObjFunction* obj) const {
+    predictor->Init(trees, tree_info, std::vector<bst_float>(trees.size(), 1.0f),
+                    mparam.num_output_group, static_cast<unsigned>(mparam.num_feature),
+                    base_margin_, obj);
+  }
 
  protected:
   // internal prediction loop
@@ -385,46 +421,125 @@ class GBTree : public GradientBooster {
         << "size_leaf_vector is enforced to 0 so far";
     CHECK_EQ(preds.size(), p_fmat->info().num_row * num_group);
     // start collecting the prediction
-    dmlc::DataIter<RowBatch>* iter = p_fmat->RowIterator();
     Derived* self = static_cast<Derived*>(this);
+    const data::DenseDMatrix* dense = dynamic_cast<const data::DenseDMatrix*>(p_fmat);
+    if (dense != nullptr &&
+        self->PredDense(dense->Dense(), info, num_group, tree_begin, tree_end, &preds)) {
+      return;
+    }
+    dmlc::DataIter<RowBatch>* iter = p_fmat->RowIterator();
     iter->BeforeFirst();
     while (iter->Next()) {
-      const RowBatch &batch = iter->Value();
-      // parallel over local batch
-      const int K = 8;
-      const bst_omp_uint nsize = static_cast<bst_omp_uint>(batch.size);
-      const bst_omp_uint rest = nsize % K;
-      #pragma omp parallel for schedule(static)
-      for (bst_omp_uint i = 0; i < nsize - rest; i += K) {
-        const int tid = omp_get_thread_num();
-        RegTree::FVec& feats = thread_temp[tid];
-        int64_t ridx[K];
-        RowBatch::Inst inst[K];
-        for (int k = 0; k < K; ++k) {
-          ridx[k] = static_cast<int64_t>(batch.base_rowid + i + k);
-        }
-        for (int k = 0; k < K; ++k) {
-          inst[k] = batch[i + k];
-        }
-        for (int k = 0; k < K; ++k) {
-          for (int gid = 0; gid < num_group; ++gid) {
-            const size_t offset = ridx[k] * num_group + gid;
-            preds[offset] +=
-                self->PredValue(inst[k], gid, info.GetRoot(ridx[k]),
-                                &feats, tree_begin, tree_end);
-          }
+      self->PredBatch(iter->Value(), info, num_group, tree_begin, tree_end, &preds);
+    }
+  }
+  // add predictions of trees [tree_begin, tree_end) for a batch of rows to out_preds.
+  // Rows are taken kBlockOfRows at a time: their feature values are spread into a tile,
+  // then each tree is walked by all rows of the block together.
+  inline void PredBatch(const RowBatch& batch,
+                        const MetaInfo& info,
+                        int num_group,
+                        unsigned tree_begin,
+                        unsigned tree_end,
+                        std::vector<bst_float>* out_preds) {
+    if (tparam.predictor == kQuickScorer && quick_scorer_.Enabled() &&
+        quick_scorer_.Size() == trees.size() && info.root_index.size() == 0) {
+      this->PredBatchQuickScorer(batch, num_group, tree_begin, tree_end, out_preds);
+      return;
+    }
+    const size_t block_size = this->InitTileTemp(omp_get_max_threads());
+    const bst_omp_uint nsize = static_cast<bst_omp_uint>(batch.size);
+    const bst_omp_uint nblock = static_cast<bst_omp_uint>((nsize + block_size - 1) / block_size);
+    #pragma omp parallel for schedule(static)
+    for (bst_omp_uint block = 0; block < nblock; ++block) {
+      CompiledTrees::FeatureTile& tile = tile_temp[omp_get_thread_num()];
+      const size_t begin = block * block_size;
+      const size_t end = std::min(begin + block_size, static_cast<size_t>(nsize));
+      tile.Fill(batch, begin, end);
+      this->PredTile(tile, end - begin, batch.base_rowid + begin, info,
+                     num_group, tree_begin, tree_end, out_preds);
+      tile.Drop(batch, begin, end);
+    }
+  }
+  // add predictions of trees [tree_begin, tree_end) for all rows of a dense matrix
+  // to out_preds, reading its values in place; return false if this is not supported
+  inline bool PredDense(const data::DenseSource& dense,
+                        const MetaInfo& info,
+                        int num_group,
+                        unsigned tree_begin,
+                        unsigned tree_end,
+                        std::vector<bst_float>* out_preds) {
+    if (tparam.predictor == kQuickScorer) return false;
+    const size_t block_size = this->InitTileTemp(omp_get_max_threads());
+    const bst_omp_uint nsize = static_cast<bst_omp_uint>(dense.NumRow());
+    const bst_omp_uint nblock = static_cast<bst_omp_uint>((nsize + block_size - 1) / block_size);
+    #pragma omp parallel for schedule(static)
+    for (bst_omp_uint block = 0; block < nblock; ++block) {
+      CompiledTrees::FeatureTile& tile = tile_temp[omp_get_thread_num()];
+      const size_t begin = block * block_size;
+      const size_t end = std::min(begin + block_size, static_cast<size_t>(nsize));
+      tile.FillDense(dense, begin, end);
+      this->PredTile(tile, end - begin, begin, info,
+                     num_group, tree_begin, tree_end, out_preds);
+      tile.DropRows(end - begin);
+    }
+    return true;
+  }
+  // add predictions of trees [tree_begin, tree_end) for the nrow rows of a tile, which
+  // are rows [ridx_begin, ridx_begin + nrow) of the matrix, to out_preds
+  inline void PredTile(const CompiledTrees::FeatureTile& tile,
+                       size_t nrow,
+                       size_t ridx_begin,
+                       const MetaInfo& info,
+                       int num_group,
+                       unsigned tree_begin,
+                       unsigned tree_end,
+                       std::vector<bst_float>* out_preds) {
+    std::vector<bst_float>& preds = *out_preds;
+    // output groups are taken kMaxGroup at a time, to keep psum on stack
+    const int kMaxGroup = 16;
+    unsigned root_index[CompiledTrees::kBlockOfRows];
+    bst_float psum[CompiledTrees::kBlockOfRows * kMaxGroup];
+    for (size_t k = 0; k < nrow; ++k) {
+      root_index[k] = info.GetRoot(ridx_begin + k);
+    }
+    for (int gbegin = 0; gbegin < num_group; gbegin += kMaxGroup) {
+      const int ngroup = std::min(num_group - gbegin, kMaxGroup);
+      std::fill(psum, psum + nrow * ngroup, 0.0f);
+      compiled_.PredictBlock(tile, nrow, tree_begin, tree_end,
+                             tree_info, gbegin, ngroup, root_index, psum);
+      for (size_t k = 0; k < nrow; ++k) {
+        const size_t ridx = ridx_begin + k;
+        for (int gid = 0; gid < ngroup; ++gid) {
+          preds[ridx * num_group + gbegin + gid] += psum[k * ngroup + gid];
         }
       }
-      for (bst_omp_uint i = nsize - rest; i < nsize; ++i) {
-        RegTree::FVec& feats = thread_temp[0];
-        const int64_t ridx = static_cast<int64_t>(batch.base_rowid + i);
-        const RowBatch::Inst inst = batch[i];
-        for (int gid = 0; gid < num_group; ++gid) {
-          const size_t offset = ridx * num_group + gid;
-          preds[offset] +=
-              self->PredValue(inst, gid, info.GetRoot(ridx),
-                              &feats, tree_begin, tree_end);
-        }
+    }
+  }
+  // add predictions of trees [tree_begin, tree_end) for a batch of rows to out_preds,
+  // evaluating the splits of all trees feature by feature
+  inline void PredBatchQuickScorer(const RowBatch& batch,
+                                   int num_group,
+                                   unsigned tree_begin,
+                                   unsigned tree_end,
+                                   std::vector<bst_float>* out_preds) {
+    std::vector<bst_float>& preds = *out_preds;
+    const int nthread = omp_get_max_threads();
+    leafidx_temp.resize(nthread * quick_scorer_.Size());
+    psum_temp.resize(nthread * num_group);
+    const bst_omp_uint nsize = static_cast<bst_omp_uint>(batch.size);
+    #pragma omp parallel for schedule(static)
+    for (bst_omp_uint i = 0; i < nsize; ++i) {
+      const int tid = omp_get_thread_num();
+      RegTree::FVec& feats = thread_temp[tid];
+      bst_float* psum = dmlc::BeginPtr(psum_temp) + tid * num_group;
+      const size_t ridx = batch.base_rowid + i;
+      feats.Fill(batch[i]);
+      quick_scorer_.Predict(feats, tree_begin, tree_end, tree_info, num_group,
+                            dmlc::BeginPtr(leafidx_temp) + tid * quick_scorer_.Size(), psum);
+      feats.Drop(batch[i]);
+      for (int gid = 0; gid < num_group; ++gid) {
+        preds[ridx * num_group + gid] += psum[gid];
       }
     }
   }
@@ -480,6 +595,9 @@ class GBTree : public GradientBooster {
       tree_info.push_back(bst_group);
     }
     mparam.num_trees += static_cast<int>(new_trees.size());
+    // the new trees are appended to the compiled ones, the scorer is rebuilt when used
+    compiled_.Sync(trees);
+    quick_scorer_.Clear();
 
     // update cache entry
     for (auto &kv : cache_) {
@@ -513,8 +631,7 @@ class GBTree : public GradientBooster {
     p_feats->Fill(inst);
     for (size_t i = tree_begin; i < tree_end; ++i) {
       if (tree_info[i] == bst_group) {
-        int tid = trees[i]->GetLeafIndex(*p_feats, root_index);
-        psum += (*trees[i])[tid].leaf_value();
+        psum += compiled_.GetLeaf(i, *p_feats, root_index).value;
       }
     }
     p_feats->Drop(inst);
@@ -546,13 +663,32 @@ class GBTree : public GradientBooster {
         RegTree::FVec &feats = thread_temp[tid];
         feats.Fill(batch[i]);
         for (unsigned j = 0; j < ntree_limit; ++j) {
-          int tid = trees[j]->GetLeafIndex(feats, info.GetRoot(ridx));
+          const unsigned tid = compiled_.GetLeaf(j, feats, info.GetRoot(ridx)).sindex;
           preds[ridx * ntree_limit + j] = static_cast<bst_float>(tid);
         }
         feats.Drop(batch[i]);
       }
     }
   }
+  // init thread tiles, return number of rows each tile holds
+  inline size_t InitTileTemp(int nthread) {
+    // keep tiles within a budget of entries, which costs wide data smaller blocks
+    const size_t kMaxTileEntry = 1 << 16;
+    const size_t num_feature = static_cast<size_t>(mparam.num_feature);
+    const size_t nrow = std::max(
+        std::min(kMaxTileEntry / std::max(num_feature, static_cast<size_t>(1)),
+                 static_cast<size_t>(CompiledTrees::kBlockOfRows)),
+        static_cast<size_t>(1));
+    if (tile_temp.size() < static_cast<size_t>(nthread)) {
+      tile_temp.resize(nthread);
+    }
+    for (auto& tile : tile_temp) {
+      if (tile.NumRow() != nrow || tile.NumFeature() != num_feature) {
+        tile.Init(nrow, num_feature);
+      }
+    }
+    return nrow;
+  }
   // init thread buffers
   inline void InitThreadTemp(int nthread) {
     int prev_thread_temp_size = thread_temp.size();
@@ -576,12 +712,21 @@ class GBTree : public GradientBooster {
   std::vector<std::unique_ptr<RegTree> > trees_to_update;
   /*! \brief some information indicator of the tree, reserved */
   std::vector<int> tree_info;
+  /*! \brief trees laid out for prediction; synced lazily before predicting */
+  CompiledTrees compiled_;
+  /*! \brief trees laid out for QuickScorer, used with predictor=quickscorer */
+  QuickScorer quick_scorer_;
   // ----training fields----
   std::unordered_map<DMatrix*, CacheEntry> cache_;
   // configurations for tree
   std::vector<std::pair<std::string, std::string> > cfg;
   // temporal storage for per thread
   std::vector<RegTree::FVec> thread_temp;
+  // per thread feature tiles, for block prediction
+  std::vector<CompiledTrees::FeatureTile> tile_temp;
+  // per thread leaf bitvectors and sums, for QuickScorer
+  std::vector<uint64_t> leafidx_temp;
+  std::vector<bst_float> psum_temp;
   // the updaters that can be applied to each of tree
   std::vector<std::unique_ptr<TreeUpdater> > updaters;
 };
@@ -642,6 +787,12 @@ class Dart : public GBTree {
                       &thread_temp[0], 0, ntree_limit) + base_margin_;
     }
   }
+  // the snapshot uses all trees, as in single instance prediction
+  void InitRowPredictor(RowPredictor* predictor, ObjFunction* obj) const override {
+    predictor->Init(trees, tree_info, weight_drop,
+                    mparam.num_output_group, static_cast<unsigned>(mparam.num_feature),
+                    base_margin_, obj);
+  }
 
  protected:
   friend class GBTree;
@@ -653,12 +804,67 @@ class Dart : public GBTree {
       tree_info.push_back(bst_group);
     }
     mparam.num_trees += static_cast<int>(new_trees.size());
+    quick_scorer_.Clear();
     size_t num_drop = NormalizeTrees(new_trees.size());
     if (dparam.silent != 1) {
       LOG(INFO) << "drop " << num_drop << " trees, "
                 << "weight = " << weight_drop.back();
     }
   }
+  // dropout weights are applied row by row, so dense data goes through row batches
+  inline bool PredDense(const data::DenseSource& dense,
+                        const MetaInfo& info,
+                        int num_group,
+                        unsigned tree_begin,
+                        unsigned tree_end,
+                        std::vector<bst_float>* out_preds) {
+    return false;
+  }
+  // add predictions of trees [tree_begin, tree_end) for a batch of rows to out_preds
+  inline void PredBatch(const RowBatch& batch,
+                        const MetaInfo& info,
+                        int num_group,
+                        unsigned tree_begin,
+                        unsigned tree_end,
+                        std::vector<bst_float>* out_preds) {
+    std::vector<bst_float>& preds = *out_preds;
+    // parallel over local batch
+    const int K = 8;
+    const bst_omp_uint nsize = static_cast<bst_omp_uint>(batch.size);
+    const bst_omp_uint rest = nsize % K;
+    #pragma omp parallel for schedule(static)
+    for (bst_omp_uint i = 0; i < nsize - rest; i += K) {
+      const int tid = omp_get_thread_num();
+      RegTree::FVec& feats = thread_temp[tid];
+      int64_t ridx[K];
+      RowBatch::Inst inst[K];
+      for (int k = 0; k < K; ++k) {
+        ridx[k] = static_cast<int64_t>(batch.base_rowid + i + k);
+      }
+      for (int k = 0; k < K; ++k) {
+        inst[k] = batch[i + k];
+      }
+      for (int k = 0; k < K; ++k) {
+        for (int gid = 0; gid < num_group; ++gid) {
+          const size_t offset = ridx[k] * num_group + gid;
+          preds[offset] +=
+              this->PredValue(inst[k], gid, info.GetRoot(ridx[k]),
+                              &feats, tree_begin, tree_end);
+        }
+      }
+    }
+    for (bst_omp_uint i = nsize - rest; i < nsize; ++i) {
+      RegTree::FVec& feats = thread_temp[0];
+      const int64_t ridx = static_cast<int64_t>(batch.base_rowid + i);
+      const RowBatch::Inst inst = batch[i];
+      for (int gid = 0; gid < num_group; ++gid) {
+        const size_t offset = ridx * num_group + gid;
+        preds[offset] +=
+            this->PredValue(inst, gid, info.GetRoot(ridx),
+                            &feats, tree_begin, tree_end);
+      }
+    }
+  }
   // predict the leaf scores without dropped trees
   inline bst_float PredValue(const RowBatch::Inst &inst,
                              int bst_group,
@@ -768,6 +974,15 @@ class Dart : public GBTree {
   std::vector<size_t> idx_drop;
 };
 
+RowPredictor* CreateRowPredictor(const GradientBooster* gbm, ObjFunction* obj) {
+  std::unique_ptr<ObjFunction> obj_holder(obj);
+  const GBTree* tree = dynamic_cast<const GBTree*>(gbm);
+  CHECK(tree != nullptr) << "Row predictor is only supported by tree boosters";
+  std::unique_ptr<RowPredictor> predictor(new RowPredictor());
+  tree->InitRowPredictor(predictor.get(), obj_holder.release());
+  return predictor.release();
+}
+
 // register the objective functions
 DMLC_REGISTER_PARAMETER(GBTreeModelParam);
 DMLC_REGISTER_PARAMETER(GBTreeTrainParam);
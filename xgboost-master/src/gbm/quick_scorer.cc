@@ -0,0 +1,116 @@
+/*!
+ * Copyright 2017 by Contributors
+ * \file quick_scorer.cc
+ * \brief Feature-wise evaluation of tree ensembles with leaf bitvectors (QuickScorer)
+ */
+#include <xgboost/logging.h>
+#include <algorithm>
+#include <limits>
+#include "./quick_scorer.h"
+
+namespace xgboost {
+namespace gbm {
+
+const int QuickScorer::kMaxLeaf;
+
+namespace {
+/*! \brief a split node of a tree, before splits are grouped by feature */
+struct Split {
+  unsigned fid;
+  bst_float threshold;
+  bool default_left;
+  uint32_t tree_id;
+  uint64_t mask;
+};
+
+// number the leaves under nid from left to right, starting at *nleaf, and collect the
+// splits; return false if the tree has more than QuickScorer::kMaxLeaf leaves
+bool AddSubtree(const RegTree& tree, int nid, uint32_t tree_id, int* nleaf,
+                std::vector<bst_float>* leaf_value, std::vector<Split>* splits) {
+  const RegTree::Node& node = tree[nid];
+  if (node.is_leaf()) {
+    if (*nleaf == QuickScorer::kMaxLeaf) return false;
+    leaf_value->push_back(node.leaf_value());
+    ++(*nleaf);
+    return true;
+  }
+  const int begin = *nleaf;
+  if (!AddSubtree(tree, node.cleft(), tree_id, nleaf, leaf_value, splits)) return false;
+  const int end = *nleaf;
+  // going right rules out leaves [begin, end) of the left subtree; as the right
+  // subtree has at least one leaf, end - begin < kMaxLeaf
+  Split split;
+  split.fid = node.split_index();
+  split.threshold = node.split_cond();
+  split.default_left = node.default_left();
+  split.tree_id = tree_id;
+  split.mask = ~(((static_cast<uint64_t>(1) << (end - begin)) - 1) << begin);
+  splits->push_back(split);
+  return AddSubtree(tree, node.cright(), tree_id, nleaf, leaf_value, splits);
+}
+}  // namespace
+
+void QuickScorer::Sync(const std::vector<std::unique_ptr<RegTree> >& trees) {
+  if (synced_) {
+    CHECK_EQ(num_tree_, trees.size())
+        << "trees were changed since the scorer was built, Clear() must be called";
+    return;
+  }
+  this->Clear();
+  synced_ = true;
+  CHECK_LE(trees.size(), static_cast<size_t>(std::numeric_limits<uint32_t>::max()));
+  std::vector<Split> splits;
+  for (size_t i = 0; i < trees.size(); ++i) {
+    int nleaf = 0;
+    leaf_ptr_.push_back(leaf_value_.size());
+    if (trees[i]->param.num_roots != 1 ||
+        !AddSubtree(*trees[i], 0, static_cast<uint32_t>(i), &nleaf, &leaf_value_, &splits)) {
+      this->Clear();
+      num_tree_ = trees.size();
+      synced_ = true;
+      return;
+    }
+  }
+  // group by feature, ascending thresholds within a feature
+  std::stable_sort(splits.begin(), splits.end(), [](const Split& a, const Split& b) {
+      return a.fid < b.fid || (a.fid == b.fid && a.threshold < b.threshold);
+    });
+  feat_ptr_.push_back(0);
+  missing_ptr_.push_back(0);
+  for (size_t j = 0; j < splits.size(); ++j) {
+    const Split& split = splits[j];
+    threshold_.push_back(split.threshold);
+    tree_id_.push_back(split.tree_id);
+    mask_.push_back(split.mask);
+    if (!split.default_left) {
+      missing_tree_id_.push_back(split.tree_id);
+      missing_mask_.push_back(split.mask);
+    }
+    if (j + 1 == splits.size() || splits[j + 1].fid != split.fid) {
+      feat_index_.push_back(split.fid);
+      feat_ptr_.push_back(threshold_.size());
+      missing_ptr_.push_back(missing_mask_.size());
+    }
+  }
+  num_tree_ = trees.size();
+  enabled_ = true;
+}
+
+void QuickScorer::Clear() {
+  num_tree_ = 0;
+  enabled_ = false;
+  synced_ = false;
+  feat_index_.clear();
+  feat_ptr_.clear();
+  threshold_.clear();
+  tree_id_.clear();
+  mask_.clear();
+  missing_ptr_.clear();
+  missing_tree_id_.clear();
+  missing_mask_.clear();
+  leaf_value_.clear();
+  leaf_ptr_.clear();
+}
+
+}  // namespace gbm
+}  // namespace xgboost
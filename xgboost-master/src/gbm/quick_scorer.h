@@ -0,0 +1,133 @@
+/*!
+ * Copyright 2017 by Contributors
+ * \file quick_scorer.h
+ * \brief Feature-wise evaluation of tree ensembles with leaf bitvectors (QuickScorer)
+ */
+#ifndef XGBOOST_GBM_QUICK_SCORER_H_
+#define XGBOOST_GBM_QUICK_SCORER_H_
+
+#include <dmlc/base.h>
+#include <xgboost/tree_model.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace xgboost {
+namespace gbm {
+
+/*!
+ * \brief evaluation of an ensemble of trees with at most 64 leaves each, after
+ *  Lucchese et al., "QuickScorer: a fast algorithm to rank documents with additive
+ *  ensembles of regression trees". The leaves of each tree are numbered from left to
+ *  right and tracked by the bits of a 64-bit word. A split that sends a row right rules
+ *  out the leaves of its left subtree, so its mask clears their bits; the leaf a row
+ *  falls into is the lowest bit left after the masks of all such splits are applied.
+ *
+ *  Splits of all trees are grouped by feature and sorted by threshold, so that for a
+ *  feature value x the splits sending x right, those with !(x < threshold), are a prefix
+ *  of the list of the feature. A missing value is sent right by the splits of the
+ *  feature that don't default left, which are kept in a second list.
+ */
+class QuickScorer {
+ public:
+  /*! \brief maximum number of leaves of a tree */
+  static const int kMaxLeaf = 64;
+
+  QuickScorer() : num_tree_(0), enabled_(false), synced_(false) {}
+  /*!
+   * \brief build from trees, unless already built since the last Clear(), which has
+   *  to be called whenever trees are added, replaced or updated.
+   *  The scorer is disabled if any tree has more than kMaxLeaf leaves or more than
+   *  one root.
+   */
+  void Sync(const std::vector<std::unique_ptr<RegTree> >& trees);
+  /*! \brief drop all trees */
+  void Clear();
+  /*! \brief number of trees */
+  inline size_t Size() const {
+    return num_tree_;
+  }
+  /*! \brief whether the trees can be evaluated by the scorer */
+  inline bool Enabled() const {
+    return enabled_;
+  }
+  /*!
+   * \brief add up leaf values of trees [tree_begin, tree_end) for a row, per output group.
+   *  Leaf values are accumulated in tree order, as in a root to leaf traversal.
+   * \param feat feature values of the row
+   * \param tree_group output group of each tree
+   * \param num_group number of output groups
+   * \param leafidx working memory of Size() words
+   * \param out_psum sum of leaf values for each output group
+   */
+  inline void Predict(const RegTree::FVec& feat,
+                      size_t tree_begin, size_t tree_end,
+                      const std::vector<int>& tree_group, int num_group,
+                      uint64_t* leafidx, bst_float* out_psum) const {
+    std::fill(leafidx, leafidx + num_tree_, ~static_cast<uint64_t>(0));
+    const bst_float* threshold = dmlc::BeginPtr(threshold_);
+    const uint32_t* tree_id = dmlc::BeginPtr(tree_id_);
+    const uint64_t* mask = dmlc::BeginPtr(mask_);
+    for (size_t k = 0; k < feat_index_.size(); ++k) {
+      const unsigned fid = feat_index_[k];
+      if (feat.is_missing(fid)) {
+        for (size_t j = missing_ptr_[k]; j < missing_ptr_[k + 1]; ++j) {
+          leafidx[missing_tree_id_[j]] &= missing_mask_[j];
+        }
+      } else {
+        const bst_float x = feat.fvalue(fid);
+        for (size_t j = feat_ptr_[k]; j < feat_ptr_[k + 1] && !(x < threshold[j]); ++j) {
+          leafidx[tree_id[j]] &= mask[j];
+        }
+      }
+    }
+    std::fill(out_psum, out_psum + num_group, 0.0f);
+    for (size_t i = tree_begin; i < tree_end; ++i) {
+      out_psum[tree_group[i]] += leaf_value_[leaf_ptr_[i] + LowestBit(leafidx[i])];
+    }
+  }
+
+ private:
+  inline static int LowestBit(uint64_t x) {
+#if defined(_MSC_VER)
+    unsigned long idx;  // NOLINT(*)
+    _BitScanForward64(&idx, x);
+    return static_cast<int>(idx);
+#else
+    return __builtin_ctzll(x);
+#endif
+  }
+  /*! \brief number of trees */
+  size_t num_tree_;
+  /*! \brief whether all trees fit the scorer */
+  bool enabled_;
+  /*! \brief whether the scorer was built since the last Clear() */
+  bool synced_;
+  /*! \brief features used in splits */
+  std::vector<unsigned> feat_index_;
+  /*! \brief splits on feat_index_[k] are [feat_ptr_[k], feat_ptr_[k + 1]) */
+  std::vector<size_t> feat_ptr_;
+  /*! \brief split thresholds, ascending for each feature */
+  std::vector<bst_float> threshold_;
+  /*! \brief tree of each split */
+  std::vector<uint32_t> tree_id_;
+  /*! \brief bits to keep when a split sends a row right */
+  std::vector<uint64_t> mask_;
+  /*! \brief splits on feat_index_[k] sending missing values right are
+   *  [missing_ptr_[k], missing_ptr_[k + 1]) */
+  std::vector<size_t> missing_ptr_;
+  std::vector<uint32_t> missing_tree_id_;
+  std::vector<uint64_t> missing_mask_;
+  /*! \brief leaf values of each tree, from left to right */
+  std::vector<bst_float> leaf_value_;
+  /*! \brief leaves of tree i start at leaf_ptr_[i] */
+  std::vector<size_t> leaf_ptr_;
+};
+
+}  // namespace gbm
+}  // namespace xgboost
+#endif  // XGBOOST_GBM_QUICK_SCORER_H_
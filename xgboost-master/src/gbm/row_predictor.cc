@@ -0,0 +1,83 @@
+/*!
+ * Copyright 2017 by Contributors
+ * \file row_predictor.cc
+ * \brief Reentrant prediction of single rows, for online serving
+ */
+#include <xgboost/logging.h>
+#include <algorithm>
+#include <vector>
+#include "./row_predictor.h"
+#include "../common/math.h"
+
+namespace xgboost {
+namespace gbm {
+
+RowPredictor::Scratch::Scratch(const RowPredictor& predictor) {
+  entries_.reserve(predictor.NumFeature());
+  feats_.Init(predictor.NumFeature());
+  preds_.reserve(predictor.NumOutput());
+}
+
+void RowPredictor::Init(const std::vector<std::unique_ptr<RegTree> >& trees,
+                        const std::vector<int>& tree_group,
+                        const std::vector<bst_float>& tree_weight,
+                        int num_group, unsigned num_feature, bst_float base_margin,
+                        ObjFunction* obj) {
+  CHECK_EQ(trees.size(), tree_group.size());
+  CHECK_EQ(trees.size(), tree_weight.size());
+  compiled_.Clear();
+  compiled_.Sync(trees);
+  tree_group_ = tree_group;
+  tree_weight_ = tree_weight;
+  num_group_ = num_group;
+  num_feature_ = num_feature;
+  base_margin_ = base_margin;
+  obj_.reset(obj);
+}
+
+size_t RowPredictor::Predict(const bst_float* row, size_t ncol, bst_float missing,
+                             bool output_margin, unsigned ntree_limit,
+                             Scratch* scratch, bst_float* out_result) const {
+  // same rule for missing values as XGDMatrixCreateFromMat
+  const bool nan_missing = common::CheckNAN(missing);
+  const size_t nfeat = std::min(ncol, static_cast<size_t>(num_feature_));
+  std::vector<SparseBatch::Entry>& entries = scratch->entries_;
+  entries.clear();
+  for (size_t j = 0; j < nfeat; ++j) {
+    if (common::CheckNAN(row[j])) continue;
+    if (nan_missing || row[j] != missing) {
+      entries.push_back(SparseBatch::Entry(static_cast<bst_uint>(j), row[j]));
+    }
+  }
+  const SparseBatch::Inst inst(dmlc::BeginPtr(entries), static_cast<bst_uint>(entries.size()));
+
+  size_t tree_end = static_cast<size_t>(ntree_limit) * num_group_;
+  if (tree_end == 0 || tree_end > compiled_.Size()) {
+    tree_end = compiled_.Size();
+  }
+  RegTree::FVec& feats = scratch->feats_;
+  feats.Fill(inst);
+  for (int gid = 0; gid < num_group_; ++gid) {
+    bst_float psum = 0.0f;
+    for (size_t i = 0; i < tree_end; ++i) {
+      if (tree_group_[i] == gid) {
+        psum += tree_weight_[i] * compiled_.GetLeaf(i, feats, 0).value;
+      }
+    }
+    out_result[gid] = base_margin_ + psum;
+  }
+  feats.Drop(inst);
+  if (output_margin || obj_.get() == nullptr) {
+    return NumOutput();
+  }
+
+  std::vector<bst_float>& preds = scratch->preds_;
+  preds.assign(out_result, out_result + num_group_);
+  // the objectives transform the values of a single row without a thread team
+  obj_->PredTransform(&preds);
+  std::copy(preds.begin(), preds.end(), out_result);
+  return preds.size();
+}
+
+}  // namespace gbm
+}  // namespace xgboost
@@ -0,0 +1,127 @@
+/*!
+ * Copyright 2017 by Contributors
+ * \file row_predictor.h
+ * \brief Reentrant prediction of single rows, for online serving
+ */
+#ifndef XGBOOST_GBM_ROW_PREDICTOR_H_
+#define XGBOOST_GBM_ROW_PREDICTOR_H_
+
+#include <xgboost/base.h>
+#include <xgboost/data.h>
+#include <xgboost/gbm.h>
+#include <xgboost/learner.h>
+#include <xgboost/objective.h>
+#include <xgboost/tree_model.h>
+#include <memory>
+#include <vector>
+#include "./compiled_trees.h"
+
+namespace xgboost {
+namespace gbm {
+
+/*!
+ * \brief immutable snapshot of a tree ensemble, for predicting one dense row at a time.
+ *  Unlike GradientBooster::Predict, which keeps its working memory in the booster,
+ *  Predict is const and takes the working memory from the caller, so that any number
+ *  of threads can predict with the same object, each with a Scratch of its own.
+ *  Once a Scratch is created, predicting a margin does no heap allocation.
+ * \code
+ * std::unique_ptr<RowPredictor> predictor(CreateRowPredictor(learner));
+ * // in each serving thread
+ * RowPredictor::Scratch scratch(*predictor);
+ * std::vector<bst_float> out(predictor->NumOutput());
+ * size_t len = predictor->Predict(row, ncol, missing, false, 0, &scratch, &out[0]);
+ * \endcode
+ */
+class RowPredictor {
+ public:
+  /*! \brief working memory of one caller; must not be shared between threads */
+  class Scratch {
+   public:
+    explicit Scratch(const RowPredictor& predictor);
+
+   private:
+    friend class RowPredictor;
+    /*! \brief non-missing entries of the row */
+    std::vector<SparseBatch::Entry> entries_;
+    /*! \brief dense feature vector */
+    RegTree::FVec feats_;
+    /*! \brief predictions passed to the objective for transformation */
+    std::vector<bst_float> preds_;
+  };
+
+  /*!
+   * \brief take a snapshot of the trees of a booster
+   * \param trees the trees
+   * \param tree_group output group of each tree
+   * \param tree_weight weight of each tree in the sum of leaf values
+   * \param num_group number of output groups
+   * \param num_feature number of features
+   * \param base_margin global bias added to each prediction
+   * \param obj objective used to transform predictions, owned by the predictor;
+   *  can be nullptr, in which case margins are always returned
+   */
+  void Init(const std::vector<std::unique_ptr<RegTree> >& trees,
+            const std::vector<int>& tree_group,
+            const std::vector<bst_float>& tree_weight,
+            int num_group, unsigned num_feature, bst_float base_margin,
+            ObjFunction* obj);
+  /*!
+   * \brief predict a single row, with the same result as batch prediction of the row.
+   *  Safe to call concurrently from multiple threads with different scratches.
+   *  Transformation by an objective that outputs more than one value per row,
+   *  such as multi:softprob, can allocate memory inside the objective.
+   * \param row feature values of the row
+   * \param ncol number of values in row; features beyond NumFeature() are ignored
+   * \param missing value that marks a missing feature; NaN is always missing
+   * \param output_margin whether to output the raw margin instead of the
+   *  transformed prediction
+   * \param ntree_limit limit on the number of boosting rounds used, 0 for all
+   * \param scratch working memory of the calling thread
+   * \param out_result buffer of at least NumOutput() values receiving the prediction
+   * \return number of values written to out_result
+   */
+  size_t Predict(const bst_float* row, size_t ncol, bst_float missing,
+                 bool output_margin, unsigned ntree_limit,
+                 Scratch* scratch, bst_float* out_result) const;
+  /*! \brief maximum number of values predicted for a row */
+  inline size_t NumOutput() const {
+    return static_cast<size_t>(num_group_);
+  }
+  /*! \brief number of features used by the model */
+  inline size_t NumFeature() const {
+    return num_feature_;
+  }
+
+ private:
+  /*! \brief the trees */
+  CompiledTrees compiled_;
+  /*! \brief output group of each tree */
+  std::vector<int> tree_group_;
+  /*! \brief weight of each tree */
+  std::vector<bst_float> tree_weight_;
+  /*! \brief number of output groups */
+  int num_group_;
+  /*! \brief number of features */
+  unsigned num_feature_;
+  /*! \brief global bias */
+  bst_float base_margin_;
+  /*! \brief objective function, for transforming predictions */
+  std::unique_ptr<ObjFunction> obj_;
+};
+
+/*!
+ * \brief create a row predictor from a snapshot of a tree booster
+ * \param gbm the booster, gbtree or dart
+ * \param obj objective used to transform predictions, owned by the predictor
+ */
+RowPredictor* CreateRowPredictor(const GradientBooster* gbm, ObjFunction* obj);
+}  // namespace gbm
+
+/*!
+ * \brief create a row predictor from a snapshot of the model of a learner;
+ *  the learner can be trained or freed afterwards without affecting the predictor
+ */
+gbm::RowPredictor* CreateRowPredictor(const Learner* learner);
+}  // namespace xgboost
+#endif  // XGBOOST_GBM_ROW_PREDICTOR_H_
@@ -18,6 +18,7 @@
 #include "./common/io.h"
 #include "./common/common.h"
 #include "./common/random.h"
+#include "./gbm/row_predictor.h"
 
 namespace xgboost {
 // implementation of base learner.
@@ -379,6 +380,15 @@ class LearnerImpl : public Learner {
     return std::make_pair(metric, ev->Eval(preds_, data->info(), tparam.dsplit == 2));
   }
 
+  gbm::RowPredictor* CreateRowPredictor() const {
+    CHECK(this->ModelInitialized())
+        << "Model must be initialized or loaded before creating a row predictor";
+    // the predictor owns a copy of the objective, which it can use concurrently
+    std::unique_ptr<ObjFunction> obj(ObjFunction::Create(name_obj_));
+    obj->Configure(cfg_.begin(), cfg_.end());
+    return gbm::CreateRowPredictor(gbm_.get(), obj.release());
+  }
+
   void Predict(DMatrix* data,
                bool output_margin,
                std::vector<bst_float> *out_preds,
@@ -429,7 +439,9 @@ class LearnerImpl : public Learner {
                              max_row_perbatch);
     }
 
-    if (!p_train->SingleColBlock() && cfg_.count("updater") == 0) {
+    // tree_method=hist handles multi-block (external memory) data through its own
+    // paged quantized index, so keep grow_fast_histmaker for it
+    if (tparam.tree_method != 3 && !p_train->SingleColBlock() && cfg_.count("updater") == 0) {
       if (tparam.tree_method == 2) {
         LOG(CONSOLE) << "tree method is set to be 'exact',"
                      << " but currently we are only able to proceed with approximate algorithm";
@@ -513,4 +525,8 @@ class LearnerImpl : public Learner {
 Learner* Learner::Create(const std::vector<std::shared_ptr<DMatrix> >& cache_data) {
   return new LearnerImpl(cache_data);
 }
+
+gbm::RowPredictor* CreateRowPredictor(const Learner* learner) {
+  return static_cast<const LearnerImpl*>(learner)->CreateRowPredictor();
+}
 }  // namespace xgboost
@@ -95,7 +95,8 @@ class SoftmaxMultiClassObj : public ObjFunction {
     const omp_ulong ndata = static_cast<omp_ulong>(preds.size() / nclass);
     if (!prob) tmp.resize(ndata);
 
-    #pragma omp parallel
+    // a single row, as from RowPredictor, is not worth a thread team
+    #pragma omp parallel if (ndata > 1)
     {
       std::vector<bst_float> rec(nclass);
       #pragma omp for schedule(static)
@@ -12,6 +12,7 @@
 #include <cmath>
 #include <cstring>
 #include <limits>
+#include <string>
 #include <vector>
 
 #ifdef __NVCC__
@@ -40,6 +41,11 @@ struct TrainParam : public dmlc::Parameter<TrainParam> {
   // growing policy
   enum TreeGrowPolicy { kDepthWise = 0, kLossGuide = 1 };
   int grow_policy;
+  // precision of gradient statistics accumulated in histograms
+  enum HistPrecision { kHistDouble = 0, kHistFloat = 1 };
+  int hist_precision;
+  // file caching cuts and quantized data between runs on the same data
+  std::string hist_cache_file;
   // flag to print out detailed breakdown of runtime
   int debug_verbose;
   //----- the rest parameters are less important ----
@@ -73,6 +79,12 @@ struct TrainParam : public dmlc::Parameter<TrainParam> {
   int parallel_option;
   // option to open cacheline optimization
   bool cache_opt;
+  // whether exact greedy keeps the sorted columns in memory, grouped by node
+  bool col_partition;
+  // whether the global approximate method builds histograms from binarized columns
+  bool col_bin_cache;
+  // fraction of non-empty bins from which distributed histmaker sends a node histogram in full
+  float sparse_hist_ratio;
   // whether to not print info during training.
   bool silent;
   // whether refresh updater needs to update the leaf values
@@ -112,6 +124,20 @@ struct TrainParam : public dmlc::Parameter<TrainParam> {
             "Tree growing policy. 0: favor splitting at nodes closest to the node, "
             "i.e. grow depth-wise. 1: favor splitting at nodes with highest loss "
             "change. (cf. LightGBM)");
+    DMLC_DECLARE_FIELD(hist_precision)
+        .set_default(kHistDouble)
+        .add_enum("double", kHistDouble)
+        .add_enum("float", kHistFloat)
+        .describe("If using histogram-based algorithm, floating-point type used for "
+                  "accumulating gradient statistics in histograms. float halves the "
+                  "memory taken up by histograms, at the cost of precision.");
+    DMLC_DECLARE_FIELD(hist_cache_file)
+        .set_default("")
+        .describe("If using histogram-based algorithm, local file for caching the "
+                  "cuts and quantized data. It is loaded, rather than recomputed, when "
+                  "training again on the same data with the same max_bin; otherwise "
+                  "it is (re)written. Ignored for external memory and distributed "
+                  "training.");
     DMLC_DECLARE_FIELD(colmat_dtype)
         .set_default(static_cast<int>(DataType::uint32))
         .add_enum("uint8", static_cast<int>(DataType::uint8))
@@ -177,6 +203,25 @@ struct TrainParam : public dmlc::Parameter<TrainParam> {
     DMLC_DECLARE_FIELD(cache_opt)
         .set_default(true)
         .describe("EXP Param: Cache aware optimization.");
+    DMLC_DECLARE_FIELD(col_partition)
+        .set_default(false)
+        .describe("EXP Param: Keep the sorted columns in memory and partition them "
+                  "by tree node as splits are made, in grow_colmaker.");
+    DMLC_DECLARE_FIELD(col_bin_cache)
+        .set_default(true)
+        .describe("EXP Param: Binarize the columns once per tree against the proposed "
+                  "cuts and build the histograms of every level from the bin ids, "
+                  "in grow_histmaker. Only used when the columns are a single page, so "
+                  "that external memory data is not loaded into memory.");
+    DMLC_DECLARE_FIELD(sparse_hist_ratio)
+        .set_range(0.0f, 1.0f)
+        .set_default(0.0f)
+        .describe("EXP Param: In distributed approximate methods, the histograms of a node "
+                  "are synchronized in full when this fraction of their bins is non-empty "
+                  "on some worker, and only at the non-empty bins otherwise. "
+                  "0 always synchronizes the full histograms. A positive value takes two "
+                  "allreduce rounds per level instead of one, and the local histograms "
+                  "are always built, even when rabit recovers the result after a failure.");
     DMLC_DECLARE_FIELD(silent)
         .set_default(false)
         .describe("Do not print information during trainig.");
@@ -0,0 +1,110 @@
+/*!
+ * Copyright 2017 by Contributors
+ * \file sparse_hist_reducer.h
+ * \brief Allreduce of the node histograms of the approximate method that sends only the
+ *  bins that are non-empty on some worker.
+ */
+#ifndef XGBOOST_TREE_SPARSE_HIST_REDUCER_H_
+#define XGBOOST_TREE_SPARSE_HIST_REDUCER_H_
+
+#include <xgboost/base.h>
+#include <rabit/rabit.h>
+#include <algorithm>
+#include <vector>
+#include "../common/bitmap.h"
+
+namespace xgboost {
+namespace tree {
+/*!
+ * \brief Sum the histograms of the nodes over all workers in two rounds.
+ *
+ *  The first round takes the bitwise OR of a flag per node and a bitmap of the non-empty
+ *  bins. A node is flagged when at least dense_ratio of its bins are non-empty on some
+ *  worker; the histograms of flagged nodes are sent in full, those of the other nodes
+ *  only at the bins set in the bitmap. The second round sums the selected bins, which
+ *  are the same on every worker. The result is the same as a full Allreduce, since the
+ *  bins left out are empty on all the workers.
+ *
+ *  TStats is a statistics with sum_grad and sum_hess, like GradStats.
+ */
+template<typename TStats>
+class SparseHistReducer {
+ public:
+  /*!
+   * \brief sum the histograms of all workers in place
+   * \param data histograms of all the nodes, one after another
+   * \param node_ptr start of each node in data, the number of nodes + 1 values
+   * \param dense_ratio fraction of non-empty bins from which a node is sent in full
+   */
+  inline void Allreduce(TStats* data,
+                        const std::vector<size_t>& node_ptr,
+                        float dense_ratio) {
+    const size_t nnode = node_ptr.size() - 1;
+    const size_t nbin = node_ptr.back();
+    // the bins start on a word, so that each word is written by a single thread
+    const size_t bin_begin = (nnode + 31) / 32 * 32;
+    bitmap_.data.clear();
+    bitmap_.Resize(bin_begin + nbin);
+    const bst_omp_uint nword = static_cast<bst_omp_uint>((nbin + 31) / 32);
+    uint32_t* bin_words = dmlc::BeginPtr(bitmap_.data) + bin_begin / 32;
+    #pragma omp parallel for schedule(static)
+    for (bst_omp_uint w = 0; w < nword; ++w) {
+      const size_t end = std::min(nbin, static_cast<size_t>(w) * 32 + 32);
+      uint32_t res = 0;
+      for (size_t i = static_cast<size_t>(w) * 32; i < end; ++i) {
+        res |= static_cast<uint32_t>(!Empty(data[i])) << (i & 31U);
+      }
+      bin_words[w] = res;
+    }
+    for (size_t nid = 0; nid < nnode; ++nid) {
+      size_t count = 0;
+      for (size_t i = node_ptr[nid]; i < node_ptr[nid + 1]; ++i) {
+        count += bitmap_.Get(bin_begin + i);
+      }
+      if (count != 0 && count >= dense_ratio * (node_ptr[nid + 1] - node_ptr[nid])) {
+        bitmap_.SetTrue(nid);
+      }
+    }
+    rabit::Allreduce<rabit::op::BitOR>(dmlc::BeginPtr(bitmap_.data), bitmap_.data.size());
+    // gather the selected bins
+    index_.clear();
+    for (size_t nid = 0; nid < nnode; ++nid) {
+      const bool dense = bitmap_.Get(nid);
+      for (size_t i = node_ptr[nid]; i < node_ptr[nid + 1]; ++i) {
+        if (dense || bitmap_.Get(bin_begin + i)) index_.push_back(i);
+      }
+    }
+    const bst_omp_uint nsend = static_cast<bst_omp_uint>(index_.size());
+    buffer_.resize(index_.size());
+    #pragma omp parallel for schedule(static)
+    for (bst_omp_uint i = 0; i < nsend; ++i) {
+      buffer_[i] = data[index_[i]];
+    }
+    reducer_.Allreduce(dmlc::BeginPtr(buffer_), buffer_.size());
+    #pragma omp parallel for schedule(static)
+    for (bst_omp_uint i = 0; i < nsend; ++i) {
+      data[index_[i]] = buffer_[i];
+    }
+  }
+  /*! \return number of bins sent by the last call */
+  inline size_t NumSent() const {
+    return index_.size();
+  }
+
+ private:
+  // whether no row was added to the statistics, the sums are exactly zero
+  inline static bool Empty(const TStats& s) {
+    return s.sum_grad == 0.0 && s.sum_hess == 0.0;
+  }
+  /*! \brief flags of the nodes sent in full, then the non-empty bins */
+  common::BitMap bitmap_;
+  /*! \brief bins sent */
+  std::vector<size_t> index_;
+  /*! \brief statistics of the bins sent */
+  std::vector<TStats> buffer_;
+  /*! \brief reducer of the statistics */
+  rabit::Reducer<TStats, TStats::Reduce> reducer_;
+};
+}  // namespace tree
+}  // namespace xgboost
+#endif  // XGBOOST_TREE_SPARSE_HIST_REDUCER_H_
@@ -0,0 +1,151 @@
+/*!
+ * Copyright 2017 by Contributors
+ * \file split_kernel.h
+ * \brief Split enumeration over the histogram bins of a feature, for GradStats without
+ *  constraint, written so that the evaluation of the gains can be vectorized.
+ */
+#ifndef XGBOOST_TREE_SPLIT_KERNEL_H_
+#define XGBOOST_TREE_SPLIT_KERNEL_H_
+
+#include <xgboost/base.h>
+#include <algorithm>
+#include <limits>
+#include <vector>
+#include "./param.h"
+#include "../common/hist_util.h"
+
+namespace xgboost {
+namespace tree {
+/*!
+ * \brief Find the best split of a feature from its histogram, in both directions.
+ *
+ *  The prefix sums of the forward scan and the suffix sums of the backward scan are taken
+ *  first, in the same order as the scalar enumeration, then the gains of all the thresholds
+ *  are computed and masked by min_child_weight without branches, and reduced to the best
+ *  one. The result is the same as enumerating with GradStats and NoConstraint.
+ *  Each thread should use its own kernel, the buffers are kept between calls.
+ */
+class HistSplitKernel {
+ public:
+  /*! \return whether the kernel computes the gain of param, it does not clip the weights */
+  inline static bool Supported(const TrainParam& param) {
+    return param.max_delta_step == 0.0f;
+  }
+  /*!
+   * \brief update p_best with the best split of feature fid
+   * \param param training parameter
+   * \param hist histogram bins of the feature
+   * \param nbin number of bins
+   * \param cut upper bound of each bin
+   * \param min_val smallest value of the feature
+   * \param total statistics of the node
+   * \param root_gain gain of the node without split
+   * \param fid feature index
+   * \param p_best best split so far, the backward split is proposed first
+   */
+  template<typename GradientSumT>
+  inline void Enumerate(const TrainParam& param,
+                        const common::GHistEntry<GradientSumT>* hist,
+                        size_t nbin,
+                        const bst_float* cut,
+                        bst_float min_val,
+                        const GradStats& total,
+                        bst_float root_gain,
+                        bst_uint fid,
+                        SplitEntry* p_best) {
+    fwd_grad_.resize(nbin); fwd_hess_.resize(nbin);
+    bwd_grad_.resize(nbin); bwd_hess_.resize(nbin);
+    fwd_loss_.resize(nbin); bwd_loss_.resize(nbin);
+    double* fwd_grad = dmlc::BeginPtr(fwd_grad_);
+    double* fwd_hess = dmlc::BeginPtr(fwd_hess_);
+    double* bwd_grad = dmlc::BeginPtr(bwd_grad_);
+    double* bwd_hess = dmlc::BeginPtr(bwd_hess_);
+    bst_float* fwd_loss = dmlc::BeginPtr(fwd_loss_);
+    bst_float* bwd_loss = dmlc::BeginPtr(bwd_loss_);
+    // statistics of the bins up to i, and from i to the end
+    {
+      double sum_grad = 0.0, sum_hess = 0.0;
+      for (size_t i = 0; i < nbin; ++i) {
+        sum_grad += static_cast<double>(hist[i].sum_grad);
+        sum_hess += static_cast<double>(hist[i].sum_hess);
+        fwd_grad[i] = sum_grad;
+        fwd_hess[i] = sum_hess;
+      }
+      sum_grad = sum_hess = 0.0;
+      for (size_t i = nbin; i != 0; --i) {
+        sum_grad += static_cast<double>(hist[i - 1].sum_grad);
+        sum_hess += static_cast<double>(hist[i - 1].sum_hess);
+        bwd_grad[i - 1] = sum_grad;
+        bwd_hess[i - 1] = sum_hess;
+      }
+    }
+    // loss change of all the thresholds
+    const double reg_alpha = param.reg_alpha;
+    const double reg_lambda = param.reg_lambda;
+    const double total_grad = total.sum_grad, total_hess = total.sum_hess;
+    const double root = root_gain;
+    for (size_t i = 0; i < nbin; ++i) {
+      // forward: the bins up to i go left, missing values go right
+      fwd_loss[i] = static_cast<bst_float>(
+          Gain(fwd_grad[i], fwd_hess[i], reg_alpha, reg_lambda) +
+          Gain(total_grad - fwd_grad[i], total_hess - fwd_hess[i], reg_alpha, reg_lambda) -
+          root);
+      // backward: the bins from i go right, missing values go left
+      bwd_loss[i] = static_cast<bst_float>(
+          Gain(total_grad - bwd_grad[i], total_hess - bwd_hess[i], reg_alpha, reg_lambda) +
+          Gain(bwd_grad[i], bwd_hess[i], reg_alpha, reg_lambda) -
+          root);
+    }
+    // the thresholds leaving too little hessian on a side can never be chosen,
+    // masked in a separate loop so that the gains above are computed without branches
+    const double min_child_weight = param.min_child_weight;
+    const bst_float kInvalid = -std::numeric_limits<bst_float>::max();
+    for (size_t i = 0; i < nbin; ++i) {
+      const bool fwd_valid = (fwd_hess[i] >= min_child_weight) &
+          (total_hess - fwd_hess[i] >= min_child_weight);
+      const bool bwd_valid = (bwd_hess[i] >= min_child_weight) &
+          (total_hess - bwd_hess[i] >= min_child_weight);
+      fwd_loss[i] = fwd_valid ? fwd_loss[i] : kInvalid;
+      bwd_loss[i] = bwd_valid ? bwd_loss[i] : kInvalid;
+    }
+    // a split must reduce the loss, NaN never compares greater
+    bst_float fwd_max = 0.0f, bwd_max = 0.0f;
+    for (size_t i = 0; i < nbin; ++i) {
+      fwd_max = fwd_loss[i] > fwd_max ? fwd_loss[i] : fwd_max;
+      bwd_max = bwd_loss[i] > bwd_max ? bwd_loss[i] : bwd_max;
+    }
+    // ties go to the first threshold of the scan, which runs from the last bin backward
+    SplitEntry best;
+    if (bwd_max > 0.0f) {
+      size_t i = nbin - 1;
+      while (bwd_loss[i] != bwd_max) --i;
+      best.Update(bwd_max, fid, i == 0 ? min_val : cut[i - 1], true);
+    }
+    p_best->Update(best);
+    best = SplitEntry();
+    if (fwd_max > 0.0f) {
+      size_t i = 0;
+      while (fwd_loss[i] != fwd_max) ++i;
+      best.Update(fwd_max, fid, cut[i], false);
+    }
+    p_best->Update(best);
+  }
+
+ private:
+  // same as CalcGain when the sum of hessian is at least min_child_weight,
+  // ThresholdL1 is written as a clamp so that there is no branch
+  inline static double Gain(double sum_grad, double sum_hess,
+                            double reg_alpha, double reg_lambda) {
+    const double g = sum_grad - std::min(std::max(sum_grad, -reg_alpha), reg_alpha);
+    return g * g / (sum_hess + reg_lambda);
+  }
+  /*! \brief statistics of the bins up to each bin */
+  std::vector<double> fwd_grad_, fwd_hess_;
+  /*! \brief statistics of the bins from each bin */
+  std::vector<double> bwd_grad_, bwd_hess_;
+  /*! \brief loss change of the split after each bin, and before each bin */
+  std::vector<bst_float> fwd_loss_, bwd_loss_;
+};
+}  // namespace tree
+}  // namespace xgboost
+#endif  // XGBOOST_TREE_SPLIT_KERNEL_H_
@@ -81,17 +81,29 @@ class ColMaker: public TreeUpdater {
   struct Builder {
    public:
     // constructor
-    explicit Builder(const TrainParam& param) : param(param), nthread(omp_get_max_threads()) {}
+    explicit Builder(const TrainParam& param)
+        : param(param), nthread(omp_get_max_threads()), cache_columns_(false) {}
     // update one tree, growing
     virtual void Update(const std::vector<bst_gpair>& gpair,
                         DMatrix* p_fmat,
                         RegTree* p_tree) {
+      cache_columns_ = param.col_partition && this->ColumnCacheSupported();
       this->InitData(gpair, *p_fmat, *p_tree);
+      if (cache_columns_) {
+        this->InitColumnCache(p_fmat, *p_tree);
+      }
       this->InitNewNode(qexpand_, gpair, *p_fmat, *p_tree);
       for (int depth = 0; depth < param.max_depth; ++depth) {
         this->FindSplit(depth, qexpand_, gpair, p_fmat, p_tree);
-        this->ResetPosition(qexpand_, p_fmat, *p_tree);
+        if (cache_columns_) {
+          this->ResetPositionCached(qexpand_, *p_tree);
+        } else {
+          this->ResetPosition(qexpand_, p_fmat, *p_tree);
+        }
         this->UpdateQueueExpand(*p_tree, &qexpand_);
+        if (cache_columns_ && depth + 1 < param.max_depth) {
+          this->GroupByNode(qexpand_, *p_tree);
+        }
         this->InitNewNode(qexpand_, gpair, *p_fmat, *p_tree);
         // if nothing left to be expand, break
         if (qexpand_.size() == 0) break;
@@ -200,11 +212,13 @@ class ColMaker: public TreeUpdater {
       }
       const RowSet &rowset = fmat.buffered_rowset();
       const MetaInfo& info = fmat.info();
-      // setup position
-      const bst_omp_uint ndata = static_cast<bst_omp_uint>(rowset.size());
+      // setup position, with the column cache only the rows of the expanding nodes are visited
+      const bool active_only = cache_columns_;
+      const bst_omp_uint ndata = static_cast<bst_omp_uint>(
+          active_only ? rows_.size() : rowset.size());
       #pragma omp parallel for schedule(static)
       for (bst_omp_uint i = 0; i < ndata; ++i) {
-        const bst_uint ridx = rowset[i];
+        const bst_uint ridx = active_only ? rows_[i] : rowset[i];
         const int tid = omp_get_thread_num();
         if (position[ridx] < 0) continue;
         stemp[tid][position[ridx]].stats.Add(gpair, info, ridx);
@@ -255,13 +269,14 @@ class ColMaker: public TreeUpdater {
     }
     // parallel find the best split of current fid
     // this function does not support nested functions
+    // ind tells whether the column takes a single value
     inline void ParallelFindSplit(const ColBatch::Inst &col,
                                   bst_uint fid,
+                                  bool ind,
                                   const DMatrix &fmat,
                                   const std::vector<bst_gpair> &gpair) {
       // TODO(tqchen): double check stats order.
       const MetaInfo& info = fmat.info();
-      const bool ind = col.length != 0 && col.data[0].fvalue == col.data[col.length - 1].fvalue;
       bool need_forward = param.need_forward_search(fmat.GetColDensity(fid), ind);
       bool need_backward = param.need_backward_search(fmat.GetColDensity(fid), ind);
       const std::vector<int> &qexpand = qexpand_;
@@ -581,6 +596,61 @@ class ColMaker: public TreeUpdater {
       }
     }
 
+    /*!
+     * \brief same as EnumerateSplit, for a single node over the entries of its own rows,
+     *  such as a segment of a cached column; no position lookup is needed.
+     */
+    inline void EnumerateSplitNode(const ColBatch::Entry *begin,
+                                   const ColBatch::Entry *end,
+                                   int d_step,
+                                   bst_uint fid,
+                                   int nid,
+                                   const std::vector<bst_gpair> &gpair,
+                                   const MetaInfo &info,
+                                   ThreadEntry &e) { // NOLINT(*)
+      e.stats.Clear();
+      // left statistics
+      TStats c(param);
+      for (const ColBatch::Entry *it = begin; it != end; it += d_step) {
+        const bst_uint ridx = it->index;
+        const bst_float fvalue = it->fvalue;
+        if (!e.stats.Empty() && fvalue != e.last_fvalue &&
+            e.stats.sum_hess >= param.min_child_weight) {
+          c.SetSubstract(snode[nid].stats, e.stats);
+          if (c.sum_hess >= param.min_child_weight) {
+            bst_float loss_chg;
+            if (d_step == -1) {
+              loss_chg = static_cast<bst_float>(
+                  constraints_[nid].CalcSplitGain(param, fid, c, e.stats) -
+                  snode[nid].root_gain);
+            } else {
+              loss_chg = static_cast<bst_float>(
+                  constraints_[nid].CalcSplitGain(param, fid, e.stats, c) -
+                  snode[nid].root_gain);
+            }
+            e.best.Update(loss_chg, fid, (fvalue + e.last_fvalue) * 0.5f, d_step == -1);
+          }
+        }
+        e.stats.Add(gpair, info, ridx);
+        e.last_fvalue = fvalue;
+      }
+      // check if it is possible to include all sum statistics
+      c.SetSubstract(snode[nid].stats, e.stats);
+      if (e.stats.sum_hess >= param.min_child_weight && c.sum_hess >= param.min_child_weight) {
+        bst_float loss_chg;
+        if (d_step == -1) {
+          loss_chg = static_cast<bst_float>(
+              constraints_[nid].CalcSplitGain(param, fid, c, e.stats) - snode[nid].root_gain);
+        } else {
+          loss_chg = static_cast<bst_float>(
+              constraints_[nid].CalcSplitGain(param, fid, e.stats, c) - snode[nid].root_gain);
+        }
+        const bst_float gap = std::abs(e.last_fvalue) + rt_eps;
+        const bst_float delta = d_step == +1 ? gap: -gap;
+        e.best.Update(loss_chg, fid, e.last_fvalue + delta, d_step == -1);
+      }
+    }
+
     // update the solution candidate
     virtual void UpdateSolution(const ColBatch& batch,
                                 const std::vector<bst_gpair>& gpair,
@@ -613,8 +683,57 @@ class ColMaker: public TreeUpdater {
         }
       } else {
         for (bst_omp_uint i = 0; i < nsize; ++i) {
-          this->ParallelFindSplit(batch[i], batch.col_index[i],
-                                  fmat, gpair);
+          const ColBatch::Inst c = batch[i];
+          const bool ind = c.length != 0 && c.data[0].fvalue == c.data[c.length - 1].fvalue;
+          this->ParallelFindSplit(c, batch.col_index[i], ind, fmat, gpair);
+        }
+      }
+    }
+    // update the solution candidate from the cached columns of feat_set
+    inline void UpdateSolutionCached(const std::vector<bst_uint>& feat_set,
+                                     const std::vector<bst_gpair>& gpair,
+                                     const DMatrix& fmat) {
+      const MetaInfo& info = fmat.info();
+      const bst_omp_uint nsize = static_cast<bst_omp_uint>(feat_set.size());
+      #if defined(_OPENMP)
+      const int batch_size = std::max(static_cast<int>(nsize / this->nthread / 32), 1);
+      #endif
+      int poption = param.parallel_option;
+      if (poption == 2) {
+        poption = static_cast<int>(nsize) * 2 < this->nthread ? 1 : 0;
+      }
+      if (poption == 0) {
+        #pragma omp parallel for schedule(dynamic, batch_size)
+        for (bst_omp_uint i = 0; i < nsize; ++i) {
+          const bst_uint fid = feat_set[i];
+          const int tid = omp_get_thread_num();
+          const int k = cache_slot_[fid];
+          if (cache_col_[k].size() == 0) continue;
+          const ColBatch::Entry* data = dmlc::BeginPtr(cache_col_[k]);
+          const std::vector<size_t>& ptr = cache_ptr_[k];
+          const bool ind = cache_ind_[k] != 0;
+          const bool forward = param.need_forward_search(fmat.GetColDensity(fid), ind);
+          const bool backward = param.need_backward_search(fmat.GetColDensity(fid), ind);
+          // the entries of each node are a segment, in the order of qexpand
+          for (size_t j = 0; j < qexpand_.size(); ++j) {
+            const int nid = qexpand_[j];
+            if (forward) {
+              this->EnumerateSplitNode(data + ptr[j], data + ptr[j + 1], +1,
+                                       fid, nid, gpair, info, stemp[tid][nid]);
+            }
+            if (backward) {
+              this->EnumerateSplitNode(data + ptr[j + 1] - 1, data + ptr[j] - 1, -1,
+                                       fid, nid, gpair, info, stemp[tid][nid]);
+            }
+          }
+        }
+      } else {
+        for (bst_omp_uint i = 0; i < nsize; ++i) {
+          const bst_uint fid = feat_set[i];
+          const std::vector<ColBatch::Entry>& col = cache_col_[cache_slot_[fid]];
+          this->ParallelFindSplit(ColBatch::Inst(dmlc::BeginPtr(col),
+                                                 static_cast<bst_uint>(col.size())),
+                                  fid, cache_ind_[cache_slot_[fid]] != 0, fmat, gpair);
         }
       }
     }
@@ -632,9 +751,13 @@ class ColMaker: public TreeUpdater {
             << "colsample_bylevel is too small that no feature can be included";
         feat_set.resize(n);
       }
-      dmlc::DataIter<ColBatch>* iter = p_fmat->ColIterator(feat_set);
-      while (iter->Next()) {
-        this->UpdateSolution(iter->Value(), gpair, *p_fmat);
+      if (cache_columns_) {
+        this->UpdateSolutionCached(feat_set, gpair, *p_fmat);
+      } else {
+        dmlc::DataIter<ColBatch>* iter = p_fmat->ColIterator(feat_set);
+        while (iter->Next()) {
+          this->UpdateSolution(iter->Value(), gpair, *p_fmat);
+        }
       }
       // after this each thread's stemp will get the best candidates, aggregate results
       this->SyncBestSolution(qexpand);
@@ -688,7 +811,143 @@ class ColMaker: public TreeUpdater {
         }
       }
     }
+    // keep the sorted columns of feat_index in memory, with the entries of active rows only
+    inline void InitColumnCache(DMatrix* p_fmat, const RegTree& tree) {
+      cache_slot_.assign(p_fmat->info().num_col, -1);
+      for (size_t k = 0; k < feat_index.size(); ++k) {
+        cache_slot_[feat_index[k]] = static_cast<int>(k);
+      }
+      cache_col_.assign(feat_index.size(), std::vector<ColBatch::Entry>());
+      cache_ptr_.assign(feat_index.size(), std::vector<size_t>());
+      cache_ind_.assign(feat_index.size(), 1);
+      // the first value of each column, to tell whether it takes a single value
+      std::vector<bst_float> first_fvalue(feat_index.size());
+      dmlc::DataIter<ColBatch>* iter = p_fmat->ColIterator(feat_index);
+      while (iter->Next()) {
+        const ColBatch& batch = iter->Value();
+        const bst_omp_uint nsize = static_cast<bst_omp_uint>(batch.size);
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (bst_omp_uint i = 0; i < nsize; ++i) {
+          const int k = cache_slot_[batch.col_index[i]];
+          const ColBatch::Inst col = batch[i];
+          if (col.length == 0) continue;
+          std::vector<ColBatch::Entry>& out = cache_col_[k];
+          if (out.size() == 0 && cache_ind_[k] != 0) {
+            first_fvalue[k] = col[0].fvalue;
+          }
+          if (col[0].fvalue != first_fvalue[k] || col[col.length - 1].fvalue != first_fvalue[k]) {
+            cache_ind_[k] = 0;
+          }
+          for (bst_uint j = 0; j < col.length; ++j) {
+            if (position[col[j].index] >= 0) out.push_back(col[j]);
+          }
+        }
+      }
+      const bst_omp_uint nslot = static_cast<bst_omp_uint>(cache_col_.size());
+      if (!p_fmat->SingleColBlock()) {
+        // each page is sorted on its own, merge them
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (bst_omp_uint k = 0; k < nslot; ++k) {
+          std::stable_sort(cache_col_[k].begin(), cache_col_[k].end(),
+                           ColBatch::Entry::CmpValue);
+        }
+      }
+      const RowSet& rowset = p_fmat->buffered_rowset();
+      rows_.clear();
+      for (size_t i = 0; i < rowset.size(); ++i) {
+        if (position[rowset[i]] >= 0) rows_.push_back(rowset[i]);
+      }
+      this->GroupByNode(qexpand_, tree);
+    }
+    /*!
+     * \brief group the cached columns and the active rows by node, in the order of qexpand,
+     *  keeping the order of the entries within each node.
+     */
+    inline void GroupByNode(const std::vector<int>& qexpand, const RegTree& tree) {
+      std::vector<int> qindex(tree.param.num_nodes, -1);
+      for (size_t j = 0; j < qexpand.size(); ++j) {
+        qindex[qexpand[j]] = static_cast<int>(j);
+      }
+      const bst_omp_uint nslot = static_cast<bst_omp_uint>(cache_col_.size());
+      #pragma omp parallel for schedule(dynamic, 1)
+      for (bst_omp_uint k = 0; k <= nslot; ++k) {
+        if (k == nslot) {
+          this->GroupByNode(qindex, qexpand.size(), &rows_, &row_ptr_);
+        } else {
+          this->GroupByNode(qindex, qexpand.size(), &cache_col_[k], &cache_ptr_[k]);
+        }
+      }
+    }
+    // counting sort of the entries by node, entries of the other rows are dropped
+    template<typename T>
+    inline void GroupByNode(const std::vector<int>& qindex, size_t nnode,
+                            std::vector<T>* p_data, std::vector<size_t>* p_ptr) const {
+      std::vector<T>& data = *p_data;
+      std::vector<size_t>& ptr = *p_ptr;
+      ptr.assign(nnode + 1, 0);
+      for (const T& e : data) {
+        const int nid = position[RowIndex(e)];
+        if (nid >= 0 && qindex[nid] >= 0) ++ptr[qindex[nid] + 1];
+      }
+      for (size_t j = 0; j < nnode; ++j) {
+        ptr[j + 1] += ptr[j];
+      }
+      std::vector<T> out(ptr.back());
+      std::vector<size_t> top(ptr.begin(), ptr.end() - 1);
+      for (const T& e : data) {
+        const int nid = position[RowIndex(e)];
+        if (nid >= 0 && qindex[nid] >= 0) out[top[qindex[nid]]++] = e;
+      }
+      data.swap(out);
+    }
+    inline static bst_uint RowIndex(bst_uint ridx) {
+      return ridx;
+    }
+    inline static bst_uint RowIndex(const ColBatch::Entry& e) {
+      return e.index;
+    }
+    /*!
+     * \brief same as ResetPosition, but only visits the rows of the expanding nodes,
+     *  finding the rows that have a value of the split feature in its cached column.
+     */
+    inline void ResetPositionCached(const std::vector<int> &qexpand, const RegTree& tree) {
+      for (size_t j = 0; j < qexpand.size(); ++j) {
+        const int nid = qexpand[j];
+        if (tree[nid].is_leaf()) continue;
+        const int k = cache_slot_[tree[nid].split_index()];
+        CHECK_GE(k, 0) << "split on a feature that is not cached";
+        const ColBatch::Entry* col = dmlc::BeginPtr(cache_col_[k]);
+        const bst_omp_uint begin = static_cast<bst_omp_uint>(cache_ptr_[k][j]);
+        const bst_omp_uint end = static_cast<bst_omp_uint>(cache_ptr_[k][j + 1]);
+        const bst_float split_cond = tree[nid].split_cond();
+        const int cleft = tree[nid].cleft(), cright = tree[nid].cright();
+        #pragma omp parallel for schedule(static)
+        for (bst_omp_uint i = begin; i < end; ++i) {
+          position[col[i].index] = col[i].fvalue < split_cond ? cleft : cright;
+        }
+      }
+      // the rows without a value go to the default branch, finished leaves are marked
+      const bst_omp_uint ndata = static_cast<bst_omp_uint>(rows_.size());
+      #pragma omp parallel for schedule(static)
+      for (bst_omp_uint i = 0; i < ndata; ++i) {
+        const bst_uint ridx = rows_[i];
+        const int nid = position[ridx];
+        if (nid < 0) continue;
+        if (tree[nid].is_leaf()) {
+          // mark finish when it is not a fresh leaf
+          if (tree[nid].cright() == -1) {
+            position[ridx] = ~nid;
+          }
+        } else {
+          position[ridx] = tree[nid].default_left() ? tree[nid].cleft() : tree[nid].cright();
+        }
+      }
+    }
     // customization part
+    // whether positions can be updated from the local cached columns
+    virtual bool ColumnCacheSupported() const {
+      return true;
+    }
     // synchronize the best solution of each node
     virtual void SyncBestSolution(const std::vector<int> &qexpand) {
       for (size_t i = 0; i < qexpand.size(); ++i) {
@@ -766,6 +1025,20 @@ class ColMaker: public TreeUpdater {
     std::vector<int> qexpand_;
     // constraint value
     std::vector<TConstraint> constraints_;
+    // whether the sorted columns are kept in memory, grouped by node
+    bool cache_columns_;
+    // Per feature: index in cache_col_ of the feature, -1 if it is not cached
+    std::vector<int> cache_slot_;
+    // Per cached feature: entries of active rows, grouped by node in the order of qexpand_
+    std::vector<std::vector<ColBatch::Entry> > cache_col_;
+    // Per cached feature: begin of the entries of each node of qexpand_, and the end
+    std::vector<std::vector<size_t> > cache_ptr_;
+    // Per cached feature: whether the column takes a single value
+    std::vector<int> cache_ind_;
+    // rows of the nodes of qexpand_, grouped by node
+    std::vector<bst_uint> rows_;
+    // begin of the rows of each node of qexpand_, and the end
+    std::vector<size_t> row_ptr_;
   };
 };
 
@@ -818,6 +1091,10 @@ class DistColMaker : public ColMaker<TStats, TConstraint> {
     }
 
    protected:
+    // the columns are split over the workers, positions are set with an allreduce
+    bool ColumnCacheSupported() const override {
+      return false;
+    }
     void SetNonDefaultPosition(const std::vector<int> &qexpand,
                                DMatrix *p_fmat,
                                const RegTree &tree) override {
@@ -12,20 +12,28 @@
 #include <queue>
 #include <iomanip>
 #include <numeric>
+#include <type_traits>
 #include "./param.h"
+#include "./split_kernel.h"
 #include "../common/random.h"
 #include "../common/bitmap.h"
 #include "../common/sync.h"
 #include "../common/hist_util.h"
+#include "../common/hist_cache.h"
+#include "../common/hist_page.h"
 #include "../common/row_set.h"
 #include "../common/column_matrix.h"
+#if DMLC_ENABLE_STD_THREAD
+#include "../data/sparse_page_dmatrix.h"
+#endif
 
 namespace xgboost {
 namespace tree {
 
 using xgboost::common::HistCutMatrix;
 using xgboost::common::GHistIndexMatrix;
-using xgboost::common::GHistIndexRow;
+using xgboost::common::GHistIndexPages;
+using xgboost::common::HistCache;
 using xgboost::common::GHistEntry;
 using xgboost::common::HistCollection;
 using xgboost::common::RowSetCollection;
@@ -56,10 +64,19 @@ class FastHistMaker: public TreeUpdater {
     TStats::CheckInfo(dmat->info());
     if (is_gmat_initialized_ == false) {
       double tstart = dmlc::GetTime();
-      hmat_.Init(dmat, param.max_bin);
-      gmat_.cut = &hmat_;
-      gmat_.Init(dmat);
-      column_matrix_.Init(gmat_, static_cast<xgboost::common::DataType>(param.colmat_dtype));
+      const std::string cache_prefix = ExternalCachePrefix(dmat);
+      if (cache_prefix.length() == 0) {
+        this->InitQuantizedData(dmat);
+        column_matrix_.Init(gmat_, static_cast<xgboost::common::DataType>(param.colmat_dtype));
+        gmat_pages_.reset(nullptr);
+      } else {
+        // external memory: the index is kept in pages on disk, and gmat_ only
+        // carries the cuts
+        hmat_.Init(dmat, param.max_bin);
+        gmat_.cut = &hmat_;
+        gmat_pages_.reset(new GHistIndexPages());
+        gmat_pages_->Init(dmat, &hmat_, cache_prefix);
+      }
       is_gmat_initialized_ = true;
       if (param.debug_verbose > 0) {
         LOG(INFO) << "Generating gmat: " << dmlc::GetTime() - tstart << " sec";
@@ -69,22 +86,26 @@ class FastHistMaker: public TreeUpdater {
     float lr = param.learning_rate;
     param.learning_rate = lr / trees.size();
     TConstraint::Init(&param, dmat->info().num_col);
-    // build tree
-    if (!builder_) {
-      builder_.reset(new Builder(param, std::move(pruner_)));
-    }
-    for (size_t i = 0; i < trees.size(); ++i) {
-      builder_->Update(gmat_, column_matrix_, gpair, dmat, trees[i]);
+    // build tree; the builder of the other precision, if any, was made before
+    // hist_precision was changed and its prediction cache is stale
+    if (param.hist_precision == TrainParam::kHistFloat) {
+      double_builder_.reset(nullptr);
+      this->BuildTrees(&float_builder_, gpair, dmat, trees);
+    } else {
+      float_builder_.reset(nullptr);
+      this->BuildTrees(&double_builder_, gpair, dmat, trees);
     }
     param.learning_rate = lr;
   }
 
   bool UpdatePredictionCache(const DMatrix* data,
                              std::vector<bst_float>* out_preds) const override {
-    if (!builder_ || param.subsample < 1.0f) {
+    if (param.subsample < 1.0f) {
       return false;
+    } else if (param.hist_precision == TrainParam::kHistFloat) {
+      return float_builder_ && float_builder_->UpdatePredictionCache(data, out_preds);
     } else {
-      return builder_->UpdatePredictionCache(data, out_preds);
+      return double_builder_ && double_builder_->UpdatePredictionCache(data, out_preds);
     }
   }
 
@@ -96,8 +117,44 @@ class FastHistMaker: public TreeUpdater {
   GHistIndexMatrix gmat_;
   // column accessor
   ColumnMatrix column_matrix_;
+  // quantized index in pages, for external memory data
+  std::unique_ptr<GHistIndexPages> gmat_pages_;
   bool is_gmat_initialized_;
 
+  // cache prefix of an external memory matrix; empty for in-memory data
+  static std::string ExternalCachePrefix(DMatrix* dmat) {
+#if DMLC_ENABLE_STD_THREAD
+    const data::SparsePageDMatrix* ext = dynamic_cast<const data::SparsePageDMatrix*>(dmat);
+    if (ext != nullptr) {
+      return ext->cache_info();
+    }
+#endif
+    return std::string();
+  }
+
+  // compute cuts and quantized index of in-memory data, or load them from
+  // hist_cache_file if it was made for the same data
+  inline void InitQuantizedData(DMatrix* dmat) {
+    gmat_.cut = &hmat_;
+    if (param.hist_cache_file.length() != 0 && rabit::IsDistributed()) {
+      LOG(WARNING) << "hist_cache_file is ignored in distributed training";
+    } else if (param.hist_cache_file.length() != 0) {
+      const uint64_t fingerprint = HistCache::Fingerprint(dmat, param.max_bin);
+      if (HistCache::Load(param.hist_cache_file, fingerprint, &hmat_, &gmat_)) {
+        if (!param.silent) {
+          LOG(CONSOLE) << "Loaded cuts and quantized data from " << param.hist_cache_file;
+        }
+      } else {
+        hmat_.Init(dmat, param.max_bin);
+        gmat_.Init(dmat);
+        HistCache::Save(param.hist_cache_file, fingerprint, hmat_, gmat_);
+      }
+      return;
+    }
+    hmat_.Init(dmat, param.max_bin);
+    gmat_.Init(dmat);
+  }
+
   // data structure
   /*! \brief per thread x per node entry to store tmp data */
   struct ThreadEntry {
@@ -131,20 +188,24 @@ class FastHistMaker: public TreeUpdater {
     }
   };
   // actual builder that runs the algorithm
-
+  // GradientSumT: type used for accumulating gradient statistics in histograms
+  template<typename GradientSumT>
   struct Builder {
    public:
     // constructor
     explicit Builder(const TrainParam& param,
                      std::unique_ptr<TreeUpdater> pruner)
-      : param(param), pruner_(std::move(pruner)),
+      : param(param), pruner_(std::move(pruner)), pages_(nullptr),
         p_last_tree_(nullptr), p_last_fmat_(nullptr) {}
     // update one tree, growing
+    // pages: index pages of external memory data, or nullptr if gmat holds the index
     virtual void Update(const GHistIndexMatrix& gmat,
                         const ColumnMatrix& column_matrix,
+                        GHistIndexPages* pages,
                         const std::vector<bst_gpair>& gpair,
                         DMatrix* p_fmat,
                         RegTree* p_tree) {
+      pages_ = pages;
       double gstart = dmlc::GetTime();
 
       int num_leaves = 0;
@@ -168,7 +229,7 @@ class FastHistMaker: public TreeUpdater {
       for (int nid = 0; nid < p_tree->param.num_roots; ++nid) {
         tstart = dmlc::GetTime();
         hist_.AddHistRow(nid);
-        builder_.BuildHist(gpair, row_set_collection_[nid], gmat, feat_set, hist_[nid]);
+        this->BuildHist(gpair, {row_set_collection_[nid]}, gmat, feat_set, {hist_[nid]});
         time_build_hist += dmlc::GetTime() - tstart;
 
         tstart = dmlc::GetTime();
@@ -176,7 +237,7 @@ class FastHistMaker: public TreeUpdater {
         time_init_new_node += dmlc::GetTime() - tstart;
 
         tstart = dmlc::GetTime();
-        this->EvaluateSplit(nid, gmat, hist_, *p_fmat, *p_tree, feat_set);
+        this->EvaluateSplit({nid}, gmat, hist_, *p_fmat, *p_tree, feat_set);
         time_evaluate_split += dmlc::GetTime() - tstart;
         qexpand_->push(ExpandEntry(nid, p_tree->GetDepth(nid),
                                    snode[nid].best.loss_chg,
@@ -185,52 +246,65 @@ class FastHistMaker: public TreeUpdater {
       }
 
       while (!qexpand_->empty()) {
-        const ExpandEntry candidate = qexpand_->top();
-        const int nid = candidate.nid;
+        // take a batch of candidates: all nodes of the next level for depthwise
+        // policy, a single node otherwise
+        std::vector<ExpandEntry> candidates;
+        candidates.push_back(qexpand_->top());
         qexpand_->pop();
-        if (candidate.loss_chg <= rt_eps
-            || (param.max_depth > 0 && candidate.depth == param.max_depth)
-            || (param.max_leaves > 0 && num_leaves == param.max_leaves) ) {
-          (*p_tree)[nid].set_leaf(snode[nid].weight * param.learning_rate);
-        } else {
-          tstart = dmlc::GetTime();
-          this->ApplySplit(nid, gmat, column_matrix, hist_, *p_fmat, p_tree);
-          time_apply_split += dmlc::GetTime() - tstart;
+        if (param.grow_policy == TrainParam::kDepthWise) {
+          while (!qexpand_->empty() && qexpand_->top().depth == candidates[0].depth) {
+            candidates.push_back(qexpand_->top());
+            qexpand_->pop();
+          }
+        }
 
-          tstart = dmlc::GetTime();
-          const int cleft = (*p_tree)[nid].cleft();
-          const int cright = (*p_tree)[nid].cright();
-          hist_.AddHistRow(cleft);
-          hist_.AddHistRow(cright);
-          if (row_set_collection_[cleft].size() < row_set_collection_[cright].size()) {
-            builder_.BuildHist(gpair, row_set_collection_[cleft], gmat, feat_set,
-                               hist_[cleft]);
-            builder_.SubtractionTrick(hist_[cright], hist_[cleft], hist_[nid]);
+        std::vector<int> split_nodes;
+        for (const ExpandEntry& candidate : candidates) {
+          const int nid = candidate.nid;
+          if (candidate.loss_chg <= rt_eps
+              || (param.max_depth > 0 && candidate.depth == param.max_depth)
+              || (param.max_leaves > 0 && num_leaves == param.max_leaves) ) {
+            (*p_tree)[nid].set_leaf(snode[nid].weight * param.learning_rate);
+            hist_.DeleteHistRow(nid);
           } else {
-            builder_.BuildHist(gpair, row_set_collection_[cright], gmat, feat_set,
-                               hist_[cright]);
-            builder_.SubtractionTrick(hist_[cleft], hist_[cright], hist_[nid]);
+            tstart = dmlc::GetTime();
+            this->ApplySplit(nid, gmat, column_matrix, hist_, *p_fmat, p_tree);
+            time_apply_split += dmlc::GetTime() - tstart;
+            split_nodes.push_back(nid);
+            ++num_leaves;  // give two and take one, as parent is no longer a leaf
           }
-          time_build_hist += dmlc::GetTime() - tstart;
+        }
+        if (split_nodes.empty()) continue;
 
-          tstart = dmlc::GetTime();
-          this->InitNewNode(cleft, gmat, gpair, *p_fmat, *p_tree);
-          this->InitNewNode(cright, gmat, gpair, *p_fmat, *p_tree);
-          time_init_new_node += dmlc::GetTime() - tstart;
+        tstart = dmlc::GetTime();
+        this->BuildChildHist(split_nodes, gmat, gpair, feat_set, *p_tree);
+        time_build_hist += dmlc::GetTime() - tstart;
 
-          tstart = dmlc::GetTime();
-          this->EvaluateSplit(cleft, gmat, hist_, *p_fmat, *p_tree, feat_set);
-          this->EvaluateSplit(cright, gmat, hist_, *p_fmat, *p_tree, feat_set);
-          time_evaluate_split += dmlc::GetTime() - tstart;
+        tstart = dmlc::GetTime();
+        for (int nid : split_nodes) {
+          this->InitNewNode((*p_tree)[nid].cleft(), gmat, gpair, *p_fmat, *p_tree);
+          this->InitNewNode((*p_tree)[nid].cright(), gmat, gpair, *p_fmat, *p_tree);
+        }
+        time_init_new_node += dmlc::GetTime() - tstart;
 
+        tstart = dmlc::GetTime();
+        std::vector<int> child_nodes;
+        for (int nid : split_nodes) {
+          child_nodes.push_back((*p_tree)[nid].cleft());
+          child_nodes.push_back((*p_tree)[nid].cright());
+        }
+        this->EvaluateSplit(child_nodes, gmat, hist_, *p_fmat, *p_tree, feat_set);
+        time_evaluate_split += dmlc::GetTime() - tstart;
+
+        for (int nid : split_nodes) {
+          const int cleft = (*p_tree)[nid].cleft();
+          const int cright = (*p_tree)[nid].cright();
           qexpand_->push(ExpandEntry(cleft, p_tree->GetDepth(cleft),
                                      snode[cleft].best.loss_chg,
                                      timestamp++));
           qexpand_->push(ExpandEntry(cright, p_tree->GetDepth(cright),
                                      snode[cright].best.loss_chg,
                                      timestamp++));
-
-          ++num_leaves;  // give two and take one, as parent is no longer a leaf
         }
       }
 
@@ -276,7 +350,10 @@ class FastHistMaker: public TreeUpdater {
                   << time_apply_split / total_time * 100 << "%)\n"
                   << "========================================\n"
                   << "Total:             "
-                  << std::fixed << std::setw(6) << std::setprecision(4) << total_time;
+                  << std::fixed << std::setw(6) << std::setprecision(4) << total_time << "\n"
+                  << "Peak hist memory:  "
+                  << std::fixed << std::setw(6) << std::setprecision(2)
+                  << hist_.PeakMemory() / 1048576.0 << " MB";
       }
     }
 
@@ -351,7 +428,15 @@ class FastHistMaker: public TreeUpdater {
         {
           this->nthread = omp_get_num_threads();
         }
-        builder_.Init(this->nthread, nbins);
+        if (pages_ != nullptr) {
+          // all pages share the type and layout of bin id's; let the first one stand for them
+          pages_->BeforeFirst();
+          CHECK(pages_->Next()) << "no index page found for external memory data";
+          builder_.Init(this->nthread, pages_->Value());
+          go_left_.resize(info.num_row);
+        } else {
+          builder_.Init(this->nthread, gmat);
+        }
 
         CHECK_EQ(info.root_index.size(), 0U);
         std::vector<bst_uint>& row_indices = row_set_collection_.row_indices_;
@@ -448,53 +533,156 @@ class FastHistMaker: public TreeUpdater {
       }
     }
 
-    inline void EvaluateSplit(int nid,
+    // build histograms for children of the given split nodes: the smaller child of
+    // each pair via aggregation, and its sibling via subtraction trick. Multiple
+    // nodes are processed in a single pass, to save on fork/join and scratch resets
+    inline void BuildChildHist(const std::vector<int>& split_nodes,
+                               const GHistIndexMatrix& gmat,
+                               const std::vector<bst_gpair>& gpair,
+                               const std::vector<bst_uint>& feat_set,
+                               const RegTree& tree) {
+      for (int nid : split_nodes) {
+        hist_.AddHistRow(tree[nid].cleft());
+        hist_.AddHistRow(tree[nid].cright());
+      }
+      // take histogram pointers only after all rows are added, as AddHistRow may reallocate
+      std::vector<RowSetCollection::Elem> small_rowsets;
+      std::vector<GHistRow<GradientSumT> > small_hists, large_hists, parent_hists;
+      for (int nid : split_nodes) {
+        const int cleft = tree[nid].cleft();
+        const int cright = tree[nid].cright();
+        if (row_set_collection_[cleft].size() < row_set_collection_[cright].size()) {
+          small_rowsets.push_back(row_set_collection_[cleft]);
+          small_hists.push_back(hist_[cleft]);
+          large_hists.push_back(hist_[cright]);
+        } else {
+          small_rowsets.push_back(row_set_collection_[cright]);
+          small_hists.push_back(hist_[cright]);
+          large_hists.push_back(hist_[cleft]);
+        }
+        parent_hists.push_back(hist_[nid]);
+      }
+      this->BuildHist(gpair, small_rowsets, gmat, feat_set, small_hists);
+      if (split_nodes.size() == 1) {
+        builder_.SubtractionTrick(large_hists[0], small_hists[0], parent_hists[0]);
+      } else {
+        builder_.SubtractionTrick(large_hists, small_hists, parent_hists);
+      }
+      // histograms of split nodes are no longer needed; recycle them for later nodes
+      for (int nid : split_nodes) {
+        hist_.DeleteHistRow(nid);
+      }
+    }
+
+    // build histograms for the given rowsets. For external memory data, the index
+    // pages are streamed through once; since rows of each rowset are kept sorted,
+    // the rows falling into a page form a contiguous range
+    inline void BuildHist(const std::vector<bst_gpair>& gpair,
+                          const std::vector<RowSetCollection::Elem>& rowsets,
+                          const GHistIndexMatrix& gmat,
+                          const std::vector<bst_uint>& feat_set,
+                          const std::vector<GHistRow<GradientSumT> >& hists) {
+      if (pages_ == nullptr) {
+        if (rowsets.size() == 1) {
+          builder_.BuildHist(gpair, rowsets[0], gmat, feat_set, hists[0],
+                             data_layout_ != kSparseData);
+        } else {
+          builder_.BuildHist(gpair, rowsets, gmat, feat_set, hists);
+        }
+        return;
+      }
+      std::vector<RowSetCollection::Elem> page_rowsets(rowsets.size());
+      pages_->BeforeFirst();
+      while (pages_->Next()) {
+        const GHistIndexMatrix& page = pages_->Value();
+        const bst_uint rbegin = static_cast<bst_uint>(page.base_rowid);
+        const bst_uint rend = static_cast<bst_uint>(page.base_rowid + page.row_ptr.size() - 1);
+        size_t nrows = 0;
+        for (size_t i = 0; i < rowsets.size(); ++i) {
+          const bst_uint* begin = std::lower_bound(rowsets[i].begin, rowsets[i].end, rbegin);
+          const bst_uint* end = std::lower_bound(begin, rowsets[i].end, rend);
+          page_rowsets[i] = RowSetCollection::Elem(begin, end, rowsets[i].node_id);
+          nrows += end - begin;
+        }
+        if (nrows == 0) continue;
+        if (rowsets.size() == 1) {
+          builder_.BuildHist(gpair, page_rowsets[0], page, feat_set, hists[0],
+                             data_layout_ != kSparseData);
+        } else {
+          builder_.BuildHist(gpair, page_rowsets, page, feat_set, hists);
+        }
+      }
+    }
+
+    // evaluate the splits of the given nodes together. The tasks are (node, block of
+    // features) pairs, so that threads are kept busy when there are few features. Each task
+    // keeps its own best split and those are reduced in task order, so that the result does
+    // not depend on the number of threads
+    inline void EvaluateSplit(const std::vector<int>& nodes,
                               const GHistIndexMatrix& gmat,
-                              const HistCollection& hist,
+                              const HistCollection<GradientSumT>& hist,
                               const DMatrix& fmat,
                               const RegTree& tree,
                               const std::vector<bst_uint>& feat_set) {
-      // start enumeration
       const MetaInfo& info = fmat.info();
-      const bst_omp_uint nfeature = feat_set.size();
+      const std::vector<unsigned>& cut_ptr = gmat.cut->row_ptr;
       const bst_omp_uint nthread = static_cast<bst_omp_uint>(this->nthread);
-      best_split_tloc_.resize(nthread);
-      #pragma omp parallel for schedule(static) num_threads(nthread)
-      for (bst_omp_uint tid = 0; tid < nthread; ++tid) {
-        best_split_tloc_[tid] = snode[nid].best;
+      // the kernel gives the same splits as EnumerateSplit for GradStats without constraint
+      const bool use_kernel = std::is_same<TStats, GradStats>::value &&
+          std::is_same<TConstraint, NoConstraint>::value && HistSplitKernel::Supported(param);
+      // blocks of consecutive features with about kBlockBins bins, at least one feature
+      const unsigned kBlockBins = 512;
+      feat_block_ptr_.clear();
+      feat_block_ptr_.push_back(0);
+      unsigned nbins = 0;
+      for (size_t i = 0; i < feat_set.size(); ++i) {
+        nbins += cut_ptr[feat_set[i] + 1] - cut_ptr[feat_set[i]];
+        if (nbins >= kBlockBins || i + 1 == feat_set.size()) {
+          feat_block_ptr_.push_back(i + 1);
+          nbins = 0;
+        }
       }
+      const size_t nblock = feat_block_ptr_.size() - 1;
+      const bst_omp_uint ntask = static_cast<bst_omp_uint>(nodes.size() * nblock);
+      best_split_task_.resize(ntask);
+      split_kernel_tloc_.resize(nthread);
       #pragma omp parallel for schedule(dynamic) num_threads(nthread)
-      for (bst_omp_uint i = 0; i < nfeature; ++i) {
-        const bst_uint fid = feat_set[i];
+      for (bst_omp_uint t = 0; t < ntask; ++t) {
+        const int nid = nodes[t / nblock];
+        const size_t block = t % nblock;
         const unsigned tid = omp_get_thread_num();
-        this->EnumerateSplit(-1, gmat, hist[nid], snode[nid], constraints_[nid], info,
-          &best_split_tloc_[tid], fid);
-        this->EnumerateSplit(+1, gmat, hist[nid], snode[nid], constraints_[nid], info,
-          &best_split_tloc_[tid], fid);
+        SplitEntry best;
+        for (size_t i = feat_block_ptr_[block]; i < feat_block_ptr_[block + 1]; ++i) {
+          const bst_uint fid = feat_set[i];
+          if (use_kernel) {
+            const unsigned ibegin = cut_ptr[fid];
+            const unsigned iend = cut_ptr[fid + 1];
+            split_kernel_tloc_[tid].Enumerate(param, hist[nid].begin + ibegin, iend - ibegin,
+                                              dmlc::BeginPtr(gmat.cut->cut) + ibegin,
+                                              gmat.cut->min_val[fid], snode[nid].stats,
+                                              snode[nid].root_gain, fid, &best);
+          } else {
+            this->EnumerateSplit(-1, gmat, hist[nid], snode[nid], constraints_[nid], info,
+              &best, fid);
+            this->EnumerateSplit(+1, gmat, hist[nid], snode[nid], constraints_[nid], info,
+              &best, fid);
+          }
+        }
+        best_split_task_[t] = best;
       }
-      for (unsigned tid = 0; tid < nthread; ++tid) {
-        snode[nid].best.Update(best_split_tloc_[tid]);
+      for (size_t j = 0; j < nodes.size(); ++j) {
+        for (size_t block = 0; block < nblock; ++block) {
+          snode[nodes[j]].best.Update(best_split_task_[j * nblock + block]);
+        }
       }
     }
 
     inline void ApplySplit(int nid,
                            const GHistIndexMatrix& gmat,
                            const ColumnMatrix& column_matrix,
-                           const HistCollection& hist,
+                           const HistCollection<GradientSumT>& hist,
                            const DMatrix& fmat,
                            RegTree* p_tree) {
-      XGBOOST_TYPE_SWITCH(column_matrix.dtype, {
-        ApplySplit_<DType>(nid, gmat, column_matrix, hist, fmat, p_tree);
-      });
-    }
-
-    template <typename T>
-    inline void ApplySplit_(int nid,
-                            const GHistIndexMatrix& gmat,
-                            const ColumnMatrix& column_matrix,
-                            const HistCollection& hist,
-                            const DMatrix& fmat,
-                            RegTree* p_tree) {
       // TODO(hcho3): support feature sampling by levels
 
       /* 1. Create child nodes */
@@ -509,17 +697,9 @@ class FastHistMaker: public TreeUpdater {
       (*p_tree)[cright].set_leaf(0.0f, 0);
 
       /* 2. Categorize member rows */
-      const bst_omp_uint nthread = static_cast<bst_omp_uint>(this->nthread);
-      row_split_tloc_.resize(nthread);
-      for (bst_omp_uint i = 0; i < nthread; ++i) {
-        row_split_tloc_[i].left.clear();
-        row_split_tloc_[i].right.clear();
-      }
       const bool default_left = (*p_tree)[nid].default_left();
       const bst_uint fid = (*p_tree)[nid].split_index();
       const bst_float split_pt = (*p_tree)[nid].split_cond();
-      const bst_uint lower_bound = gmat.cut->row_ptr[fid];
-      const bst_uint upper_bound = gmat.cut->row_ptr[fid + 1];
       bst_int split_cond = -1;
       // convert floating-point split_pt into corresponding bin_id
       // split_cond = -1 indicates that split_pt is less than all known cut points
@@ -527,216 +707,212 @@ class FastHistMaker: public TreeUpdater {
         if (split_pt == gmat.cut->cut[i]) split_cond = static_cast<bst_int>(i);
       }
 
-      const auto& rowset = row_set_collection_[nid];
+      if (pages_ != nullptr) {
+        ApplySplitPaged(nid, cleft, cright, gmat, fid, split_cond, default_left);
+      } else {
+        XGBOOST_TYPE_SWITCH(column_matrix.dtype, {
+          ApplySplit_<DType>(nid, cleft, cright, column_matrix.GetColumn<DType>(fid),
+                             split_cond, default_left);
+        });
+      }
+    }
 
-      Column<T> column = column_matrix.GetColumn<T>(fid);
+    template <typename T>
+    inline void ApplySplit_(int nid,
+                            int cleft,
+                            int cright,
+                            const Column<T>& column,
+                            bst_int split_cond,
+                            bool default_left) {
       if (column.type == xgboost::common::kDenseColumn) {
-        ApplySplitDenseData(rowset, gmat, &row_split_tloc_, column, split_cond,
-          default_left);
+        row_set_collection_.Partition(nid, cleft, cright, this->nthread,
+          [&](const bst_uint* rbegin, const bst_uint* rend, bst_uint* left, bst_uint* right) {
+            return PartitionDenseData(rbegin, rend, left, right, column, split_cond,
+                                      default_left);
+          });
       } else {
-        ApplySplitSparseData(rowset, gmat, &row_split_tloc_, column, lower_bound,
-          upper_bound, split_cond, default_left);
+        row_set_collection_.Partition(nid, cleft, cright, this->nthread,
+          [&](const bst_uint* rbegin, const bst_uint* rend, bst_uint* left, bst_uint* right) {
+            return PartitionSparseData(rbegin, rend, left, right, column, split_cond,
+                                       default_left);
+          });
       }
-
-      row_set_collection_.AddSplit(
-        nid, row_split_tloc_, (*p_tree)[nid].cleft(), (*p_tree)[nid].cright());
     }
 
-    template<typename T>
-    inline void ApplySplitDenseData(const RowSetCollection::Elem rowset,
-                                    const GHistIndexMatrix& gmat,
-                                    std::vector<RowSetCollection::Split>* p_row_split_tloc,
-                                    const Column<T>& column,
-                                    bst_int split_cond,
-                                    bool default_left) {
-      std::vector<RowSetCollection::Split>& row_split_tloc = *p_row_split_tloc;
-      const int K = 8;  // loop unrolling factor
-      const bst_omp_uint nrows = rowset.end - rowset.begin;
-      const bst_omp_uint rest = nrows % K;
-
-      #pragma omp parallel for num_threads(nthread) schedule(static)
-      for (bst_omp_uint i = 0; i < nrows - rest; i += K) {
-        const bst_uint tid = omp_get_thread_num();
-        auto& left = row_split_tloc[tid].left;
-        auto& right = row_split_tloc[tid].right;
-        bst_uint rid[K];
-        T rbin[K];
-        for (int k = 0; k < K; ++k) {
-          rid[k] = rowset.begin[i + k];
-        }
-        for (int k = 0; k < K; ++k) {
-          rbin[k] = column.index[rid[k]];
-        }
-        for (int k = 0; k < K; ++k) {
-          if (rbin[k] == std::numeric_limits<T>::max()) {  // missing value
-            if (default_left) {
-              left.push_back(rid[k]);
-            } else {
-              right.push_back(rid[k]);
-            }
-          } else {
-            if (static_cast<bst_int>(rbin[k] + column.index_base) <= split_cond) {
-              left.push_back(rid[k]);
+    // external memory version of ApplySplit_: record the direction of every member
+    // row while streaming through index pages, then partition by the directions
+    inline void ApplySplitPaged(int nid,
+                                int cleft,
+                                int cright,
+                                const GHistIndexMatrix& gmat,
+                                bst_uint fid,
+                                bst_int split_cond,
+                                bool default_left) {
+      const RowSetCollection::Elem rowset = row_set_collection_[nid];
+      pages_->BeforeFirst();
+      while (pages_->Next()) {
+        const GHistIndexMatrix& page = pages_->Value();
+        const bst_uint rbegin = static_cast<bst_uint>(page.base_rowid);
+        const bst_uint rend = static_cast<bst_uint>(page.base_rowid + page.row_ptr.size() - 1);
+        const bst_uint* begin = std::lower_bound(rowset.begin, rowset.end, rbegin);
+        const bst_uint* end = std::lower_bound(begin, rowset.end, rend);
+        if (begin == end) continue;
+        XGBOOST_TYPE_SWITCH(page.index_dtype, {
+          MarkSplitPage<DType>(RowSetCollection::Elem(begin, end, nid), page,
+                               gmat.cut->row_ptr[fid], gmat.cut->row_ptr[fid + 1],
+                               split_cond, default_left);
+        });
+      }
+      const uint8_t* go_left = dmlc::BeginPtr(go_left_);
+      row_set_collection_.Partition(nid, cleft, cright, this->nthread,
+        [go_left](const bst_uint* rbegin, const bst_uint* rend,
+                  bst_uint* left, bst_uint* right) {
+          const bst_uint* left_begin = left;
+          for (const bst_uint* it = rbegin; it != rend; ++it) {
+            if (go_left[*it]) {
+              *left++ = *it;
             } else {
-              right.push_back(rid[k]);
+              *--right = *it;
             }
           }
-        }
+          return static_cast<size_t>(left - left_begin);
+        });
+    }
+
+    // record in go_left_ the direction of rows in rowset, all of which are in page;
+    // bins of the split feature are [lower_bound, upper_bound)
+    template<typename T>
+    inline void MarkSplitPage(const RowSetCollection::Elem rowset,
+                              const GHistIndexMatrix& page,
+                              bst_uint lower_bound,
+                              bst_uint upper_bound,
+                              bst_int split_cond,
+                              bool default_left) {
+      const T* index = page.GetIndex<T>();
+      const size_t base_rowid = page.base_rowid;
+      const bst_omp_uint nrows = static_cast<bst_omp_uint>(rowset.size());
+      // for dense data, the split feature has a fixed position within each row
+      size_t pos = 0;
+      if (page.is_dense) {
+        pos = std::lower_bound(page.index_base.begin(), page.index_base.end(), lower_bound)
+              - page.index_base.begin();
+        CHECK_LT(pos, page.index_base.size());
+        CHECK_EQ(page.index_base[pos], lower_bound);
       }
-      for (bst_omp_uint i = nrows - rest; i < nrows; ++i) {
-        auto& left = row_split_tloc[nthread-1].left;
-        auto& right = row_split_tloc[nthread-1].right;
+      #pragma omp parallel for num_threads(nthread) schedule(static)
+      for (bst_omp_uint i = 0; i < nrows; ++i) {
         const bst_uint rid = rowset.begin[i];
-        const T rbin = column.index[rid];
-        if (rbin == std::numeric_limits<T>::max()) {  // missing value
-          if (default_left) {
-            left.push_back(rid);
-          } else {
-            right.push_back(rid);
-          }
+        bst_int bin = -1;  // missing value
+        if (page.is_dense) {
+          bin = static_cast<bst_int>(index[(rid - base_rowid) * page.row_stride + pos]
+                                     + page.index_base[pos]);
         } else {
-          if (static_cast<bst_int>(rbin + column.index_base) <= split_cond) {
-            left.push_back(rid);
-          } else {
-            right.push_back(rid);
+          // global bin id's are stored directly, sorted within each row
+          const T* row_end = index + page.row_ptr[rid - base_rowid + 1];
+          const T* p = std::lower_bound(index + page.row_ptr[rid - base_rowid], row_end,
+                                        static_cast<T>(lower_bound));
+          if (p != row_end && *p < upper_bound) {
+            bin = static_cast<bst_int>(*p);
           }
         }
+        go_left_[rid] = (bin < 0) ? default_left : (bin <= split_cond);
       }
     }
 
-    inline void ApplySplitSparseDataOld(const RowSetCollection::Elem rowset,
-                                        const GHistIndexMatrix& gmat,
-                                        std::vector<RowSetCollection::Split>* p_row_split_tloc,
-                                        bst_uint lower_bound,
-                                        bst_uint upper_bound,
-                                        bst_int split_cond,
-                                        bool default_left) {
-      std::vector<RowSetCollection::Split>& row_split_tloc = *p_row_split_tloc;
+    // classify rows in [rbegin, rend) by a dense column: left rows are written
+    // forward from left, right rows backward from right; returns # of left rows
+    template<typename T>
+    inline size_t PartitionDenseData(const bst_uint* rbegin,
+                                     const bst_uint* rend,
+                                     bst_uint* left,
+                                     bst_uint* right,
+                                     const Column<T>& column,
+                                     bst_int split_cond,
+                                     bool default_left) {
+      const bst_uint* left_begin = left;
       const int K = 8;  // loop unrolling factor
-      const bst_omp_uint nrows = rowset.end - rowset.begin;
-      const bst_omp_uint rest = nrows % K;
-      #pragma omp parallel for num_threads(nthread) schedule(static)
-      for (bst_omp_uint i = 0; i < nrows - rest; i += K) {
+      const size_t nrows = rend - rbegin;
+      const size_t rest = nrows % K;
+
+      for (size_t i = 0; i < nrows - rest; i += K) {
         bst_uint rid[K];
-        GHistIndexRow row[K];
-        const unsigned* p[K];
-        bst_uint tid = omp_get_thread_num();
-        auto& left = row_split_tloc[tid].left;
-        auto& right = row_split_tloc[tid].right;
-        for (int k = 0; k < K; ++k) {
-          rid[k] = rowset.begin[i + k];
-        }
+        T rbin[K];
         for (int k = 0; k < K; ++k) {
-          row[k] = gmat[rid[k]];
+          rid[k] = rbegin[i + k];
         }
         for (int k = 0; k < K; ++k) {
-          p[k] = std::lower_bound(row[k].index, row[k].index + row[k].size, lower_bound);
+          rbin[k] = column.index[rid[k]];
         }
         for (int k = 0; k < K; ++k) {
-          if (p[k] != row[k].index + row[k].size && *p[k] < upper_bound) {
-            if (static_cast<bst_int>(*p[k]) <= split_cond) {
-              left.push_back(rid[k]);
-            } else {
-              right.push_back(rid[k]);
-            }
+          const bool go_left = (rbin[k] == std::numeric_limits<T>::max())  // missing value
+            ? default_left
+            : static_cast<bst_int>(rbin[k] + column.index_base) <= split_cond;
+          if (go_left) {
+            *left++ = rid[k];
           } else {
-            if (default_left) {
-              left.push_back(rid[k]);
-            } else {
-              right.push_back(rid[k]);
-            }
+            *--right = rid[k];
           }
         }
       }
-      for (bst_omp_uint i = nrows - rest; i < nrows; ++i) {
-        const bst_uint rid = rowset.begin[i];
-        const auto row = gmat[rid];
-        const auto p = std::lower_bound(row.index, row.index + row.size, lower_bound);
-        auto& left = row_split_tloc[0].left;
-        auto& right = row_split_tloc[0].right;
-        if (p != row.index + row.size && *p < upper_bound) {
-          if (static_cast<bst_int>(*p) <= split_cond) {
-            left.push_back(rid);
-          } else {
-            right.push_back(rid);
-          }
+      for (size_t i = nrows - rest; i < nrows; ++i) {
+        const bst_uint rid = rbegin[i];
+        const T rbin = column.index[rid];
+        const bool go_left = (rbin == std::numeric_limits<T>::max())  // missing value
+          ? default_left
+          : static_cast<bst_int>(rbin + column.index_base) <= split_cond;
+        if (go_left) {
+          *left++ = rid;
         } else {
-          if (default_left) {
-            left.push_back(rid);
-          } else {
-            right.push_back(rid);
-          }
+          *--right = rid;
         }
       }
+      return left - left_begin;
     }
 
+    // classify rows in [rbegin, rend) by a sparse column; same convention as
+    // PartitionDenseData. Rows must be sorted, as they are merged with column.row_ind
     template<typename T>
-    inline void ApplySplitSparseData(const RowSetCollection::Elem rowset,
-                                    const GHistIndexMatrix& gmat,
-                                    std::vector<RowSetCollection::Split>* p_row_split_tloc,
-                                    const Column<T>& column,
-                                    bst_uint lower_bound,
-                                    bst_uint upper_bound,
-                                    bst_int split_cond,
-                                    bool default_left) {
-      std::vector<RowSetCollection::Split>& row_split_tloc = *p_row_split_tloc;
-      const bst_omp_uint nrows = rowset.end - rowset.begin;
-
-      #pragma omp parallel num_threads(nthread)
-      {
-        const bst_uint tid = omp_get_thread_num();
-        const bst_omp_uint ibegin = tid * nrows / nthread;
-        const bst_omp_uint iend = (tid + 1) * nrows / nthread;
-        if (ibegin < iend) {  // ensure that [ibegin, iend) is nonempty range
-          // search first nonzero row with index >= rowset[ibegin]
-          const uint32_t* p = std::lower_bound(column.row_ind,
-                                               column.row_ind + column.len,
-                                               rowset.begin[ibegin]);
-
-          auto& left = row_split_tloc[tid].left;
-          auto& right = row_split_tloc[tid].right;
-          if (p != column.row_ind + column.len && *p <= rowset.begin[iend - 1]) {
-            bst_omp_uint cursor = p - column.row_ind;
-
-            for (bst_omp_uint i = ibegin; i < iend; ++i) {
-              const bst_uint rid = rowset.begin[i];
-              while (cursor < column.len
-                     && column.row_ind[cursor] < rid
-                     && column.row_ind[cursor] <= rowset.begin[iend - 1]) {
-                ++cursor;
-              }
-              if (cursor < column.len && column.row_ind[cursor] == rid) {
-                const T rbin = column.index[cursor];
-                if (static_cast<bst_int>(rbin + column.index_base) <= split_cond) {
-                  left.push_back(rid);
-                } else {
-                  right.push_back(rid);
-                }
-                ++cursor;
-              } else {
-                // missing value
-                if (default_left) {
-                  left.push_back(rid);
-                } else {
-                  right.push_back(rid);
-                }
-              }
-            }
-          } else {  // all rows in [ibegin, iend) have missing values
-            if (default_left) {
-              for (bst_omp_uint i = ibegin; i < iend; ++i) {
-                const bst_uint rid = rowset.begin[i];
-                left.push_back(rid);
-              }
-            } else {
-              for (bst_omp_uint i = ibegin; i < iend; ++i) {
-                const bst_uint rid = rowset.begin[i];
-                right.push_back(rid);
-              }
-            }
+    inline size_t PartitionSparseData(const bst_uint* rbegin,
+                                      const bst_uint* rend,
+                                      bst_uint* left,
+                                      bst_uint* right,
+                                      const Column<T>& column,
+                                      bst_int split_cond,
+                                      bool default_left) {
+      const bst_uint* left_begin = left;
+      if (rbegin == rend) return 0;
+      // search first nonzero row with index >= rbegin[0]
+      const uint32_t* p = std::lower_bound(column.row_ind, column.row_ind + column.len,
+                                           rbegin[0]);
+      const uint32_t* p_end = std::upper_bound(p, column.row_ind + column.len, rend[-1]);
+      if (p == p_end) {  // all rows in [rbegin, rend) have missing values
+        for (const bst_uint* it = rbegin; it != rend; ++it) {
+          if (default_left) {
+            *left++ = *it;
+          } else {
+            *--right = *it;
           }
         }
+        return left - left_begin;
       }
+      for (const bst_uint* it = rbegin; it != rend; ++it) {
+        const bst_uint rid = *it;
+        while (p != p_end && *p < rid) {
+          ++p;
+        }
+        bool go_left = default_left;  // missing value
+        if (p != p_end && *p == rid) {
+          const T rbin = column.index[p - column.row_ind];
+          go_left = static_cast<bst_int>(rbin + column.index_base) <= split_cond;
+          ++p;
+        }
+        if (go_left) {
+          *left++ = rid;
+        } else {
+          *--right = rid;
+        }
+      }
+      return left - left_begin;
     }
 
     inline void InitNewNode(int nid,
@@ -756,13 +932,13 @@ class FastHistMaker: public TreeUpdater {
           /* specialized code for dense data
              For dense data (with no missing value),
                 the sum of gradient histogram is equal to snode[nid] */
-          GHistRow hist = hist_[nid];
+          GHistRow<GradientSumT> hist = hist_[nid];
           const std::vector<unsigned>& row_ptr = gmat.cut->row_ptr;
 
           const size_t ibegin = row_ptr[fid_least_bins_];
           const size_t iend = row_ptr[fid_least_bins_ + 1];
           for (size_t i = ibegin; i < iend; ++i) {
-            const GHistEntry et = hist.begin[i];
+            const GHistEntry<GradientSumT> et = hist.begin[i];
             stats.Add(et.sum_grad, et.sum_hess);
           }
         } else {
@@ -793,7 +969,7 @@ class FastHistMaker: public TreeUpdater {
     // enumerate the split values of specific feature
     inline void EnumerateSplit(int d_step,
                                const GHistIndexMatrix& gmat,
-                               const GHistRow& hist,
+                               const GHistRow<GradientSumT>& hist,
                                const NodeEntry& snode,
                                const TConstraint& constraint,
                                const MetaInfo& info,
@@ -891,21 +1067,28 @@ class FastHistMaker: public TreeUpdater {
     std::vector<bst_uint> feat_index;
     // the internal row sets
     RowSetCollection row_set_collection_;
-    // the temp space for split
-    std::vector<RowSetCollection::Split> row_split_tloc_;
-    std::vector<SplitEntry> best_split_tloc_;
+    // the temp space for split, best split found by each task of EvaluateSplit
+    std::vector<SplitEntry> best_split_task_;
+    // begin of each block of features of EvaluateSplit in feat_set, and the end
+    std::vector<size_t> feat_block_ptr_;
+    // per thread split enumeration kernel
+    std::vector<HistSplitKernel> split_kernel_tloc_;
     /*! \brief TreeNode Data: statistics for each constructed node */
     std::vector<NodeEntry> snode;
     /*! \brief culmulative histogram of gradients. */
-    HistCollection hist_;
+    HistCollection<GradientSumT> hist_;
     /*! \brief feature with least # of bins. to be used for dense specialization
                of InitNewNode() */
     size_t fid_least_bins_;
     /*! \brief local prediction cache; maps node id to leaf value */
     std::vector<float> leaf_value_cache_;
 
-    GHistBuilder builder_;
+    GHistBuilder<GradientSumT> builder_;
     std::unique_ptr<TreeUpdater> pruner_;
+    // index pages of external memory data; nullptr for in-memory data
+    GHistIndexPages* pages_;
+    // direction of each row at the split being applied, for external memory data
+    std::vector<uint8_t> go_left_;
 
     // back pointers to tree and data matrix
     const RegTree* p_last_tree_;
@@ -923,7 +1106,22 @@ class FastHistMaker: public TreeUpdater {
     DataLayout data_layout_;
   };
 
-  std::unique_ptr<Builder> builder_;
+  template<typename GradientSumT>
+  inline void BuildTrees(std::unique_ptr<Builder<GradientSumT> >* p_builder,
+                         const std::vector<bst_gpair>& gpair,
+                         DMatrix* dmat,
+                         const std::vector<RegTree*>& trees) {
+    std::unique_ptr<Builder<GradientSumT> >& builder = *p_builder;
+    if (!builder) {
+      builder.reset(new Builder<GradientSumT>(param, std::move(pruner_)));
+    }
+    for (size_t i = 0; i < trees.size(); ++i) {
+      builder->Update(gmat_, column_matrix_, gmat_pages_.get(), gpair, dmat, trees[i]);
+    }
+  }
+
+  std::unique_ptr<Builder<float> > float_builder_;
+  std::unique_ptr<Builder<double> > double_builder_;
   std::unique_ptr<TreeUpdater> pruner_;
 };
 
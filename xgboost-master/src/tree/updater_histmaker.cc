@@ -8,9 +8,12 @@
 #include <xgboost/tree_updater.h>
 #include <vector>
 #include <algorithm>
+#include <limits>
 #include "../common/sync.h"
 #include "../common/quantile.h"
 #include "../common/group_data.h"
+#include "../common/hist_util.h"
+#include "./sparse_hist_reducer.h"
 #include "./updater_basemaker-inl.h"
 
 namespace xgboost {
@@ -119,6 +122,10 @@ class HistMaker: public BaseMaker {
   ThreadWSpace wspace;
   // reducer for histogram
   rabit::Reducer<TStats, TStats::Reduce> histred;
+  // reducer for histogram that sends the non-empty bins only
+  SparseHistReducer<TStats> sparse_histred;
+  // start of the histograms of each node in wspace
+  std::vector<size_t> hist_node_ptr;
   // set of working features
   std::vector<bst_uint> fwork_set;
   // update function implementation
@@ -174,6 +181,23 @@ class HistMaker: public BaseMaker {
                           DMatrix *p_fmat,
                           const std::vector <bst_uint> &fset,
                           const RegTree &tree)  = 0;
+  // whether the histograms are synchronized at their non-empty bins only
+  inline bool SparseHistSync() const {
+    return param.sparse_hist_ratio > 0.0f && rabit::IsDistributed();
+  }
+  // synchronize the histograms in wspace.hset[0] over all workers
+  inline void SyncHist(size_t num_feature) {
+    if (this->SparseHistSync()) {
+      hist_node_ptr.clear();
+      for (size_t i = 0; i < wspace.rptr.size(); i += num_feature + 1) {
+        hist_node_ptr.push_back(wspace.rptr[i]);
+      }
+      sparse_histred.Allreduce(dmlc::BeginPtr(wspace.hset[0].data), hist_node_ptr,
+                               param.sparse_hist_ratio);
+    } else {
+      histred.Allreduce(dmlc::BeginPtr(wspace.hset[0].data), wspace.hset[0].data.size());
+    }
+  }
 
  private:
   inline void EnumerateSplit(const HistUnit &hist,
@@ -374,11 +398,16 @@ class CQHistMaker: public HistMaker<TStats> {
     // sync the histogram
     // if it is C++11, use lazy evaluation for Allreduce
 #if __cplusplus >= 201103L
-    this->histred.Allreduce(dmlc::BeginPtr(this->wspace.hset[0].data),
-                            this->wspace.hset[0].data.size(), lazy_get_hist);
+    if (this->SparseHistSync()) {
+      // the non-empty bins are only known from the local histograms
+      lazy_get_hist();
+      this->SyncHist(fset.size());
+    } else {
+      this->histred.Allreduce(dmlc::BeginPtr(this->wspace.hset[0].data),
+                              this->wspace.hset[0].data.size(), lazy_get_hist);
+    }
 #else
-    this->histred.Allreduce(dmlc::BeginPtr(this->wspace.hset[0].data),
-                            this->wspace.hset[0].data.size());
+    this->SyncHist(fset.size());
 #endif
   }
   void ResetPositionAfterSplit(DMatrix *p_fmat,
@@ -668,6 +697,8 @@ class GlobalProposalHistMaker: public CQHistMaker<TStats> {
       CQHistMaker<TStats>::ResetPosAndPropose(gpair, p_fmat, fset, tree);
       cached_rptr_ = this->wspace.rptr;
       cached_cut_ = this->wspace.cut;
+      // the bin ids are only valid for the cuts they were computed with
+      bin_seg_ptr_.clear();
     } else {
       this->wspace.cut.clear();
       this->wspace.rptr.clear();
@@ -690,6 +721,11 @@ class GlobalProposalHistMaker: public CQHistMaker<TStats> {
                   DMatrix *p_fmat,
                   const std::vector<bst_uint> &fset,
                   const RegTree &tree) override {
+    // the bin ids of all the pages would be held in memory
+    if (this->param.col_bin_cache && p_fmat->SingleColBlock()) {
+      this->CreateHistBinned(gpair, p_fmat, fset, tree);
+      return;
+    }
     const MetaInfo &info = p_fmat->info();
     // fill in reverse map
     this->feat2workindex.resize(tree.param.num_feature);
@@ -742,14 +778,207 @@ class GlobalProposalHistMaker: public CQHistMaker<TStats> {
             .data[0] = this->node_stats[nid];
       }
     }
-    this->histred.Allreduce(dmlc::BeginPtr(this->wspace.hset[0].data),
-                            this->wspace.hset[0].data.size());
+    this->SyncHist(fset.size());
+  }
+
+  // create histogram from the bin ids of the columns, binarized once per proposal
+  inline void CreateHistBinned(const std::vector<bst_gpair> &gpair,
+                               DMatrix *p_fmat,
+                               const std::vector<bst_uint> &fset,
+                               const RegTree &tree) {
+    const MetaInfo &info = p_fmat->info();
+    // fill in reverse map
+    this->feat2workindex.resize(tree.param.num_feature);
+    std::fill(this->feat2workindex.begin(), this->feat2workindex.end(), -1);
+    for (size_t i = 0; i < fset.size(); ++i) {
+      this->feat2workindex[fset[i]] = static_cast<int>(i);
+    }
+    // start to work
+    this->wspace.Init(this->param, 1);
+    if (bin_seg_ptr_.size() == 0) {
+      this->InitBinCache(p_fmat, fset);
+    }
+    CHECK_EQ(bin_seg_ptr_.size(), bin_npage_ * fset.size() + 1);
+    this->SetDefaultPostion(p_fmat, tree);
+    XGBOOST_TYPE_SWITCH(bin_dtype_, {
+      this->template CorrectNonDefaultPositionByBins<DType>(tree, fset.size());
+      this->template UpdateHistBinned<DType>(gpair, info, fset.size());
+    });
+    // update node statistics.
+    this->GetNodeStats(gpair, *p_fmat, tree,
+                       &(this->thread_stats), &(this->node_stats));
+    for (size_t i = 0; i < this->qexpand.size(); ++i) {
+      const int nid = this->qexpand[i];
+      const int wid = this->node2workindex[nid];
+      this->wspace.hset[0][fset.size() + wid * (fset.size()+1)]
+          .data[0] = this->node_stats[nid];
+    }
+    this->SyncHist(fset.size());
+  }
+  // binarize the columns of fset against the cached cuts, in a single pass over the pages
+  inline void InitBinCache(DMatrix *p_fmat, const std::vector<bst_uint> &fset) {
+    unsigned max_nbin = 0;
+    for (size_t i = 0; i < fset.size(); ++i) {
+      max_nbin = std::max(max_nbin, cached_rptr_[i + 1] - cached_rptr_[i]);
+    }
+    if (max_nbin <= std::numeric_limits<uint8_t>::max()) {
+      bin_dtype_ = common::uint8;
+    } else if (max_nbin <= std::numeric_limits<uint16_t>::max()) {
+      bin_dtype_ = common::uint16;
+    } else {
+      bin_dtype_ = common::uint32;
+    }
+    bin_npage_ = 0;
+    bin_seg_ptr_.clear();
+    bin_seg_ptr_.push_back(0);
+    bin_row_ind_.clear();
+    bin_index_.clear();
+    dmlc::DataIter<ColBatch> *iter = p_fmat->ColIterator(fset);
+    iter->BeforeFirst();
+    while (iter->Next()) {
+      XGBOOST_TYPE_SWITCH(bin_dtype_, {
+        this->template AddBinnedBatch<DType>(iter->Value(), fset.size());
+      });
+      ++bin_npage_;
+    }
+  }
+  /*!
+   * \brief append the bin ids of a column batch, as one segment per feature of the work set.
+   *  Rows that are out of the tree are dropped, they never come back before the next proposal.
+   */
+  template<typename BinT>
+  inline void AddBinnedBatch(const ColBatch &batch, size_t nfeature) {
+    const bst_omp_uint nsize = static_cast<bst_omp_uint>(batch.size);
+    std::vector<size_t> seg_size(nfeature, 0);
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (bst_omp_uint i = 0; i < nsize; ++i) {
+      const int offset = this->feat2workindex[batch.col_index[i]];
+      if (offset < 0) continue;
+      const ColBatch::Inst c = batch[i];
+      size_t n = 0;
+      for (bst_uint j = 0; j < c.length; ++j) {
+        if (this->position[c[j].index] >= 0) ++n;
+      }
+      seg_size[offset] = n;
+    }
+    const size_t seg_begin = bin_seg_ptr_.size() - 1;
+    for (size_t i = 0; i < nfeature; ++i) {
+      bin_seg_ptr_.push_back(bin_seg_ptr_.back() + seg_size[i]);
+    }
+    bin_row_ind_.resize(bin_seg_ptr_.back());
+    bin_index_.resize((bin_seg_ptr_.back() * sizeof(BinT) + sizeof(uint32_t) - 1) /
+                      sizeof(uint32_t));
+    BinT *bins = reinterpret_cast<BinT*>(dmlc::BeginPtr(bin_index_));
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (bst_omp_uint i = 0; i < nsize; ++i) {
+      const int offset = this->feat2workindex[batch.col_index[i]];
+      if (offset < 0) continue;
+      const ColBatch::Inst c = batch[i];
+      const bst_float *cut = dmlc::BeginPtr(cached_cut_) + cached_rptr_[offset];
+      const unsigned nbin = cached_rptr_[offset + 1] - cached_rptr_[offset];
+      size_t out = bin_seg_ptr_[seg_begin + offset];
+      for (bst_uint j = 0; j < c.length; ++j) {
+        if (this->position[c[j].index] < 0) continue;
+        const unsigned bin = std::upper_bound(cut, cut + nbin, c[j].fvalue) - cut;
+        CHECK_LT(bin, nbin);
+        bin_row_ind_[out] = c[j].index;
+        bins[out] = static_cast<BinT>(bin);
+        ++out;
+      }
+    }
+  }
+  /*!
+   * \brief move the rows of the nodes split at last level to the non-default child.
+   *  A split condition is a cut point of the proposal, so a row goes left
+   *  iff its bin is at most the bin of the condition.
+   */
+  template<typename BinT>
+  inline void CorrectNonDefaultPositionByBins(const RegTree &tree, size_t nfeature) {
+    split_bin_.resize(tree.param.num_nodes);
+    std::vector<bst_uint> fsplits;
+    for (size_t i = 0; i < this->qexpand.size(); ++i) {
+      const int nid = this->qexpand[i];
+      if (tree[nid].is_root()) continue;
+      const int pid = tree[nid].parent();
+      const bst_uint fid = tree[pid].split_index();
+      const int offset = this->feat2workindex[fid];
+      CHECK_GE(offset, 0);
+      const bst_float *cut = dmlc::BeginPtr(cached_cut_) + cached_rptr_[offset];
+      const unsigned nbin = cached_rptr_[offset + 1] - cached_rptr_[offset];
+      const bst_float *it = std::lower_bound(cut, cut + nbin, tree[pid].split_cond());
+      CHECK(it != cut + nbin && *it == tree[pid].split_cond())
+          << "split condition is not a cut point of the proposal";
+      split_bin_[pid] = static_cast<unsigned>(it - cut);
+      fsplits.push_back(fid);
+    }
+    std::sort(fsplits.begin(), fsplits.end());
+    fsplits.resize(std::unique(fsplits.begin(), fsplits.end()) - fsplits.begin());
+    const BinT *bins = reinterpret_cast<const BinT*>(dmlc::BeginPtr(bin_index_));
+    for (bst_uint fid : fsplits) {
+      const size_t offset = static_cast<size_t>(this->feat2workindex[fid]);
+      for (size_t k = 0; k < bin_npage_; ++k) {
+        const size_t begin = bin_seg_ptr_[k * nfeature + offset];
+        const bst_omp_uint ndata =
+            static_cast<bst_omp_uint>(bin_seg_ptr_[k * nfeature + offset + 1] - begin);
+        #pragma omp parallel for schedule(static)
+        for (bst_omp_uint j = 0; j < ndata; ++j) {
+          const bst_uint ridx = bin_row_ind_[begin + j];
+          const int nid = this->position[ridx];
+          if (nid < 0 || tree[nid].is_root()) continue;
+          const int pid = tree[nid].parent();
+          if (tree[pid].split_index() == fid) {
+            if (bins[begin + j] <= split_bin_[pid]) {
+              this->position[ridx] = tree[pid].cleft();
+            } else {
+              this->position[ridx] = tree[pid].cright();
+            }
+          }
+        }
+      }
+    }
+  }
+  // accumulate the histograms of all the nodes by bin id, one feature per task
+  template<typename BinT>
+  inline void UpdateHistBinned(const std::vector<bst_gpair> &gpair,
+                               const MetaInfo &info,
+                               size_t nfeature) {
+    const BinT *bins = reinterpret_cast<const BinT*>(dmlc::BeginPtr(bin_index_));
+    // the histograms of a node span the cuts of all features and its statistics
+    const size_t node_stride = cached_cut_.size();
+    TStats *data = dmlc::BeginPtr(this->wspace.hset[0].data);
+    const bst_omp_uint nsize = static_cast<bst_omp_uint>(nfeature);
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (bst_omp_uint i = 0; i < nsize; ++i) {
+      TStats *hist = data + cached_rptr_[i];
+      for (size_t k = 0; k < bin_npage_; ++k) {
+        const size_t end = bin_seg_ptr_[k * nfeature + i + 1];
+        for (size_t j = bin_seg_ptr_[k * nfeature + i]; j < end; ++j) {
+          const bst_uint ridx = bin_row_ind_[j];
+          const int nid = this->position[ridx];
+          if (nid >= 0) {
+            hist[this->node2workindex[nid] * node_stride + bins[j]].Add(gpair, info, ridx);
+          }
+        }
+      }
+    }
   }
 
   // cached unit pointer
   std::vector<unsigned> cached_rptr_;
   // cached cut value.
   std::vector<bst_float> cached_cut_;
+  // data type of the bin ids
+  common::DataType bin_dtype_;
+  // number of column pages binarized
+  size_t bin_npage_;
+  // start of the entries of each (page, feature) segment, features in order of the work set
+  std::vector<size_t> bin_seg_ptr_;
+  // row index of each entry
+  std::vector<bst_uint> bin_row_ind_;
+  // bin id of each entry within the cuts of its feature, packed as bin_dtype_
+  std::vector<uint32_t> bin_index_;
+  // bin of the split condition of each split node
+  std::vector<unsigned> split_bin_;
 };
 
 
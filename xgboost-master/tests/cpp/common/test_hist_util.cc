@@ -0,0 +1,30 @@
+// Copyright by Contributors
+#include <dmlc/omp.h>
+#include <xgboost/data.h>
+#include <memory>
+#include "../../../src/common/hist_util.h"
+
+#include "../helpers.h"
+
+TEST(HistCutMatrix, WideSameForAnyNumberOfThreads) {
+  // each column holds fewer distinct values than a sketch keeps, so the sketches are exact
+  // and merging those of several row blocks gives the serial cuts
+  const int ncol = (1 << 16) + 5;
+  const int nthread = omp_get_max_threads();
+  // many rows are split into row blocks only, few rows also into column groups
+  for (int nrow : {40, 3}) {
+    std::unique_ptr<xgboost::DMatrix> dmat = CreateRandomDMatrix(nrow, ncol);
+    omp_set_num_threads(1);
+    xgboost::common::HistCutMatrix serial;
+    serial.Init(dmat.get(), 16);
+    for (int n : {3, 4}) {
+      omp_set_num_threads(n);
+      xgboost::common::HistCutMatrix parallel;
+      parallel.Init(dmat.get(), 16);
+      EXPECT_EQ(parallel.row_ptr, serial.row_ptr) << nrow << " rows, " << n << " threads";
+      EXPECT_EQ(parallel.min_val, serial.min_val) << nrow << " rows, " << n << " threads";
+      EXPECT_EQ(parallel.cut, serial.cut) << nrow << " rows, " << n << " threads";
+    }
+  }
+  omp_set_num_threads(nthread);
+}
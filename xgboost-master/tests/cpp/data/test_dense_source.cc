@@ -0,0 +1,158 @@
+// Copyright by Contributors
+#include <xgboost/data.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <random>
+#include "../../../src/common/hist_util.h"
+#include "../../../src/data/dense_dmatrix.h"
+
+#include "../helpers.h"
+
+namespace {
+std::vector<xgboost::bst_float> RandomDense(size_t nrow, size_t ncol, float missing) {
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+  std::vector<xgboost::bst_float> data(nrow * ncol);
+  for (size_t i = 0; i < data.size(); ++i) {
+    const float r = dist(rng);
+    data[i] = r < 0.2f ? missing : r;
+  }
+  return data;
+}
+}  // namespace
+
+TEST(DenseSource, ToCSR) {
+  const size_t kRows = 100, kCols = 7;
+  const float kMissing = 0.0f;
+  std::vector<xgboost::bst_float> data = RandomDense(kRows, kCols, kMissing);
+  data[3] = std::numeric_limits<float>::quiet_NaN();
+  EXPECT_ANY_THROW(xgboost::data::DenseSource(data.data(), kRows, kCols, kMissing));
+  data[3] = kMissing;
+
+  xgboost::data::DenseSource source(data.data(), kRows, kCols, kMissing);
+  xgboost::data::SimpleCSRSource csr;
+  source.ToCSR(&csr);
+  ASSERT_EQ(csr.info.num_row, kRows);
+  ASSERT_EQ(csr.info.num_col, kCols);
+  ASSERT_EQ(csr.row_ptr_.size(), kRows + 1);
+  ASSERT_EQ(csr.info.num_nonzero, csr.row_data_.size());
+  for (size_t i = 0; i < kRows; ++i) {
+    size_t k = csr.row_ptr_[i];
+    for (size_t j = 0; j < kCols; ++j) {
+      if (data[i * kCols + j] == kMissing) continue;
+      ASSERT_LT(k, csr.row_ptr_[i + 1]);
+      EXPECT_EQ(csr.row_data_[k].index, j);
+      EXPECT_EQ(csr.row_data_[k].fvalue, data[i * kCols + j]);
+      ++k;
+    }
+    ASSERT_EQ(k, csr.row_ptr_[i + 1]);
+  }
+}
+
+TEST(DenseSource, Batches) {
+  const size_t kRows = 100, kCols = 7;
+  const float kMissing = std::numeric_limits<float>::quiet_NaN();
+  std::vector<xgboost::bst_float> data = RandomDense(kRows, kCols, kMissing);
+  xgboost::data::DenseSource source(data.data(), kRows, kCols, kMissing, 50);
+  xgboost::data::SimpleCSRSource csr;
+  source.ToCSR(&csr);
+  // rows of the batches must match those of the CSR copy
+  for (int pass = 0; pass < 2; ++pass) {
+    size_t nbatch = 0, nrow = 0;
+    source.BeforeFirst();
+    while (source.Next()) {
+      const xgboost::RowBatch& batch = source.Value();
+      ASSERT_EQ(batch.base_rowid, nrow);
+      ASSERT_LE(batch.ind_ptr[batch.size], 50U);
+      for (size_t i = 0; i < batch.size; ++i) {
+        const xgboost::RowBatch::Inst inst = batch[i];
+        const size_t ridx = batch.base_rowid + i;
+        ASSERT_EQ(inst.length, csr.row_ptr_[ridx + 1] - csr.row_ptr_[ridx]);
+        for (size_t j = 0; j < inst.length; ++j) {
+          EXPECT_EQ(inst[j].index, csr.row_data_[csr.row_ptr_[ridx] + j].index);
+          EXPECT_EQ(inst[j].fvalue, csr.row_data_[csr.row_ptr_[ridx] + j].fvalue);
+        }
+      }
+      nrow += batch.size;
+      ++nbatch;
+    }
+    ASSERT_EQ(nrow, kRows);
+    ASSERT_GT(nbatch, 1U);
+  }
+}
+
+TEST(DenseSource, MissingBitmap) {
+  const size_t kRows = 30, kCols = 5;
+  const float kMissing = -1.0f;
+  std::vector<xgboost::bst_float> data = RandomDense(kRows, kCols, kMissing);
+  xgboost::data::DenseSource source(data.data(), kRows, kCols, kMissing);
+  ASSERT_EQ(source.NumRow(), kRows);
+  ASSERT_EQ(source.NumCol(), kCols);
+  ASSERT_TRUE(source.HasMissing());
+  for (size_t i = 0; i < kRows; ++i) {
+    size_t length = 0;
+    for (size_t j = 0; j < kCols; ++j) {
+      const xgboost::bst_float v = data[i * kCols + j];
+      const bool missing = v == kMissing;
+      EXPECT_EQ(source.IsMissing(i, j), missing);
+      if (!missing) ++length;
+    }
+    EXPECT_EQ(source.RowLength(i), length);
+  }
+  // after OwnData, the values no longer depend on the caller's copy
+  source.OwnData();
+  const std::vector<xgboost::bst_float> expected = data;
+  std::fill(data.begin(), data.end(), 0.5f);
+  for (size_t i = 0; i < kRows; ++i) {
+    for (size_t j = 0; j < kCols; ++j) {
+      if (source.IsMissing(i, j)) continue;
+      EXPECT_EQ(source.Row(i)[j], expected[i * kCols + j]);
+    }
+  }
+
+  std::vector<xgboost::bst_float> full(kRows * kCols, 1.0f);
+  xgboost::data::DenseSource no_missing(full.data(), kRows, kCols, kMissing);
+  EXPECT_FALSE(no_missing.HasMissing());
+  EXPECT_EQ(no_missing.info.num_nonzero, kRows * kCols);
+}
+
+TEST(DenseDMatrix, HistIndexSameAsCSR) {
+  const size_t kRows = 500, kCols = 9;
+  const float kMissing = std::numeric_limits<float>::quiet_NaN();
+  for (bool with_missing : {false, true}) {
+    std::vector<xgboost::bst_float> data = RandomDense(kRows, kCols, kMissing);
+    if (!with_missing) {
+      for (size_t i = 0; i < data.size(); ++i) {
+        if (std::isnan(data[i])) data[i] = 0.25f;
+      }
+    }
+    std::unique_ptr<xgboost::data::SimpleCSRSource> csr(new xgboost::data::SimpleCSRSource());
+    xgboost::data::DenseSource(data.data(), kRows, kCols, kMissing).ToCSR(csr.get());
+    std::unique_ptr<xgboost::DMatrix> sparse(xgboost::DMatrix::Create(std::move(csr)));
+    xgboost::data::DenseDMatrix dense(
+        new xgboost::data::DenseSource(data.data(), kRows, kCols, kMissing));
+
+    xgboost::common::HistCutMatrix sparse_cut, dense_cut;
+    sparse_cut.Init(sparse.get(), 16);
+    dense_cut.Init(&dense, 16);
+    ASSERT_EQ(dense_cut.row_ptr, sparse_cut.row_ptr);
+    ASSERT_EQ(dense_cut.min_val, sparse_cut.min_val);
+    ASSERT_EQ(dense_cut.cut, sparse_cut.cut);
+
+    xgboost::common::GHistIndexMatrix sparse_index, dense_index;
+    sparse_index.cut = &sparse_cut;
+    sparse_index.Init(sparse.get());
+    dense_index.cut = &dense_cut;
+    dense_index.Init(&dense);
+    ASSERT_EQ(dense_index.is_dense, sparse_index.is_dense);
+    ASSERT_EQ(dense_index.row_ptr, sparse_index.row_ptr);
+    ASSERT_EQ(dense_index.hit_count, sparse_index.hit_count);
+    for (size_t i = 0; i < kRows; ++i) {
+      for (unsigned j = 0; j < sparse_index.RowSize(i); ++j) {
+        ASSERT_EQ(dense_index.GetGlobalBin(i, j), sparse_index.GetGlobalBin(i, j));
+      }
+    }
+  }
+}
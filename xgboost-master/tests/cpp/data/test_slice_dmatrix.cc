@@ -0,0 +1,170 @@
+// Copyright by Contributors
+#include <xgboost/data.h>
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <utility>
+#include "../../../src/data/dense_dmatrix.h"
+#include "../../../src/data/slice_dmatrix.h"
+
+#include "../helpers.h"
+
+namespace {
+
+// dense random matrix with a quarter of the cells missing, and labels and weights set
+std::shared_ptr<xgboost::DMatrix> RandomMatrix(size_t nrow, size_t ncol, bool dense,
+                                               std::vector<xgboost::bst_float>* data) {
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+  data->resize(nrow * ncol);
+  for (size_t i = 0; i < data->size(); ++i) {
+    const float r = dist(rng);
+    (*data)[i] = r < 0.25f ? 0.0f : static_cast<float>(rng() % 8);
+  }
+  // a small batch size makes the dense source hand out several row batches
+  std::unique_ptr<xgboost::data::DenseSource> source(
+      new xgboost::data::DenseSource(data->data(), nrow, ncol, 0.0f, 64));
+  std::shared_ptr<xgboost::DMatrix> dmat;
+  if (dense) {
+    dmat.reset(new xgboost::data::DenseDMatrix(source.release()));
+  } else {
+    std::unique_ptr<xgboost::data::SimpleCSRSource> csr(new xgboost::data::SimpleCSRSource());
+    source->ToCSR(csr.get());
+    dmat.reset(xgboost::DMatrix::Create(std::move(csr)));
+  }
+  for (size_t i = 0; i < nrow; ++i) {
+    dmat->info().labels.push_back(static_cast<float>(i));
+    dmat->info().weights.push_back(static_cast<float>(i) * 0.5f);
+  }
+  return dmat;
+}
+
+// rows of a slice, with some repeated and out of order, as in bagging
+std::vector<xgboost::bst_uint> RandomRows(size_t nrow, size_t len) {
+  std::mt19937 rng(1);
+  std::vector<xgboost::bst_uint> ridx(len);
+  for (size_t i = 0; i < len; ++i) {
+    ridx[i] = static_cast<xgboost::bst_uint>(rng() % nrow);
+  }
+  return ridx;
+}
+
+// column entries of all pages, sorted by feature, then value, then row
+std::vector<std::pair<xgboost::bst_uint, xgboost::SparseBatch::Entry> >
+ColumnEntries(xgboost::DMatrix* dmat) {
+  std::vector<std::pair<xgboost::bst_uint, xgboost::SparseBatch::Entry> > entries;
+  dmlc::DataIter<xgboost::ColBatch>* iter = dmat->ColIterator();
+  iter->BeforeFirst();
+  while (iter->Next()) {
+    const xgboost::ColBatch& batch = iter->Value();
+    for (size_t i = 0; i < batch.size; ++i) {
+      const xgboost::ColBatch::Inst col = batch[i];
+      for (size_t j = 0; j < col.length; ++j) {
+        if (j != 0) {
+          EXPECT_LE(col[j - 1].fvalue, col[j].fvalue);
+        }
+        entries.push_back(std::make_pair(batch.col_index[i], col[j]));
+      }
+    }
+  }
+  std::sort(entries.begin(), entries.end(),
+            [](const std::pair<xgboost::bst_uint, xgboost::SparseBatch::Entry>& a,
+               const std::pair<xgboost::bst_uint, xgboost::SparseBatch::Entry>& b) {
+              if (a.first != b.first) return a.first < b.first;
+              if (a.second.fvalue != b.second.fvalue) return a.second.fvalue < b.second.fvalue;
+              return a.second.index < b.second.index;
+            });
+  return entries;
+}
+}  // namespace
+
+TEST(SliceDMatrix, RowsAndInfo) {
+  const size_t kRows = 200, kCols = 6;
+  for (bool dense : {false, true}) {
+    std::vector<xgboost::bst_float> data;
+    std::shared_ptr<xgboost::DMatrix> parent = RandomMatrix(kRows, kCols, dense, &data);
+    const std::vector<xgboost::bst_uint> ridx = RandomRows(kRows, 150);
+    xgboost::data::SliceDMatrix slice(parent, ridx);
+
+    const xgboost::MetaInfo& info = slice.info();
+    ASSERT_EQ(info.num_row, ridx.size());
+    ASSERT_EQ(info.num_col, kCols);
+    size_t nnz = 0;
+    for (size_t i = 0; i < ridx.size(); ++i) {
+      EXPECT_EQ(info.labels[i], parent->info().labels[ridx[i]]);
+      EXPECT_EQ(info.weights[i], parent->info().weights[ridx[i]]);
+      for (size_t j = 0; j < kCols; ++j) {
+        nnz += data[ridx[i] * kCols + j] != 0.0f;
+      }
+    }
+    ASSERT_EQ(info.num_nonzero, nnz);
+
+    for (int pass = 0; pass < 2; ++pass) {
+      size_t nrow = 0;
+      dmlc::DataIter<xgboost::RowBatch>* iter = slice.RowIterator();
+      iter->BeforeFirst();
+      while (iter->Next()) {
+        const xgboost::RowBatch& batch = iter->Value();
+        ASSERT_EQ(batch.base_rowid, nrow);
+        for (size_t i = 0; i < batch.size; ++i) {
+          const xgboost::RowBatch::Inst inst = batch[i];
+          const xgboost::bst_float* row = &data[ridx[batch.base_rowid + i] * kCols];
+          size_t k = 0;
+          for (size_t j = 0; j < kCols; ++j) {
+            if (row[j] == 0.0f) continue;
+            ASSERT_LT(k, inst.length);
+            EXPECT_EQ(inst[k].index, j);
+            EXPECT_EQ(inst[k].fvalue, row[j]);
+            ++k;
+          }
+          ASSERT_EQ(k, inst.length);
+        }
+        nrow += batch.size;
+      }
+      ASSERT_EQ(nrow, ridx.size());
+    }
+  }
+  std::vector<xgboost::bst_float> data;
+  std::shared_ptr<xgboost::DMatrix> parent = RandomMatrix(10, 2, false, &data);
+  const std::vector<xgboost::bst_uint> out_of_range = {0, 10};
+  EXPECT_ANY_THROW(xgboost::data::SliceDMatrix(parent, out_of_range));
+}
+
+TEST(SliceDMatrix, ColumnPagesFromParent) {
+  const size_t kRows = 300, kCols = 5;
+  const std::vector<bool> enabled(kCols, true);
+  // a parent whose column pages lack a feature, so that the slice builds its own
+  std::vector<bool> parent_partial(kCols, true);
+  parent_partial[2] = false;
+  // parent and slice in one column page or several
+  for (size_t max_row_perbatch : {1000UL, 70UL}) {
+    for (const std::vector<bool>& parent_enabled : {enabled, parent_partial}) {
+      std::vector<xgboost::bst_float> data;
+      std::shared_ptr<xgboost::DMatrix> parent = RandomMatrix(kRows, kCols, false, &data);
+      parent->InitColAccess(parent_enabled, 1.0f, max_row_perbatch);
+      const std::vector<xgboost::bst_uint> ridx = RandomRows(kRows, 250);
+      xgboost::data::SliceDMatrix slice(parent, ridx);
+      slice.InitColAccess(enabled, 1.0f, max_row_perbatch);
+
+      // column pages built from the rows of a copy of the slice
+      std::unique_ptr<xgboost::data::SimpleCSRSource> copy(new xgboost::data::SimpleCSRSource());
+      copy->CopyFrom(&slice);
+      std::unique_ptr<xgboost::DMatrix> expected(xgboost::DMatrix::Create(std::move(copy)));
+      expected->InitColAccess(enabled, 1.0f, max_row_perbatch);
+
+      ASSERT_EQ(slice.SingleColBlock(), expected->SingleColBlock());
+      ASSERT_EQ(slice.buffered_rowset(), expected->buffered_rowset());
+      for (size_t j = 0; j < kCols; ++j) {
+        EXPECT_EQ(slice.GetColSize(j), expected->GetColSize(j));
+      }
+      const auto got = ColumnEntries(&slice);
+      const auto want = ColumnEntries(expected.get());
+      ASSERT_EQ(got.size(), want.size());
+      for (size_t i = 0; i < got.size(); ++i) {
+        EXPECT_EQ(got[i].first, want[i].first);
+        EXPECT_EQ(got[i].second.index, want[i].second.index);
+        EXPECT_EQ(got[i].second.fvalue, want[i].second.fvalue);
+      }
+    }
+  }
+}
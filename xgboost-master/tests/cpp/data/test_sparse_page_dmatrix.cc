@@ -1,5 +1,6 @@
 // Copyright by Contributors
 #include <xgboost/data.h>
+#include <memory>
 #include "../../../src/data/sparse_page_dmatrix.h"
 
 #include "../helpers.h"
@@ -96,3 +97,109 @@ TEST(SparsePageDMatrix, ColAcess) {
   std::remove((tmp_file + ".cache.col.page").c_str());
   std::remove((tmp_file + ".cache.row.page").c_str());
 }
+
+TEST(SparsePageDMatrix, ColAccessBuildStats) {
+  std::string tmp_file = CreateSimpleTestData();
+  xgboost::DMatrix * dmat = xgboost::DMatrix::Load(
+    tmp_file + "#" + tmp_file + ".cache", true, false);
+  std::remove(tmp_file.c_str());
+  xgboost::data::SparsePageDMatrix * ext =
+    dynamic_cast<xgboost::data::SparsePageDMatrix*>(dmat);
+  ASSERT_TRUE(ext != nullptr);
+  EXPECT_TRUE(ext->col_build_stats() == nullptr);
+
+  const std::vector<bool> enable(dmat->info().num_col, true);
+  dmat->InitColAccess(enable, 1, 1); // Max 1 row per patch
+  const xgboost::data::SparsePageDMatrix::ColPageBuildStats* stats = ext->col_build_stats();
+  ASSERT_TRUE(stats != nullptr);
+  // each stage of the pipeline handled every page
+  EXPECT_EQ(stats->transpose.num_page.load(), dmat->info().num_row);
+  EXPECT_EQ(stats->write.num_page.load(), dmat->info().num_row);
+  EXPECT_GT(stats->write.num_bytes.load(), 0U);
+  // rows reach the column pages in order
+  EXPECT_EQ(dmat->buffered_rowset().size(), dmat->info().num_row);
+  for (size_t i = 0; i < dmat->buffered_rowset().size(); ++i) {
+    EXPECT_EQ(dmat->buffered_rowset()[i], i);
+  }
+
+  // Clean up of external memory files
+  std::remove((tmp_file + ".cache").c_str());
+  std::remove((tmp_file + ".cache.col.meta").c_str());
+  std::remove((tmp_file + ".cache.col.page").c_str());
+  std::remove((tmp_file + ".cache.row.page").c_str());
+}
+
+TEST(SparsePageDMatrix, MMapFormat) {
+  std::string tmp_file = CreateSimpleTestData();
+  // the format of the cache files is given by the suffix of the cache prefix
+  const std::string raw_cache = tmp_file + ".cache";
+  const std::string mmap_cache = tmp_file + ".cache.fmt-mmap";
+  std::unique_ptr<xgboost::DMatrix> raw(xgboost::DMatrix::Load(
+    tmp_file + "#" + raw_cache, true, false));
+  std::unique_ptr<xgboost::DMatrix> mapped(xgboost::DMatrix::Load(
+    tmp_file + "#" + mmap_cache, true, false));
+  std::remove(tmp_file.c_str());
+  // pages start on a page boundary, after the name of the format
+  EXPECT_GT(GetFileSize(mmap_cache + ".row.page"),
+            static_cast<long>(xgboost::data::MappedPageFile::kPageAlign));
+
+  for (int pass = 0; pass < 2; ++pass) {
+    dmlc::DataIter<xgboost::RowBatch>* raw_iter = raw->RowIterator();
+    dmlc::DataIter<xgboost::RowBatch>* mapped_iter = mapped->RowIterator();
+    raw_iter->BeforeFirst();
+    mapped_iter->BeforeFirst();
+    while (raw_iter->Next()) {
+      ASSERT_TRUE(mapped_iter->Next());
+      const xgboost::RowBatch& a = raw_iter->Value();
+      const xgboost::RowBatch& b = mapped_iter->Value();
+      ASSERT_EQ(a.size, b.size);
+      EXPECT_EQ(a.base_rowid, b.base_rowid);
+      for (size_t i = 0; i < a.size; ++i) {
+        ASSERT_EQ(a[i].length, b[i].length);
+        for (size_t j = 0; j < a[i].length; ++j) {
+          EXPECT_EQ(a[i][j].index, b[i][j].index);
+          EXPECT_EQ(a[i][j].fvalue, b[i][j].fvalue);
+        }
+      }
+    }
+    EXPECT_FALSE(mapped_iter->Next());
+  }
+
+  const std::vector<bool> enable(raw->info().num_col, true);
+  raw->InitColAccess(enable, 1, 1);
+  mapped->InitColAccess(enable, 1, 1);
+  const std::vector<xgboost::bst_uint> sub_feats = {4, 0, 3};
+  for (bool all : {true, false}) {
+    dmlc::DataIter<xgboost::ColBatch>* raw_iter =
+      all ? raw->ColIterator() : raw->ColIterator(sub_feats);
+    dmlc::DataIter<xgboost::ColBatch>* mapped_iter =
+      all ? mapped->ColIterator() : mapped->ColIterator(sub_feats);
+    raw_iter->BeforeFirst();
+    mapped_iter->BeforeFirst();
+    while (raw_iter->Next()) {
+      ASSERT_TRUE(mapped_iter->Next());
+      const xgboost::ColBatch& a = raw_iter->Value();
+      const xgboost::ColBatch& b = mapped_iter->Value();
+      ASSERT_EQ(a.size, b.size);
+      for (size_t i = 0; i < a.size; ++i) {
+        EXPECT_EQ(a.col_index[i], b.col_index[i]);
+        ASSERT_EQ(a[i].length, b[i].length);
+        for (size_t j = 0; j < a[i].length; ++j) {
+          EXPECT_EQ(a[i][j].index, b[i][j].index);
+          EXPECT_EQ(a[i][j].fvalue, b[i][j].fvalue);
+        }
+      }
+    }
+    EXPECT_FALSE(mapped_iter->Next());
+  }
+  raw.reset();
+  mapped.reset();
+
+  // Clean up of external memory files
+  for (const std::string& prefix : {raw_cache, mmap_cache}) {
+    std::remove(prefix.c_str());
+    std::remove((prefix + ".col.meta").c_str());
+    std::remove((prefix + ".col.page").c_str());
+    std::remove((prefix + ".row.page").c_str());
+  }
+}
@@ -0,0 +1,143 @@
+// Copyright by Contributors
+#include <xgboost/data.h>
+#include <dmlc/io.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include "../../../src/data/sparse_batch_page.h"
+
+#include "../helpers.h"
+
+namespace {
+
+// raw pages read in two steps: the bytes of a page, then a copy of the segments asked for
+class TwoStepFormat : public xgboost::data::SparsePage::Format {
+ public:
+  struct RawPage : public Encoded {
+    xgboost::data::SparsePage page;
+  };
+  bool Read(xgboost::data::SparsePage* page, dmlc::SeekStream* fi) override {
+    RawPage raw;
+    if (!this->ReadEncoded(&raw, fi)) return false;
+    this->Decode(&raw, page, nullptr);
+    return true;
+  }
+  bool Read(xgboost::data::SparsePage* page, dmlc::SeekStream* fi,
+            const std::vector<xgboost::bst_uint>& sorted_index_set) override {
+    RawPage raw;
+    if (!this->ReadEncoded(&raw, fi)) return false;
+    this->Decode(&raw, page, &sorted_index_set);
+    return true;
+  }
+  void Write(const xgboost::data::SparsePage& page, dmlc::Stream* fo) override {
+    fo->Write(page.offset);
+    fo->Write(page.data);
+  }
+  Encoded* CreateEncoded() override {
+    return new RawPage();
+  }
+  bool ReadEncoded(Encoded* encoded, dmlc::SeekStream* fi) override {
+    RawPage* raw = static_cast<RawPage*>(encoded);
+    if (!fi->Read(&raw->page.offset)) return false;
+    CHECK(fi->Read(&raw->page.data));
+    return true;
+  }
+  void Decode(Encoded* encoded, xgboost::data::SparsePage* page,
+              const std::vector<xgboost::bst_uint>* sorted_index_set) override {
+    const xgboost::data::SparsePage& in = static_cast<RawPage*>(encoded)->page;
+    page->Clear();
+    for (size_t i = 0; i < in.Size(); ++i) {
+      if (sorted_index_set != nullptr &&
+          !std::binary_search(sorted_index_set->begin(), sorted_index_set->end(), i)) {
+        continue;
+      }
+      page->Push(xgboost::SparseBatch::Inst(dmlc::BeginPtr(in.data) + in.offset[i],
+                                            in.offset[i + 1] - in.offset[i]));
+    }
+  }
+};
+
+// page p has p + 3 segments, segment i holding i entries
+std::vector<xgboost::data::SparsePage> MakePages(size_t npage) {
+  std::vector<xgboost::data::SparsePage> pages(npage);
+  for (size_t p = 0; p < npage; ++p) {
+    for (size_t i = 0; i < p + 3; ++i) {
+      std::vector<xgboost::SparseBatch::Entry> entries;
+      for (size_t j = 0; j < i; ++j) {
+        entries.emplace_back(static_cast<xgboost::bst_uint>(p * 100 + j),
+                             static_cast<xgboost::bst_float>(i));
+      }
+      pages[p].Push(xgboost::SparseBatch::Inst(entries.data(), entries.size()));
+    }
+  }
+  return pages;
+}
+
+void ExpectSamePage(const xgboost::data::SparsePage& got,
+                    const xgboost::data::SparsePage& want,
+                    const std::vector<xgboost::bst_uint>* index_set) {
+  std::vector<xgboost::bst_uint> all;
+  for (size_t i = 0; i < want.Size(); ++i) all.push_back(i);
+  if (index_set == nullptr) index_set = &all;
+  size_t k = 0;
+  for (xgboost::bst_uint i : *index_set) {
+    if (i >= want.Size()) continue;
+    ASSERT_LT(k, got.Size());
+    ASSERT_EQ(got.offset[k + 1] - got.offset[k], want.offset[i + 1] - want.offset[i]);
+    for (size_t j = 0; j < want.offset[i + 1] - want.offset[i]; ++j) {
+      EXPECT_EQ(got.data[got.offset[k] + j].index, want.data[want.offset[i] + j].index);
+      EXPECT_EQ(got.data[got.offset[k] + j].fvalue, want.data[want.offset[i] + j].fvalue);
+    }
+    ++k;
+  }
+  EXPECT_EQ(k, got.Size());
+}
+}  // namespace
+
+TEST(SparsePageReader, ReadThenDecode) {
+  const size_t kPages = 7;
+  const std::vector<xgboost::data::SparsePage> pages = MakePages(kPages);
+  const std::string tmp_file = TempFileName();
+  TwoStepFormat fmt;
+  {
+    std::unique_ptr<dmlc::Stream> fo(dmlc::Stream::Create(tmp_file.c_str(), "w"));
+    for (const xgboost::data::SparsePage& page : pages) fmt.Write(page, fo.get());
+  }
+  std::unique_ptr<dmlc::SeekStream> fi(dmlc::SeekStream::CreateForRead(tmp_file.c_str()));
+  const std::vector<xgboost::bst_uint> index_set = {1, 4, 6};
+  {
+    xgboost::data::SparsePage::Reader reader(fi.get(), &fmt, 2, true);
+    for (int pass = 0; pass < 4; ++pass) {
+      const bool load_all = pass % 2 == 0;
+      if (pass != 0) reader.BeforeFirst(index_set, load_all);
+      xgboost::data::SparsePage* page = nullptr;
+      size_t npage = 0;
+      while (reader.Next(&page)) {
+        ASSERT_LT(npage, kPages);
+        ExpectSamePage(*page, pages[npage], load_all ? nullptr : &index_set);
+        reader.Recycle(&page);
+        ++npage;
+      }
+      EXPECT_EQ(npage, kPages);
+    }
+  }
+  {
+    // no segment is loaded until BeforeFirst chooses them
+    fi->Seek(0);
+    xgboost::data::SparsePage::Reader reader(fi.get(), &fmt, 2, false);
+    const std::vector<xgboost::bst_uint> empty;
+    for (int pass = 0; pass < 2; ++pass) {
+      if (pass != 0) reader.BeforeFirst(index_set, false);
+      xgboost::data::SparsePage* page = nullptr;
+      size_t npage = 0;
+      while (reader.Next(&page)) {
+        ASSERT_LT(npage, kPages);
+        ExpectSamePage(*page, pages[npage], pass == 0 ? &empty : &index_set);
+        reader.Recycle(&page);
+        ++npage;
+      }
+      EXPECT_EQ(npage, kPages);
+    }
+  }
+  std::remove(tmp_file.c_str());
+}
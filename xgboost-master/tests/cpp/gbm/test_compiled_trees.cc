@@ -0,0 +1,106 @@
+// Copyright by Contributors
+#include <xgboost/tree_model.h>
+#include <memory>
+#include <random>
+#include "../../../src/gbm/compiled_trees.h"
+
+#include "../helpers.h"
+
+TEST(CompiledTrees, SameLeavesAsRegTree) {
+  const int kNumFeature = 10;
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+  std::vector<std::unique_ptr<xgboost::RegTree> > trees;
+  xgboost::gbm::CompiledTrees compiled;
+  for (int round = 0; round < 2; ++round) {
+    for (int i = 0; i < 20; ++i) {
+      trees.push_back(RandomTree(6, kNumFeature, &rng));
+    }
+    // trees added since the last sync are appended
+    compiled.Sync(trees);
+    ASSERT_EQ(compiled.Size(), trees.size());
+
+    xgboost::RegTree::FVec feats;
+    feats.Init(kNumFeature);
+    for (int row = 0; row < 100; ++row) {
+      std::vector<xgboost::SparseBatch::Entry> entries;
+      for (int fid = 0; fid < kNumFeature; ++fid) {
+        if (dist(rng) < 0.7f) entries.emplace_back(fid, dist(rng));
+      }
+      xgboost::SparseBatch::Inst inst(entries.data(), entries.size());
+      feats.Fill(inst);
+      for (size_t i = 0; i < trees.size(); ++i) {
+        const int nid = trees[i]->GetLeafIndex(feats, 0);
+        const xgboost::gbm::CompiledTrees::Node& leaf = compiled.GetLeaf(i, feats, 0);
+        ASSERT_TRUE(leaf.is_leaf());
+        ASSERT_EQ(static_cast<int>(leaf.sindex), nid);
+        ASSERT_EQ(leaf.value, (*trees[i])[nid].leaf_value());
+      }
+      feats.Drop(inst);
+    }
+  }
+  // removed trees are only dropped by Clear()
+  trees.resize(5);
+  EXPECT_ANY_THROW(compiled.Sync(trees));
+  compiled.Clear();
+  compiled.Sync(trees);
+  ASSERT_EQ(compiled.Size(), 5U);
+}
+
+TEST(CompiledTrees, PredictBlock) {
+  const int kNumFeature = 10;
+  const int kNumGroup = 2;
+  const size_t kNumRow = 100;
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+  std::vector<std::unique_ptr<xgboost::RegTree> > trees;
+  std::vector<int> tree_group;
+  for (int i = 0; i < 20; ++i) {
+    trees.push_back(RandomTree(6, kNumFeature, &rng));
+    tree_group.push_back(i % kNumGroup);
+  }
+  xgboost::gbm::CompiledTrees compiled;
+  compiled.Sync(trees);
+
+  std::vector<size_t> row_ptr(1, 0);
+  std::vector<xgboost::SparseBatch::Entry> entries;
+  for (size_t i = 0; i < kNumRow; ++i) {
+    for (int fid = 0; fid < kNumFeature; ++fid) {
+      if (dist(rng) < 0.7f) entries.emplace_back(fid, dist(rng));
+    }
+    row_ptr.push_back(entries.size());
+  }
+  xgboost::RowBatch batch;
+  batch.size = kNumRow;
+  batch.base_rowid = 0;
+  batch.ind_ptr = row_ptr.data();
+  batch.data_ptr = entries.data();
+
+  const size_t kBlock = 16;
+  xgboost::gbm::CompiledTrees::FeatureTile tile;
+  tile.Init(kBlock, kNumFeature);
+  xgboost::RegTree::FVec feats;
+  feats.Init(kNumFeature);
+  for (size_t begin = 0; begin < kNumRow; begin += kBlock) {
+    const size_t end = std::min(begin + kBlock, kNumRow);
+    std::vector<unsigned> root_index(end - begin, 0);
+    std::vector<xgboost::bst_float> psum((end - begin) * kNumGroup, 0.0f);
+    tile.Fill(batch, begin, end);
+    compiled.PredictBlock(tile, end - begin, 0, trees.size(), tree_group, 0, kNumGroup,
+                          root_index.data(), psum.data());
+    tile.Drop(batch, begin, end);
+    for (size_t i = begin; i < end; ++i) {
+      // leaf values must add up in the same order as in a row by row traversal
+      feats.Fill(batch[i]);
+      for (int gid = 0; gid < kNumGroup; ++gid) {
+        xgboost::bst_float expected = 0.0f;
+        for (size_t j = 0; j < trees.size(); ++j) {
+          if (tree_group[j] != gid) continue;
+          expected += (*trees[j])[trees[j]->GetLeafIndex(feats, 0)].leaf_value();
+        }
+        ASSERT_EQ(psum[(i - begin) * kNumGroup + gid], expected);
+      }
+      feats.Drop(batch[i]);
+    }
+  }
+}
@@ -0,0 +1,76 @@
+// Copyright by Contributors
+#include <xgboost/c_api.h>
+#include <xgboost/gbm.h>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../../../src/data/dense_dmatrix.h"
+
+#include "../helpers.h"
+
+namespace {
+
+std::shared_ptr<xgboost::DMatrix> TakeDMatrix(DMatrixHandle handle) {
+  std::shared_ptr<xgboost::DMatrix> dmat = *static_cast<std::shared_ptr<xgboost::DMatrix>*>(handle);
+  XGDMatrixFree(handle);
+  return dmat;
+}
+
+}  // namespace
+
+TEST(GBTree, DensePredictionSameAsCSR) {
+  const size_t kRows = 300, kCols = 8;
+  const float kMissing = std::numeric_limits<float>::quiet_NaN();
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+  // a fifth of the cells missing, few enough to be kept dense
+  std::vector<xgboost::bst_float> data(kRows * kCols);
+  for (xgboost::bst_float& v : data) {
+    v = dist(rng) < 0.2f ? kMissing : dist(rng);
+  }
+  std::vector<size_t> indptr(1, 0);
+  std::vector<unsigned> indices;
+  for (size_t i = 0; i < kRows; ++i) {
+    for (size_t j = 0; j < kCols; ++j) indices.push_back(static_cast<unsigned>(j));
+    indptr.push_back(indices.size());
+  }
+
+  DMatrixHandle handle;
+  ASSERT_EQ(XGDMatrixCreateFromMat(data.data(), kRows, kCols, kMissing, &handle), 0);
+  std::shared_ptr<xgboost::DMatrix> dense = TakeDMatrix(handle);
+  ASSERT_NE(dynamic_cast<xgboost::data::DenseDMatrix*>(dense.get()), nullptr);
+  // NaN cells are skipped when the CSR matrix is built
+  ASSERT_EQ(XGDMatrixCreateFromCSREx(indptr.data(), indices.data(), data.data(),
+                                     indptr.size(), data.size(), kCols, &handle), 0);
+  std::shared_ptr<xgboost::DMatrix> csr = TakeDMatrix(handle);
+  ASSERT_EQ(dynamic_cast<xgboost::data::DenseDMatrix*>(csr.get()), nullptr);
+  ASSERT_EQ(csr->info().num_nonzero, dense->info().num_nonzero);
+
+  std::unique_ptr<xgboost::GradientBooster> gbm(
+      xgboost::GradientBooster::Create("gbtree", {}, 0.5f));
+  gbm->Configure(std::vector<std::pair<std::string, std::string> >{
+    {"updater", "grow_colmaker"}, {"num_feature", std::to_string(kCols)},
+    {"max_depth", "5"}, {"min_child_weight", "0"}});
+  csr->InitColAccess(std::vector<bool>(kCols, true), 1.0f, kRows);
+  for (int iter = 0; iter < 4; ++iter) {
+    std::vector<xgboost::bst_gpair> gpair;
+    for (size_t i = 0; i < kRows; ++i) {
+      gpair.emplace_back(2.0f * dist(rng) - 1.0f, dist(rng) + 0.1f);
+    }
+    gbm->DoBoost(csr.get(), &gpair, nullptr);
+  }
+
+  for (unsigned ntree_limit : {0U, 2U}) {
+    std::vector<xgboost::bst_float> dense_preds, csr_preds;
+    gbm->Predict(dense.get(), &dense_preds, ntree_limit);
+    gbm->Predict(csr.get(), &csr_preds, ntree_limit);
+    ASSERT_EQ(dense_preds.size(), kRows);
+    ASSERT_EQ(csr_preds.size(), kRows);
+    for (size_t i = 0; i < kRows; ++i) {
+      EXPECT_EQ(dense_preds[i], csr_preds[i]) << "row " << i;
+    }
+  }
+}
@@ -0,0 +1,97 @@
+// Copyright by Contributors
+#include <xgboost/tree_model.h>
+#include <limits>
+#include <memory>
+#include <random>
+#include "../../../src/gbm/quick_scorer.h"
+
+#include "../helpers.h"
+
+TEST(QuickScorer, SameAsTreeTraversal) {
+  const int kNumFeature = 10;
+  const int kNumGroup = 3;
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+  std::vector<std::unique_ptr<xgboost::RegTree> > trees;
+  std::vector<int> tree_group;
+  for (int i = 0; i < 60; ++i) {
+    trees.push_back(RandomTree(6, kNumFeature, &rng, 8));
+    tree_group.push_back(i % kNumGroup);
+  }
+  xgboost::gbm::QuickScorer scorer;
+  scorer.Sync(trees);
+  ASSERT_TRUE(scorer.Enabled());
+  ASSERT_EQ(scorer.Size(), trees.size());
+
+  xgboost::RegTree::FVec feats;
+  feats.Init(kNumFeature);
+  std::vector<uint64_t> leafidx(scorer.Size());
+  std::vector<xgboost::bst_float> psum(kNumGroup);
+  for (int row = 0; row < 200; ++row) {
+    // missing values, NaN's and values equal to thresholds
+    std::vector<xgboost::SparseBatch::Entry> entries;
+    for (int fid = 0; fid < kNumFeature; ++fid) {
+      const float r = dist(rng);
+      if (r < 0.2f) continue;
+      if (r < 0.25f) {
+        entries.emplace_back(fid, std::numeric_limits<float>::quiet_NaN());
+      } else if (r < 0.5f) {
+        entries.emplace_back(fid, (rng() % 8) / 8.0f);
+      } else {
+        entries.emplace_back(fid, dist(rng));
+      }
+    }
+    xgboost::SparseBatch::Inst inst(entries.data(), entries.size());
+    feats.Fill(inst);
+    for (size_t tree_begin : {0, 9}) {
+      scorer.Predict(feats, tree_begin, trees.size(), tree_group, kNumGroup,
+                     leafidx.data(), psum.data());
+      for (int gid = 0; gid < kNumGroup; ++gid) {
+        xgboost::bst_float expected = 0.0f;
+        for (size_t i = tree_begin; i < trees.size(); ++i) {
+          if (tree_group[i] != gid) continue;
+          expected += (*trees[i])[trees[i]->GetLeafIndex(feats, 0)].leaf_value();
+        }
+        ASSERT_EQ(psum[gid], expected);
+      }
+    }
+    feats.Drop(inst);
+  }
+}
+
+TEST(QuickScorer, DisabledForLargeTrees) {
+  const int kNumFeature = 10;
+  std::mt19937 rng(1);
+  std::vector<std::unique_ptr<xgboost::RegTree> > trees;
+  trees.push_back(RandomTree(6, kNumFeature, &rng, 8));
+  xgboost::gbm::QuickScorer scorer;
+  scorer.Sync(trees);
+  ASSERT_TRUE(scorer.Enabled());
+  // a full tree of depth 7 has 128 leaves
+  std::unique_ptr<xgboost::RegTree> tree(new xgboost::RegTree());
+  tree->param.InitAllowUnknown(std::vector<std::pair<std::string, std::string> >{
+    {"num_feature", std::to_string(kNumFeature)}});
+  tree->InitModel();
+  std::vector<int> level(1, 0);
+  for (int depth = 0; depth < 7; ++depth) {
+    std::vector<int> next;
+    for (int nid : level) {
+      tree->AddChilds(nid);
+      (*tree)[nid].set_split(depth, 0.5f, true);
+      next.push_back((*tree)[nid].cleft());
+      next.push_back((*tree)[nid].cright());
+    }
+    level = next;
+  }
+  trees.push_back(std::move(tree));
+  // the trees changed, so the scorer must be cleared before it is synced again
+  EXPECT_ANY_THROW(scorer.Sync(trees));
+  scorer.Clear();
+  scorer.Sync(trees);
+  ASSERT_FALSE(scorer.Enabled());
+  // removing the tree enables the scorer again
+  trees.pop_back();
+  scorer.Clear();
+  scorer.Sync(trees);
+  ASSERT_TRUE(scorer.Enabled());
+}
@@ -0,0 +1,175 @@
+// Copyright by Contributors
+#include <xgboost/objective.h>
+#include <xgboost/tree_model.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <random>
+#include <thread>
+#include "../../../src/gbm/row_predictor.h"
+
+#include "../helpers.h"
+
+namespace {
+
+struct RandomModel {
+  std::vector<std::unique_ptr<xgboost::RegTree> > trees;
+  std::vector<int> tree_group;
+  std::vector<xgboost::bst_float> tree_weight;
+
+  RandomModel(int num_tree, int num_group, int depth, int num_feature, std::mt19937* rng) {
+    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+    for (int i = 0; i < num_tree; ++i) {
+      trees.push_back(RandomTree(depth, num_feature, rng));
+      tree_group.push_back(i % num_group);
+      tree_weight.push_back(0.5f + dist(*rng));
+    }
+  }
+};
+
+// dense rows, with some values missing either as NaN or as the missing value
+std::vector<xgboost::bst_float> RandomRows(size_t nrow, int num_feature,
+                                           xgboost::bst_float missing, std::mt19937* rng) {
+  std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+  std::vector<xgboost::bst_float> rows(nrow * num_feature);
+  for (size_t i = 0; i < rows.size(); ++i) {
+    const float r = dist(*rng);
+    if (r < 0.1f) {
+      rows[i] = std::numeric_limits<xgboost::bst_float>::quiet_NaN();
+    } else if (r < 0.2f) {
+      rows[i] = missing;
+    } else {
+      rows[i] = dist(*rng);
+    }
+  }
+  return rows;
+}
+
+}  // namespace
+
+TEST(RowPredictor, ConcurrentSameAsTreeTraversal) {
+  const int kNumFeature = 10;
+  const int kNumGroup = 3;
+  const int kNumThread = 8;
+  const size_t kNumRow = 200;
+  const xgboost::bst_float kMissing = -1.0f;
+  const xgboost::bst_float kBaseMargin = 0.5f;
+  std::mt19937 rng(0);
+  RandomModel model(30, kNumGroup, 6, kNumFeature, &rng);
+  xgboost::gbm::RowPredictor predictor;
+  predictor.Init(model.trees, model.tree_group, model.tree_weight,
+                 kNumGroup, kNumFeature, kBaseMargin, nullptr);
+  ASSERT_EQ(predictor.NumOutput(), static_cast<size_t>(kNumGroup));
+  const std::vector<xgboost::bst_float> rows = RandomRows(kNumRow, kNumFeature, kMissing, &rng);
+
+  for (unsigned ntree_limit : {0U, 4U}) {
+    std::vector<xgboost::bst_float> expected(kNumRow * kNumGroup);
+    const size_t tree_end = ntree_limit == 0 ? model.trees.size() : ntree_limit * kNumGroup;
+    xgboost::RegTree::FVec feats;
+    feats.Init(kNumFeature);
+    for (size_t i = 0; i < kNumRow; ++i) {
+      std::vector<xgboost::SparseBatch::Entry> entries;
+      for (int fid = 0; fid < kNumFeature; ++fid) {
+        const xgboost::bst_float v = rows[i * kNumFeature + fid];
+        if (!std::isnan(v) && v != kMissing) entries.emplace_back(fid, v);
+      }
+      xgboost::SparseBatch::Inst inst(entries.data(), entries.size());
+      feats.Fill(inst);
+      for (int gid = 0; gid < kNumGroup; ++gid) {
+        xgboost::bst_float psum = 0.0f;
+        for (size_t j = 0; j < tree_end; ++j) {
+          if (model.tree_group[j] != gid) continue;
+          const int nid = model.trees[j]->GetLeafIndex(feats, 0);
+          psum += model.tree_weight[j] * (*model.trees[j])[nid].leaf_value();
+        }
+        expected[i * kNumGroup + gid] = kBaseMargin + psum;
+      }
+      feats.Drop(inst);
+    }
+
+    // all threads predict all rows at the same time
+    std::atomic<int> num_mismatch(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kNumThread; ++t) {
+      threads.emplace_back([&]() {
+          xgboost::gbm::RowPredictor::Scratch scratch(predictor);
+          std::vector<xgboost::bst_float> out(predictor.NumOutput());
+          for (size_t i = 0; i < kNumRow; ++i) {
+            const size_t len = predictor.Predict(&rows[i * kNumFeature], kNumFeature, kMissing,
+                                                 false, ntree_limit, &scratch, out.data());
+            if (len != static_cast<size_t>(kNumGroup) ||
+                !std::equal(out.begin(), out.end(), expected.begin() + i * kNumGroup)) {
+              ++num_mismatch;
+            }
+          }
+        });
+    }
+    for (std::thread& t : threads) t.join();
+    ASSERT_EQ(num_mismatch.load(), 0);
+  }
+}
+
+TEST(RowPredictor, TransformByObjective) {
+  const int kNumFeature = 10;
+  std::mt19937 rng(1);
+  RandomModel model(10, 1, 4, kNumFeature, &rng);
+  xgboost::ObjFunction* obj = xgboost::ObjFunction::Create("binary:logistic");
+  obj->Configure(std::vector<std::pair<std::string, std::string> >());
+  xgboost::gbm::RowPredictor predictor;
+  predictor.Init(model.trees, model.tree_group, model.tree_weight,
+                 1, kNumFeature, 0.0f, obj);
+  xgboost::gbm::RowPredictor::Scratch scratch(predictor);
+  const std::vector<xgboost::bst_float> rows = RandomRows(10, kNumFeature, 0.0f, &rng);
+  for (size_t i = 0; i < 10; ++i) {
+    std::vector<xgboost::bst_float> margin(1), prob(1);
+    predictor.Predict(&rows[i * kNumFeature], kNumFeature, 0.0f, true, 0, &scratch,
+                      margin.data());
+    predictor.Predict(&rows[i * kNumFeature], kNumFeature, 0.0f, false, 0, &scratch,
+                      prob.data());
+    obj->PredTransform(&margin);
+    ASSERT_EQ(prob[0], margin[0]);
+  }
+}
+
+// Reports per call latency of single row prediction, for serving threads calling into a
+// shared predictor. Run with --gtest_also_run_disabled_tests.
+TEST(RowPredictor, DISABLED_LatencyBenchmark) {
+  const int kNumFeature = 100;
+  const size_t kNumRow = 1000;
+  const size_t kCallPerThread = 5000;
+  std::mt19937 rng(2);
+  RandomModel model(500, 1, 6, kNumFeature, &rng);
+  xgboost::gbm::RowPredictor predictor;
+  predictor.Init(model.trees, model.tree_group, model.tree_weight,
+                 1, kNumFeature, 0.5f, nullptr);
+  const std::vector<xgboost::bst_float> rows = RandomRows(kNumRow, kNumFeature, 0.0f, &rng);
+
+  for (int nthread : {1, 8, 64}) {
+    std::vector<std::vector<double> > latency(nthread);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nthread; ++t) {
+      threads.emplace_back([&, t]() {
+          xgboost::gbm::RowPredictor::Scratch scratch(predictor);
+          xgboost::bst_float out;
+          latency[t].resize(kCallPerThread);
+          for (size_t k = 0; k < kCallPerThread; ++k) {
+            const xgboost::bst_float* row = &rows[((k + t) % kNumRow) * kNumFeature];
+            auto begin = std::chrono::steady_clock::now();
+            predictor.Predict(row, kNumFeature, 0.0f, true, 0, &scratch, &out);
+            auto end = std::chrono::steady_clock::now();
+            latency[t][k] = std::chrono::duration<double, std::micro>(end - begin).count();
+          }
+        });
+    }
+    for (std::thread& t : threads) t.join();
+    std::vector<double> all;
+    for (const std::vector<double>& l : latency) all.insert(all.end(), l.begin(), l.end());
+    std::sort(all.begin(), all.end());
+    std::cout << "RowPredictor " << nthread << " threads: p50 = "
+              << all[all.size() / 2] << " us, p99 = "
+              << all[all.size() * 99 / 100] << " us" << std::endl;
+  }
+}
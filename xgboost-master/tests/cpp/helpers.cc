@@ -1,4 +1,6 @@
+#include <xgboost/tree_updater.h>
 #include "./helpers.h"
+#include "../../src/data/simple_csr_source.h"
 
 std::string TempFileName() {
   return std::tmpnam(nullptr);
@@ -60,3 +62,90 @@ xgboost::bst_float GetMetricEval(xgboost::Metric * metric,
   info.weights = weights;
   return metric->Eval(preds, info, false);
 }
+
+std::unique_ptr<xgboost::DMatrix> CreateRandomDMatrix(int nrow, int ncol) {
+  std::unique_ptr<xgboost::data::SimpleCSRSource> source(new xgboost::data::SimpleCSRSource());
+  for (int i = 0; i < nrow; ++i) {
+    for (int j = 0; j < ncol; ++j) {
+      if ((i * 3 + j * 5) % 7 == 0) continue;
+      const float fvalue = j == 0 ? 1.0f : static_cast<float>((i * 7 + j * 13) % 31) - 9.0f;
+      source->row_data_.emplace_back(static_cast<xgboost::bst_uint>(j), fvalue);
+    }
+    source->row_ptr_.push_back(source->row_data_.size());
+  }
+  source->info.num_row = nrow;
+  source->info.num_col = ncol;
+  source->info.num_nonzero = source->row_data_.size();
+  return std::unique_ptr<xgboost::DMatrix>(xgboost::DMatrix::Create(std::move(source)));
+}
+
+std::vector<xgboost::bst_gpair> CreateExactGradient(int nrow) {
+  std::vector<xgboost::bst_gpair> gpair;
+  for (int i = 0; i < nrow; ++i) {
+    gpair.emplace_back(((i * 5) % 17 - 8) / 8.0f, ((i * 3) % 8 + 1) / 8.0f);
+  }
+  return gpair;
+}
+
+std::unique_ptr<xgboost::RegTree> GrowTreeWithUpdater(
+    const std::string& name, const std::vector<std::pair<std::string, std::string> >& args,
+    xgboost::DMatrix* dmat, const std::vector<xgboost::bst_gpair>& gpair) {
+  std::unique_ptr<xgboost::RegTree> tree(new xgboost::RegTree());
+  tree->param.InitAllowUnknown(std::vector<std::pair<std::string, std::string> >{
+    {"num_feature", std::to_string(dmat->info().num_col)}});
+  tree->InitModel();
+
+  std::unique_ptr<xgboost::TreeUpdater> updater(xgboost::TreeUpdater::Create(name));
+  updater->Init(args);
+  updater->Update(gpair, dmat, std::vector<xgboost::RegTree*>{tree.get()});
+  return tree;
+}
+
+void ExpectSameTree(const xgboost::RegTree& a_tree, const xgboost::RegTree& b_tree,
+                    double leaf_eps) {
+  ASSERT_EQ(a_tree.param.num_nodes, b_tree.param.num_nodes);
+  for (int nid = 0; nid < a_tree.param.num_nodes; ++nid) {
+    const xgboost::RegTree::Node& a = a_tree[nid];
+    const xgboost::RegTree::Node& b = b_tree[nid];
+    ASSERT_EQ(a.is_deleted(), b.is_deleted()) << "node " << nid;
+    if (a.is_deleted()) continue;
+    ASSERT_EQ(a.is_leaf(), b.is_leaf()) << "node " << nid;
+    if (a.is_leaf()) {
+      EXPECT_NEAR(a.leaf_value(), b.leaf_value(), leaf_eps) << "node " << nid;
+    } else {
+      EXPECT_EQ(a.split_index(), b.split_index()) << "node " << nid;
+      EXPECT_EQ(a.split_cond(), b.split_cond()) << "node " << nid;
+      EXPECT_EQ(a.default_left(), b.default_left()) << "node " << nid;
+    }
+  }
+}
+
+namespace {
+
+void GrowRandomTree(xgboost::RegTree* tree, int nid, int depth, int num_feature,
+                    int num_split_value, std::mt19937* rng) {
+  std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+  if (depth == 0 || dist(*rng) < 0.2f) {
+    (*tree)[nid].set_leaf(dist(*rng) - 0.5f);
+    return;
+  }
+  tree->AddChilds(nid);
+  const unsigned split_index = (*rng)() % num_feature;
+  const float split_value = num_split_value == 0 ? dist(*rng) :
+      static_cast<float>((*rng)() % num_split_value) / num_split_value;
+  (*tree)[nid].set_split(split_index, split_value, (*rng)() % 2 == 0);
+  GrowRandomTree(tree, (*tree)[nid].cleft(), depth - 1, num_feature, num_split_value, rng);
+  GrowRandomTree(tree, (*tree)[nid].cright(), depth - 1, num_feature, num_split_value, rng);
+}
+
+}  // namespace
+
+std::unique_ptr<xgboost::RegTree> RandomTree(int depth, int num_feature, std::mt19937* rng,
+                                             int num_split_value) {
+  std::unique_ptr<xgboost::RegTree> tree(new xgboost::RegTree());
+  tree->param.InitAllowUnknown(std::vector<std::pair<std::string, std::string> >{
+    {"num_feature", std::to_string(num_feature)}});
+  tree->InitModel();
+  GrowRandomTree(tree.get(), 0, depth, num_feature, num_split_value, rng);
+  return tree;
+}
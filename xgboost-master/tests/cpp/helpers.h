@@ -4,7 +4,10 @@
 #include <iostream>
 #include <fstream>
 #include <cstdio>
+#include <memory>
+#include <random>
 #include <string>
+#include <utility>
 #include <vector>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -12,8 +15,10 @@
 #include <gtest/gtest.h>
 
 #include <xgboost/base.h>
+#include <xgboost/data.h>
 #include <xgboost/objective.h>
 #include <xgboost/metric.h>
+#include <xgboost/tree_model.h>
 
 std::string TempFileName();
 
@@ -36,4 +41,27 @@ xgboost::bst_float GetMetricEval(
   std::vector<xgboost::bst_float> labels,
   std::vector<xgboost::bst_float> weights = std::vector<xgboost::bst_float> ());
 
+// in-memory matrix of the given shape with missing cells, a constant first column and
+// repeated values, made of a fixed pseudo-random sequence
+std::unique_ptr<xgboost::DMatrix> CreateRandomDMatrix(int nrow, int ncol);
+
+// gradient pairs that are multiples of 1/8, so that their sums are exact in float and
+// double and do not depend on the order of the additions
+std::vector<xgboost::bst_gpair> CreateExactGradient(int nrow);
+
+// grow a single tree of dmat->info().num_col features with a new updater of the given name
+std::unique_ptr<xgboost::RegTree> GrowTreeWithUpdater(
+    const std::string& name, const std::vector<std::pair<std::string, std::string> >& args,
+    xgboost::DMatrix* dmat, const std::vector<xgboost::bst_gpair>& gpair);
+
+// check that two trees have the same structure and splits, and leaf values within leaf_eps
+void ExpectSameTree(const xgboost::RegTree& a_tree, const xgboost::RegTree& b_tree,
+                    double leaf_eps = 0.0);
+
+// a tree of at most the given depth with random splits and leaf values in [-0.5, 0.5);
+// with num_split_value > 0, the split values are multiples of 1 / num_split_value
+// in [0, 1), so that the splits of different trees share them
+std::unique_ptr<xgboost::RegTree> RandomTree(int depth, int num_feature, std::mt19937* rng,
+                                             int num_split_value = 0);
+
 #endif
@@ -0,0 +1,97 @@
+// Copyright by Contributors
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+#include "../../../plugin/lz4/compress_array.h"
+#include "../../../src/common/io.h"
+
+#include "../helpers.h"
+
+namespace {
+
+std::vector<xgboost::bst_uint> EncodeDecode(const std::vector<xgboost::bst_uint>& data,
+                                            std::string* encoded) {
+  xgboost::data::DeltaBitPackCodec::Encode(data.data(), data.size(), false, encoded);
+  std::vector<xgboost::bst_uint> decoded(data.size());
+  xgboost::data::DeltaBitPackCodec::Decode(encoded->data(), encoded->size(),
+                                           decoded.data(), decoded.size());
+  return decoded;
+}
+
+}  // namespace
+
+TEST(DeltaBitPackCodec, ZeroWidth) {
+  // a single index repeated, every block is stored as its width only
+  const std::vector<xgboost::bst_uint> data(2 * 128, 0);
+  std::string encoded;
+  EXPECT_EQ(EncodeDecode(data, &encoded), data);
+  ASSERT_EQ(encoded.size(), 2U);
+  EXPECT_EQ(encoded[0], 0);
+  EXPECT_EQ(encoded[1], 0);
+}
+
+TEST(DeltaBitPackCodec, FullWidth) {
+  // the difference between 0 and 2^31 takes all the 32 bits once zig-zag coded
+  std::vector<xgboost::bst_uint> data;
+  for (int i = 0; i < 128; ++i) {
+    data.push_back(i % 2 == 0 ? 0U : 0x80000000U);
+  }
+  data.push_back(0xffffffffU);
+  std::string encoded;
+  EXPECT_EQ(EncodeDecode(data, &encoded), data);
+  EXPECT_EQ(static_cast<unsigned char>(encoded[0]), 32U);
+}
+
+TEST(DeltaBitPackCodec, PartialBlock) {
+  // indices ascending within rows, the last block holds 5 values
+  std::vector<xgboost::bst_uint> data;
+  for (int i = 0; i < 2 * 128 + 5; ++i) {
+    data.push_back(static_cast<xgboost::bst_uint>(i % 17 * 3));
+  }
+  std::string encoded;
+  EXPECT_EQ(EncodeDecode(data, &encoded), data);
+  std::vector<xgboost::bst_uint> single(1, 12345);
+  EXPECT_EQ(EncodeDecode(single, &encoded), single);
+  std::vector<xgboost::bst_uint> empty;
+  EXPECT_EQ(EncodeDecode(empty, &encoded), empty);
+  EXPECT_EQ(encoded.size(), 0U);
+}
+
+TEST(DeltaBitPackCodec, EqualAndNotMonotone) {
+  // row indices of a column sorted by value: repeats, ascents and descents
+  std::mt19937 rng(0);
+  std::vector<xgboost::bst_uint> data;
+  for (int i = 0; i < 1000; ++i) {
+    data.push_back(rng() % 4 == 0 && !data.empty() ? data.back() : rng() % 100000);
+  }
+  std::string encoded;
+  EXPECT_EQ(EncodeDecode(data, &encoded), data);
+}
+
+TEST(CompressArray, SeveralChunks) {
+  std::mt19937 rng(1);
+  xgboost::data::CompressArray<xgboost::bst_uint, xgboost::data::DeltaBitPackCodec> out;
+  for (int i = 0; i < 10000; ++i) {
+    out.data.push_back(rng() % 3 == 0 ? rng() % 1000 : static_cast<xgboost::bst_uint>(i));
+  }
+  // chunks of 1000 entries, the last one holds the remainder
+  out.InitCompressChunks(1000, 128);
+  ASSERT_EQ(out.num_chunk(), 10);
+  for (int i = 0; i < out.num_chunk(); ++i) {
+    out.Compress(i, false);
+  }
+  std::string buffer;
+  xgboost::common::MemoryBufferStream fo(&buffer);
+  out.Write(&fo);
+
+  xgboost::common::MemoryBufferStream fi(&buffer);
+  xgboost::data::CompressArray<xgboost::bst_uint, xgboost::data::DeltaBitPackCodec> in;
+  in.Read(&fi);
+  ASSERT_EQ(in.num_chunk(), out.num_chunk());
+  // chunks are independent, decode them out of order
+  for (int i = in.num_chunk() - 1; i >= 0; --i) {
+    in.Decompress(i);
+  }
+  EXPECT_EQ(in.data, out.data);
+}
@@ -0,0 +1,44 @@
+// Copyright by Contributors
+#include <xgboost/data.h>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../helpers.h"
+
+namespace {
+
+std::unique_ptr<xgboost::RegTree> GrowTree(
+    xgboost::DMatrix* dmat, const std::vector<xgboost::bst_gpair>& gpair,
+    const std::string& col_partition, const std::string& parallel_option) {
+  return GrowTreeWithUpdater("grow_colmaker", {
+    {"max_depth", "5"}, {"min_child_weight", "0"},
+    {"col_partition", col_partition}, {"parallel_option", parallel_option}}, dmat, gpair);
+}
+
+}  // namespace
+
+TEST(ColMaker, ColumnPartition) {
+  const int nrow = 300, ncol = 6;
+  const std::vector<bool> enabled(ncol, true);
+  std::vector<xgboost::bst_gpair> gpair = CreateExactGradient(nrow);
+  std::unique_ptr<xgboost::DMatrix> dmat = CreateRandomDMatrix(nrow, ncol);
+  dmat->InitColAccess(enabled, 1.0f, nrow);
+  ASSERT_TRUE(dmat->SingleColBlock());
+  // the cached columns of several column pages are merged
+  std::unique_ptr<xgboost::DMatrix> dmat_paged = CreateRandomDMatrix(nrow, ncol);
+  dmat_paged->InitColAccess(enabled, 1.0f, 64);
+  ASSERT_FALSE(dmat_paged->SingleColBlock());
+
+  for (const std::string parallel_option : {"0", "1"}) {
+    std::unique_ptr<xgboost::RegTree> expected =
+        GrowTree(dmat.get(), gpair, "0", parallel_option);
+    ASSERT_GT(expected->param.num_nodes, 1);
+    for (xgboost::DMatrix* p_fmat : {dmat.get(), dmat_paged.get()}) {
+      std::unique_ptr<xgboost::RegTree> tree =
+          GrowTree(p_fmat, gpair, "1", parallel_option);
+      ExpectSameTree(*tree, *expected);
+    }
+  }
+}
@@ -0,0 +1,122 @@
+// Copyright by Contributors
+#include <xgboost/tree_updater.h>
+#include <dmlc/omp.h>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../helpers.h"
+
+namespace {
+
+std::unique_ptr<xgboost::RegTree> GrowTree(
+    xgboost::DMatrix* dmat, const std::vector<xgboost::bst_gpair>& gpair,
+    const std::string& hist_precision, const std::string& min_child_weight = "0") {
+  return GrowTreeWithUpdater("grow_fast_histmaker", {
+    {"max_depth", "4"}, {"min_child_weight", min_child_weight}, {"max_bin", "16"},
+    {"hist_precision", hist_precision}}, dmat, gpair);
+}
+
+// gradients spanning several orders of magnitude, whose sums are rounded in float
+std::vector<xgboost::bst_gpair> CreateRandomGradient(int nrow, std::mt19937* rng) {
+  std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+  std::vector<xgboost::bst_gpair> gpair;
+  for (int i = 0; i < nrow; ++i) {
+    const float scale = std::pow(10.0f, 4.0f * dist(*rng) - 3.0f);
+    gpair.emplace_back((2.0f * dist(*rng) - 1.0f) * scale, (dist(*rng) + 0.01f) * scale);
+  }
+  return gpair;
+}
+
+void ExpectNearRelative(double a, double b, double rel_eps, int nid) {
+  EXPECT_NEAR(a, b, rel_eps * std::max(std::fabs(a), std::fabs(b))) << "node " << nid;
+}
+
+}  // namespace
+
+TEST(FastHistMaker, FloatHistPrecision) {
+  const int nrow = 200, ncol = 5;
+  std::unique_ptr<xgboost::DMatrix> dmat = CreateRandomDMatrix(nrow, ncol);
+  std::mt19937 rng(3);
+  std::vector<xgboost::bst_gpair> gpair = CreateRandomGradient(nrow, &rng);
+
+  // without min_child_weight, the rounding of float sums may leave a gain above rt_eps to
+  // splits sending no row to a side
+  std::unique_ptr<xgboost::RegTree> tree_double = GrowTree(dmat.get(), gpair, "double", "1");
+  ASSERT_GT(tree_double->param.num_nodes, 7);
+  std::unique_ptr<xgboost::RegTree> tree_float = GrowTree(dmat.get(), gpair, "float", "1");
+  // the same splits, with statistics summed in float
+  ASSERT_EQ(tree_double->param.num_nodes, tree_float->param.num_nodes);
+  for (int nid = 0; nid < tree_double->param.num_nodes; ++nid) {
+    const xgboost::RegTree::Node& a = (*tree_double)[nid];
+    const xgboost::RegTree::Node& b = (*tree_float)[nid];
+    ASSERT_EQ(a.is_leaf(), b.is_leaf()) << "node " << nid;
+    if (a.is_leaf()) {
+      ExpectNearRelative(a.leaf_value(), b.leaf_value(), 1e-5, nid);
+    } else {
+      EXPECT_EQ(a.split_index(), b.split_index()) << "node " << nid;
+      EXPECT_EQ(a.split_cond(), b.split_cond()) << "node " << nid;
+      EXPECT_EQ(a.default_left(), b.default_left()) << "node " << nid;
+      ExpectNearRelative(tree_double->stat(nid).loss_chg, tree_float->stat(nid).loss_chg,
+                         1e-5, nid);
+    }
+  }
+}
+
+TEST(FastHistMaker, SameForAnyNumberOfThreads) {
+  // enough features for the split evaluation of a node to be cut into several tasks
+  const int nrow = 300, ncol = 50;
+  std::unique_ptr<xgboost::DMatrix> dmat = CreateRandomDMatrix(nrow, ncol);
+  std::vector<xgboost::bst_gpair> gpair = CreateExactGradient(nrow);
+
+  const int nthread = omp_get_max_threads();
+  omp_set_num_threads(1);
+  std::unique_ptr<xgboost::RegTree> tree_serial = GrowTree(dmat.get(), gpair, "double");
+  omp_set_num_threads(4);
+  std::unique_ptr<xgboost::RegTree> tree_parallel = GrowTree(dmat.get(), gpair, "double");
+  omp_set_num_threads(nthread);
+  ASSERT_GT(tree_serial->param.num_nodes, 1);
+  ExpectSameTree(*tree_serial, *tree_parallel);
+}
+
+TEST(FastHistMaker, PredictionCacheAfterPrecisionSwitch) {
+  const int nrow = 200, ncol = 5;
+  std::unique_ptr<xgboost::DMatrix> dmat = CreateRandomDMatrix(nrow, ncol);
+  std::vector<xgboost::bst_gpair> gpair = CreateExactGradient(nrow);
+
+  std::unique_ptr<xgboost::TreeUpdater> updater(
+    xgboost::TreeUpdater::Create("grow_fast_histmaker"));
+  std::vector<std::unique_ptr<xgboost::RegTree> > trees;
+  // the second tree is grown from the opposite gradient, with the other precision
+  for (const std::string hist_precision : {"float", "double"}) {
+    trees.emplace_back(new xgboost::RegTree());
+    trees.back()->param.InitAllowUnknown(std::vector<std::pair<std::string, std::string> >{
+      {"num_feature", std::to_string(ncol)}});
+    trees.back()->InitModel();
+    updater->Init(std::vector<std::pair<std::string, std::string> >{
+      {"max_depth", "4"}, {"min_child_weight", "0"}, {"max_bin", "16"},
+      {"hist_precision", hist_precision}});
+    updater->Update(gpair, dmat.get(), std::vector<xgboost::RegTree*>{trees.back().get()});
+    for (auto& g : gpair) g = xgboost::bst_gpair(-g.grad, g.hess);
+  }
+
+  std::vector<xgboost::bst_float> preds(nrow, 0.0f);
+  ASSERT_TRUE(updater->UpdatePredictionCache(dmat.get(), &preds));
+  xgboost::RegTree::FVec feats;
+  feats.Init(ncol);
+  dmlc::DataIter<xgboost::RowBatch>* iter = dmat->RowIterator();
+  iter->BeforeFirst();
+  while (iter->Next()) {
+    const xgboost::RowBatch& batch = iter->Value();
+    for (size_t i = 0; i < batch.size; ++i) {
+      feats.Fill(batch[i]);
+      const size_t ridx = batch.base_rowid + i;
+      EXPECT_EQ(preds[ridx], trees.back()->Predict(feats)) << "row " << ridx;
+      feats.Drop(batch[i]);
+    }
+  }
+}
@@ -0,0 +1,45 @@
+// Copyright by Contributors
+#include <xgboost/data.h>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../../../src/common/random.h"
+
+#include "../helpers.h"
+
+namespace {
+
+std::unique_ptr<xgboost::RegTree> GrowTree(
+    xgboost::DMatrix* dmat, const std::vector<xgboost::bst_gpair>& gpair,
+    const std::string& col_bin_cache, const std::string& subsample) {
+  // row and column sampling draw the same numbers in both modes
+  xgboost::common::GlobalRandom().seed(7);
+  return GrowTreeWithUpdater("grow_histmaker", {
+    {"max_depth", "5"}, {"min_child_weight", "0"}, {"colsample_bytree", "0.8"},
+    {"subsample", subsample}, {"col_bin_cache", col_bin_cache}}, dmat, gpair);
+}
+
+}  // namespace
+
+TEST(HistMaker, BinnedColumns) {
+  const int nrow = 300, ncol = 6;
+  const std::vector<bool> enabled(ncol, true);
+  std::vector<xgboost::bst_gpair> gpair = CreateExactGradient(nrow);
+  std::unique_ptr<xgboost::DMatrix> dmat = CreateRandomDMatrix(nrow, ncol);
+  dmat->InitColAccess(enabled, 1.0f, nrow);
+  ASSERT_TRUE(dmat->SingleColBlock());
+  // paged columns are read at every level, with or without col_bin_cache
+  std::unique_ptr<xgboost::DMatrix> dmat_paged = CreateRandomDMatrix(nrow, ncol);
+  dmat_paged->InitColAccess(enabled, 1.0f, 64);
+  ASSERT_FALSE(dmat_paged->SingleColBlock());
+
+  for (const std::string subsample : {"1", "0.7"}) {
+    for (xgboost::DMatrix* p_fmat : {dmat.get(), dmat_paged.get()}) {
+      std::unique_ptr<xgboost::RegTree> expected = GrowTree(p_fmat, gpair, "0", subsample);
+      ASSERT_GT(expected->param.num_nodes, 7);
+      std::unique_ptr<xgboost::RegTree> tree = GrowTree(p_fmat, gpair, "1", subsample);
+      ExpectSameTree(*tree, *expected);
+    }
+  }
+}
@@ -0,0 +1,33 @@
+// Copyright by Contributors
+#include <vector>
+#include "../../../src/tree/param.h"
+#include "../../../src/tree/sparse_hist_reducer.h"
+
+#include "../helpers.h"
+
+TEST(SparseHistReducer, SendsNonEmptyBins) {
+  // a dense node, a sparse node and an empty node
+  const std::vector<size_t> node_ptr = {0, 10, 30, 35};
+  std::vector<xgboost::tree::GradStats> hist(node_ptr.back());
+  for (auto& s : hist) s.Clear();
+  for (size_t i = 0; i < 8; ++i) {
+    hist[i].Add(0.5 * i - 1.0, 0.25 * i);
+  }
+  hist[12].Add(-1.5, 2.0);
+  hist[17].Add(3.0, 1.0);
+  // a bin of rows with zero hessian still counts as non-empty
+  hist[29].Add(0.75, 0.0);
+  const std::vector<xgboost::tree::GradStats> expected = hist;
+
+  xgboost::tree::SparseHistReducer<xgboost::tree::GradStats> reducer;
+  reducer.Allreduce(hist.data(), node_ptr, 0.5f);
+  // with a single worker, the histograms are unchanged
+  EXPECT_EQ(reducer.NumSent(), 10U + 3U);
+  for (size_t i = 0; i < hist.size(); ++i) {
+    EXPECT_EQ(hist[i].sum_grad, expected[i].sum_grad) << "bin " << i;
+    EXPECT_EQ(hist[i].sum_hess, expected[i].sum_hess) << "bin " << i;
+  }
+  // every non-empty node sent in full
+  reducer.Allreduce(hist.data(), node_ptr, 0.1f);
+  EXPECT_EQ(reducer.NumSent(), 10U + 20U);
+}
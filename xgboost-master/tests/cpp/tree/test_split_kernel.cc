@@ -0,0 +1,87 @@
+// Copyright by Contributors
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../../../src/tree/split_kernel.h"
+
+#include "../helpers.h"
+
+namespace {
+
+// scalar enumeration over the bins, as in FastHistMaker
+void EnumerateSplitScalar(int d_step, const xgboost::tree::TrainParam& param,
+                          const std::vector<xgboost::common::GHistEntry<double> >& hist,
+                          const std::vector<xgboost::bst_float>& cut,
+                          xgboost::bst_float min_val,
+                          const xgboost::tree::GradStats& total,
+                          xgboost::bst_float root_gain, xgboost::bst_uint fid,
+                          xgboost::tree::SplitEntry* p_best) {
+  xgboost::tree::NoConstraint constraint;
+  xgboost::tree::GradStats c(param), e(param);
+  xgboost::tree::SplitEntry best;
+  const int nbin = static_cast<int>(hist.size());
+  const int ibegin = d_step > 0 ? 0 : nbin - 1;
+  const int iend = d_step > 0 ? nbin : -1;
+  for (int i = ibegin; i != iend; i += d_step) {
+    e.Add(hist[i].sum_grad, hist[i].sum_hess);
+    if (e.sum_hess >= param.min_child_weight) {
+      c.SetSubstract(total, e);
+      if (c.sum_hess >= param.min_child_weight) {
+        if (d_step > 0) {
+          best.Update(static_cast<xgboost::bst_float>(
+              constraint.CalcSplitGain(param, fid, e, c) - root_gain), fid, cut[i], false);
+        } else {
+          best.Update(static_cast<xgboost::bst_float>(
+              constraint.CalcSplitGain(param, fid, c, e) - root_gain), fid,
+              i == 0 ? min_val : cut[i - 1], true);
+        }
+      }
+    }
+  }
+  p_best->Update(best);
+}
+
+}  // namespace
+
+TEST(HistSplitKernel, SameAsScalar) {
+  std::mt19937 rng(0);
+  xgboost::tree::HistSplitKernel kernel;
+  for (const char* alpha : {"0", "0.5"}) {
+    for (const char* min_child_weight : {"0", "2"}) {
+      xgboost::tree::TrainParam param;
+      param.InitAllowUnknown(std::vector<std::pair<std::string, std::string> >{
+        {"reg_alpha", alpha}, {"min_child_weight", min_child_weight}});
+      ASSERT_TRUE(xgboost::tree::HistSplitKernel::Supported(param));
+      for (int round = 0; round < 50; ++round) {
+        const size_t nbin = 1 + rng() % 40;
+        // few distinct values, so that ties between thresholds happen
+        std::vector<xgboost::common::GHistEntry<double> > hist(nbin);
+        std::vector<xgboost::bst_float> cut(nbin);
+        xgboost::tree::GradStats total(param);
+        for (size_t i = 0; i < nbin; ++i) {
+          hist[i].sum_grad = static_cast<double>(rng() % 9) - 4.0;
+          hist[i].sum_hess = static_cast<double>(rng() % 4);
+          cut[i] = static_cast<xgboost::bst_float>(i) + 0.5f;
+          total.Add(hist[i].sum_grad, hist[i].sum_hess);
+        }
+        // missing values in the node
+        total.Add(static_cast<double>(rng() % 5) - 2.0, static_cast<double>(rng() % 3));
+        const xgboost::bst_float root_gain = static_cast<xgboost::bst_float>(total.CalcGain(param));
+        const xgboost::bst_uint fid = 3;
+
+        xgboost::tree::SplitEntry expected, got;
+        // a best split of another feature
+        expected.Update(0.25f, 1, 7.0f, false);
+        got = expected;
+        EnumerateSplitScalar(-1, param, hist, cut, -1.0f, total, root_gain, fid, &expected);
+        EnumerateSplitScalar(+1, param, hist, cut, -1.0f, total, root_gain, fid, &expected);
+        kernel.Enumerate(param, hist.data(), nbin, cut.data(), -1.0f, total, root_gain, fid, &got);
+        EXPECT_EQ(got.loss_chg, expected.loss_chg);
+        EXPECT_EQ(got.split_index(), expected.split_index());
+        EXPECT_EQ(got.split_value, expected.split_value);
+        EXPECT_EQ(got.default_left(), expected.default_left());
+      }
+    }
+  }
+}
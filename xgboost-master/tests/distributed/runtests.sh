@@ -2,3 +2,6 @@
 
 PYTHONPATH=../../python-package/ ../../dmlc-core/tracker/dmlc-submit  --cluster=local --num-workers=3\
   python test_basic.py
+
+PYTHONPATH=../../python-package/ ../../dmlc-core/tracker/dmlc-submit  --cluster=local --num-workers=4\
+  python test_sparse_hist.py
@@ -0,0 +1,30 @@
+#!/usr/bin/python
+import xgboost as xgb
+
+# always call this before using distributed module
+xgb.rabit.init()
+
+# Load file, file will be automatically sharded in distributed mode.
+dtrain = xgb.DMatrix('../../demo/data/agaricus.txt.train')
+
+# deep trees on one-hot features, so that most bins of the deep nodes are empty
+param = {'max_depth': 8, 'eta': 0.5, 'silent': 1, 'objective': 'binary:logistic',
+         'tree_method': 'approx', 'min_child_weight': 0}
+num_round = 5
+
+# histograms synchronized in full, and at their non-empty bins only
+dumps = []
+for ratio in [0, 0.5, 1]:
+    param['sparse_hist_ratio'] = ratio
+    bst = xgb.train(param, dtrain, num_round)
+    dumps.append(bst.get_dump(with_stats=True))
+
+for dump in dumps[1:]:
+    assert dump == dumps[0], 'sparse histogram allreduce changed the trees'
+
+if xgb.rabit.get_rank() == 0:
+    xgb.rabit.tracker_print("Finished sparse histogram test\n")
+
+# Notify the tracker all training has been successful
+# This is only needed in distributed training.
+xgb.rabit.finalize()